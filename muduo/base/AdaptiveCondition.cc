@@ -0,0 +1,56 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/AdaptiveCondition.h"
+#include "muduo/base/Futex.h"
+
+#include <errno.h>
+#include <time.h>
+
+using namespace muduo;
+
+void AdaptiveCondition::wait()
+{
+  mutex_.assertLocked();
+  // read seq_ before unlocking, a notify after that changes it
+  // and the futex wait returns immediately.
+  int32_t seq = seq_.load(std::memory_order_relaxed);
+  waiters_.fetch_add(1, std::memory_order_relaxed);
+  mutex_.unlock();
+  detail::futexWait(&seq_, seq);
+  mutex_.lock();
+  waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// returns true if time out, false otherwise.
+bool AdaptiveCondition::waitForSeconds(double seconds)
+{
+  mutex_.assertLocked();
+  const int64_t kNanoSecondsPerSecond = 1000000000;
+  int64_t nanoseconds = static_cast<int64_t>(seconds * kNanoSecondsPerSecond);
+  struct timespec timeout;
+  timeout.tv_sec = static_cast<time_t>(nanoseconds / kNanoSecondsPerSecond);
+  timeout.tv_nsec = static_cast<long>(nanoseconds % kNanoSecondsPerSecond);
+
+  int32_t seq = seq_.load(std::memory_order_relaxed);
+  waiters_.fetch_add(1, std::memory_order_relaxed);
+  mutex_.unlock();
+  int ret = detail::futexWait(&seq_, seq, &timeout);
+  int savedErrno = errno;
+  mutex_.lock();
+  waiters_.fetch_sub(1, std::memory_order_relaxed);
+  return ret == -1 && savedErrno == ETIMEDOUT;
+}
+
+void AdaptiveCondition::wake(int count)
+{
+  // waiters_ is changed under the mutex, callers usually hold it as well.
+  // If not, they have published their state change through the mutex.
+  if (waiters_.load(std::memory_order_relaxed) > 0)
+  {
+    seq_.fetch_add(1, std::memory_order_relaxed);
+    detail::futexWake(&seq_, count);
+  }
+}
@@ -0,0 +1,56 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_ADAPTIVECONDITION_H
+#define MUDUO_BASE_ADAPTIVECONDITION_H
+
+#include "muduo/base/AdaptiveMutex.h"
+
+#include <atomic>
+#include <stdint.h>
+
+namespace muduo
+{
+
+// Condition for AdaptiveMutexLock, an event count on a futex word.
+// notify() and notifyAll() make no syscall when nobody is waiting.
+class AdaptiveCondition : noncopyable
+{
+ public:
+  explicit AdaptiveCondition(AdaptiveMutexLock& mutex)
+    : mutex_(mutex),
+      seq_(0),
+      waiters_(0)
+  {
+  }
+
+  void wait();
+
+  // returns true if time out, false otherwise.
+  bool waitForSeconds(double seconds);
+
+  void notify()
+  {
+    wake(1);
+  }
+
+  void notifyAll()
+  {
+    wake(kWakeAll);
+  }
+
+ private:
+  static const int kWakeAll = 0x7fffffff;
+
+  void wake(int count);
+
+  AdaptiveMutexLock& mutex_;
+  std::atomic<int32_t> seq_;      // futex word, bumped by every notify
+  std::atomic<int32_t> waiters_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_ADAPTIVECONDITION_H
@@ -0,0 +1,117 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/AdaptiveMutex.h"
+#include "muduo/base/Futex.h"
+
+#include <algorithm>
+
+#include <time.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+namespace
+{
+
+// spinning only helps if the holder can run meanwhile.
+// zero during static initialization, which just means no spinning.
+const bool g_multiCore = ::sysconf(_SC_NPROCESSORS_ONLN) > 1;
+
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __asm__ __volatile__("pause" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+inline int64_t monotonicNs()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+}  // namespace
+
+const int AdaptiveMutexLock::kInitialSpins;
+const int AdaptiveMutexLock::kMaxSpins;
+
+// Ulrich Drepper, "Futexes Are Tricky", mutex3,
+// with an adaptive spin phase borrowed from PTHREAD_MUTEX_ADAPTIVE_NP.
+void AdaptiveMutexLock::lockSlow()
+{
+  int64_t start = monotonicNs();
+  bool acquired = false;
+  if (g_multiCore)
+  {
+    // a lost update of the average only costs a few spins
+    int32_t spins = spins_.load(std::memory_order_relaxed);
+    const int maxSpins = std::min(spins * 2 + 10, kMaxSpins);
+    int spin = 0;
+    for (; spin < maxSpins; ++spin)
+    {
+      cpuRelax();
+      int32_t expected = kUnlocked;
+      if (state_.load(std::memory_order_relaxed) == kUnlocked
+          && state_.compare_exchange_weak(expected, kLocked, std::memory_order_acquire))
+      {
+        acquired = true;
+        break;
+      }
+    }
+    spins_.store(spins + (spin - spins) / 8, std::memory_order_relaxed);
+  }
+
+  if (!acquired)
+  {
+    int32_t c = state_.exchange(kLockedWithWaiters, std::memory_order_acquire);
+    while (c != kUnlocked)
+    {
+      detail::futexWait(&state_, kLockedWithWaiters);
+      c = state_.exchange(kLockedWithWaiters, std::memory_order_acquire);
+    }
+    increment(&sleepCount_);
+  }
+
+  int64_t waitNs = monotonicNs() - start;
+  increment(&contendedCount_);
+  totalWaitNs_.store(totalWaitNs_.load(std::memory_order_relaxed) + waitNs,
+                     std::memory_order_relaxed);
+  if (waitNs > maxWaitNs_.load(std::memory_order_relaxed))
+  {
+    maxWaitNs_.store(waitNs, std::memory_order_relaxed);
+  }
+}
+
+void AdaptiveMutexLock::unlockSlow()
+{
+  // state_ was kLockedWithWaiters
+  state_.store(kUnlocked, std::memory_order_release);
+  detail::futexWake(&state_, 1);
+}
+
+AdaptiveMutexLock::Stats AdaptiveMutexLock::stats() const
+{
+  Stats result;
+  result.lockCount = lockCount_.load(std::memory_order_relaxed);
+  result.contendedCount = contendedCount_.load(std::memory_order_relaxed);
+  result.sleepCount = sleepCount_.load(std::memory_order_relaxed);
+  result.totalWaitNs = totalWaitNs_.load(std::memory_order_relaxed);
+  result.maxWaitNs = maxWaitNs_.load(std::memory_order_relaxed);
+  return result;
+}
+
+void AdaptiveMutexLock::resetStats()
+{
+  AdaptiveMutexLockGuard lock(*this);
+  lockCount_.store(0, std::memory_order_relaxed);
+  contendedCount_.store(0, std::memory_order_relaxed);
+  sleepCount_.store(0, std::memory_order_relaxed);
+  totalWaitNs_.store(0, std::memory_order_relaxed);
+  maxWaitNs_.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,158 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_ADAPTIVEMUTEX_H
+#define MUDUO_BASE_ADAPTIVEMUTEX_H
+
+#include "muduo/base/Mutex.h"
+
+#include <atomic>
+#include <stdint.h>
+
+namespace muduo
+{
+
+// A spin-then-futex mutex for very short critical sections, eg.
+// EventLoop::queueInLoop(). Same interface and annotations as MutexLock.
+//
+// The uncontended path is one CAS. When contended, it spins for a while
+// (the spin budget adapts to how long the lock was recently held), then
+// sleeps on a futex. It counts contention so hot locks can be spotted.
+class CAPABILITY("mutex") AdaptiveMutexLock : noncopyable
+{
+ public:
+  // All counters are sampled without locking, they are approximate.
+  struct Stats
+  {
+    int64_t lockCount;       // acquisitions
+    int64_t contendedCount;  // acquisitions that missed the fast path
+    int64_t sleepCount;      // acquisitions that slept on the futex
+    int64_t totalWaitNs;     // time spent in contended acquisitions
+    int64_t maxWaitNs;
+  };
+
+  AdaptiveMutexLock()
+    : state_(kUnlocked),
+      spins_(kInitialSpins),
+      holder_(0),
+      lockCount_(0),
+      contendedCount_(0),
+      sleepCount_(0),
+      totalWaitNs_(0),
+      maxWaitNs_(0)
+  {
+  }
+
+  ~AdaptiveMutexLock()
+  {
+    assert(holder_ == 0);
+    assert(state_.load(std::memory_order_relaxed) == kUnlocked);
+  }
+
+  bool isLockedByThisThread() const
+  {
+    return holder_ == CurrentThread::tid();
+  }
+
+  void assertLocked() const ASSERT_CAPABILITY(this)
+  {
+    assert(isLockedByThisThread());
+  }
+
+  // internal usage
+
+  void lock() ACQUIRE()
+  {
+    int32_t expected = kUnlocked;
+    if (__builtin_expect(!state_.compare_exchange_strong(
+            expected, kLocked, std::memory_order_acquire), 0))
+    {
+      lockSlow();
+    }
+    // only the holder writes the counters
+    increment(&lockCount_);
+    holder_ = CurrentThread::tid();
+  }
+
+  bool tryLock() TRY_ACQUIRE(true)
+  {
+    int32_t expected = kUnlocked;
+    if (state_.compare_exchange_strong(expected, kLocked, std::memory_order_acquire))
+    {
+      increment(&lockCount_);
+      holder_ = CurrentThread::tid();
+      return true;
+    }
+    return false;
+  }
+
+  void unlock() RELEASE()
+  {
+    holder_ = 0;
+    if (__builtin_expect(state_.fetch_sub(1, std::memory_order_release) != kLocked, 0))
+    {
+      unlockSlow();
+    }
+  }
+
+  Stats stats() const;
+  void resetStats();
+
+ private:
+  enum State
+  {
+    kUnlocked = 0,
+    kLocked = 1,
+    kLockedWithWaiters = 2,
+  };
+
+  static const int kInitialSpins = 16;
+  static const int kMaxSpins = 256;
+
+  static void increment(std::atomic<int64_t>* counter)
+  {
+    counter->store(counter->load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  }
+
+  void lockSlow();
+  void unlockSlow();
+
+  std::atomic<int32_t> state_;  // futex word
+  std::atomic<int32_t> spins_;  // moving average of spins needed, relaxed
+  pid_t holder_;
+  std::atomic<int64_t> lockCount_;
+  std::atomic<int64_t> contendedCount_;
+  std::atomic<int64_t> sleepCount_;
+  std::atomic<int64_t> totalWaitNs_;
+  std::atomic<int64_t> maxWaitNs_;
+};
+
+class SCOPED_CAPABILITY AdaptiveMutexLockGuard : noncopyable
+{
+ public:
+  explicit AdaptiveMutexLockGuard(AdaptiveMutexLock& mutex) ACQUIRE(mutex)
+    : mutex_(mutex)
+  {
+    mutex_.lock();
+  }
+
+  ~AdaptiveMutexLockGuard() RELEASE()
+  {
+    mutex_.unlock();
+  }
+
+ private:
+
+  AdaptiveMutexLock& mutex_;
+};
+
+}  // namespace muduo
+
+// Prevent misuse like:
+// AdaptiveMutexLockGuard(mutex_);
+#define AdaptiveMutexLockGuard(x) error "Missing guard object name"
+
+#endif  // MUDUO_BASE_ADAPTIVEMUTEX_H
@@ -4,106 +4,510 @@
 // Author: Shuo Chen (chenshuo at chenshuo dot com)
 
 #include "muduo/base/AsyncLogging.h"
+#include "muduo/base/BinaryLog.h"
 #include "muduo/base/LogFile.h"
 #include "muduo/base/Timestamp.h"
 
+#include <algorithm>
+
 #include <stdio.h>
 
 using namespace muduo;
 
+// Single producer, single consumer ring of buffers.
+// Slots in [tail, head) are full, the producer appends to slot head,
+// the backend has written the first consumed bytes of slot tail.
+struct AsyncLogging::Ring : noncopyable
+{
+  typedef muduo::detail::FixedBuffer<muduo::detail::kMediumBuffer> Buffer;
+  static const uint32_t kSlots = 4;
+
+  Ring()
+    : head(0),
+      closed(false),
+      sharedRound(0),
+      tail(0),
+      consumed(0),
+      headSeen(0),
+      committedSeen(0)
+  {
+    for (uint32_t i = 0; i < kSlots; ++i)
+    {
+      committed[i].store(0, std::memory_order_relaxed);
+      since[i].store(0, std::memory_order_relaxed);
+      buffers[i].reset(new Buffer);
+    }
+  }
+
+  // Returns false if the ring is full, sets *filled if a slot was handed
+  // to the backend.
+  bool append(const char* logline, int len, bool* filled)
+  {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    Buffer* buffer = buffers[h % kSlots].get();
+    if (buffer->avail() <= len)
+    {
+      if (h + 1 - tail.load(std::memory_order_acquire) >= kSlots)
+        return false;
+      head.store(++h, std::memory_order_release);
+      *filled = true;
+      buffer = buffers[h % kSlots].get();
+      if (buffer->avail() <= len)  // longer than a slot
+        return false;
+    }
+    if (buffer->length() == 0)
+    {
+      since[h % kSlots].store(Timestamp::now().microSecondsSinceEpoch(),
+                              std::memory_order_relaxed);
+    }
+    buffer->append(logline, len);
+    committed[h % kSlots].store(buffer->length(), std::memory_order_release);
+    return true;
+  }
+
+  // Hands the slots written up to the last collectRings() back to the producer.
+  void release()
+  {
+    for (uint32_t slot = tail.load(std::memory_order_relaxed); slot != headSeen; ++slot)
+    {
+      buffers[slot % kSlots]->reset();
+      committed[slot % kSlots].store(0, std::memory_order_relaxed);
+    }
+    consumed = committedSeen;
+    tail.store(headSeen, std::memory_order_release);
+  }
+
+  bool drained() const
+  {
+    uint32_t h = head.load(std::memory_order_acquire);
+    return tail.load(std::memory_order_relaxed) == h
+        && committed[h % kSlots].load(std::memory_order_acquire) == consumed;
+  }
+
+  // written by the producer
+  std::atomic<uint32_t> head;
+  std::atomic<int> committed[kSlots];     // bytes appended to each slot
+  std::atomic<int64_t> since[kSlots];     // time of the first line of each slot
+  std::atomic<bool> closed;               // the thread has exited
+  int64_t sharedRound;                    // that writes the last shared line of the thread
+  char pad[64];                           // keeps tail off the cache line of head
+  // written by the backend
+  std::atomic<uint32_t> tail;
+  int consumed;
+  uint32_t headSeen;                      // by the last collectRings()
+  int committedSeen;
+  std::unique_ptr<Buffer> buffers[kSlots];
+};
+
+// Ring of a thread, closed when the thread exits.
+struct AsyncLogging::RingHolder
+{
+  RingHolder() : ring(NULL) { }
+  ~RingHolder()
+  {
+    if (ring)
+      ring->closed.store(true, std::memory_order_release);
+  }
+
+  Ring* ring;
+};
+
+// Bytes of a ring slot for the backend to write.
+struct AsyncLogging::Chunk
+{
+  int64_t since;
+  const char* data;
+  int len;
+};
+
 AsyncLogging::AsyncLogging(const string& basename,
                            off_t rollSize,
                            int flushInterval)
   : flushInterval_(flushInterval),
     running_(false),
+    policy_(kDrop),
+    maxBuffers_(25),
+    keepBinary_(false),
+    writer_(LogFile::kStdio),
+    gzipLevel_(0),
+    binary_(false),
     basename_(basename),
     rollSize_(rollSize),
     thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging"),
     latch_(1),
     mutex_(),
     cond_(mutex_),
+    spaceCond_(mutex_),
     currentBuffer_(new Buffer),
     nextBuffer_(new Buffer),
-    buffers_()
+    buffers_(),
+    ringFilled_(false),
+    writing_(0),
+    rounds_(0),
+    writtenRounds_(0),
+    spilledLines_(0),
+    sitesRollCount_(0)
 {
   currentBuffer_->bzero();
   nextBuffer_->bzero();
   buffers_.reserve(16);
+  for (int i = 0; i < Logger::NUM_LOG_LEVELS; ++i)
+  {
+    droppedLines_[i].store(0, std::memory_order_relaxed);
+    droppedBytes_[i].store(0, std::memory_order_relaxed);
+  }
 }
 
-void AsyncLogging::append(const char* logline, int len)
+AsyncLogging::~AsyncLogging()
 {
-  muduo::MutexLockGuard lock(mutex_);
-  if (currentBuffer_->avail() > len)
+  if (running_)
   {
-    currentBuffer_->append(logline, len);
+    stop();
   }
-  else
+}
+
+void AsyncLogging::setMemoryBudget(size_t bytes)
+{
+  maxBuffers_ = std::max(bytes / sizeof(Buffer), static_cast<size_t>(2));
+}
+
+void AsyncLogging::start()
+{
+  if (policy_ == kSpill)
+  {
+    spill_.reset(new LogFile(basename_ + ".spill", rollSize_, true));
+  }
+  running_ = true;
+  thread_.start();
+  latch_.wait();
+}
+
+void AsyncLogging::stop()
+{
+  {
+    muduo::AdaptiveMutexLockGuard lock(mutex_);
+    running_ = false;
+    cond_.notify();
+    spaceCond_.notifyAll();
+  }
+  thread_.join();
+}
+
+AsyncLogging::Ring* AsyncLogging::threadRing()
+{
+  RingHolder& holder = threadRing_.value();
+  if (!holder.ring)
+  {
+    std::unique_ptr<Ring> ring(new Ring);
+    holder.ring = ring.get();
+    muduo::AdaptiveMutexLockGuard lock(mutex_);
+    rings_.push_back(std::move(ring));
+  }
+  return holder.ring;
+}
+
+void AsyncLogging::append(const char* logline, int len, Logger::LogLevel level)
+{
+  if (len > 0 && logline[0] == BinaryLog::kRecordMarker
+      && !binary_.load(std::memory_order_relaxed))
   {
-    buffers_.push_back(std::move(currentBuffer_));
+    binary_.store(true, std::memory_order_relaxed);
+  }
+  Ring* ring = threadRing();
+  bool filled = false;
+  bool appended = false;
+  // keeps the order of lines of the thread
+  if (ring->sharedRound <= writtenRounds_.load(std::memory_order_acquire))
+  {
+    appended = ring->append(logline, len, &filled);
+  }
+  if (filled)
+  {
+    muduo::AdaptiveMutexLockGuard lock(mutex_);
+    ringFilled_ = true;
+    cond_.notify();
+  }
+  if (!appended)
+  {
+    appendShared(ring, logline, len, level);
+  }
+}
 
-    if (nextBuffer_)
+// full buffers, those being written, the current one and the one to start
+bool AsyncLogging::overBudget(Logger::LogLevel level) const
+{
+  size_t buffers = buffers_.size() + writing_ + 2;
+  if (policy_ == kDropBelowWarn && level < Logger::WARN)
+    return buffers > maxBuffers_ * 3 / 4;
+  return buffers > maxBuffers_;
+}
+
+void AsyncLogging::drop(int len, Logger::LogLevel level)
+{
+  droppedLines_[level].store(droppedLines(level) + 1, std::memory_order_relaxed);
+  droppedBytes_[level].store(droppedBytes(level) + len, std::memory_order_relaxed);
+}
+
+int64_t AsyncLogging::totalDropped() const
+{
+  int64_t total = 0;
+  for (int i = 0; i < Logger::NUM_LOG_LEVELS; ++i)
+  {
+    total += droppedLines(static_cast<Logger::LogLevel>(i));
+  }
+  return total;
+}
+
+void AsyncLogging::appendShared(Ring* ring, const char* logline, int len, Logger::LogLevel level)
+{
+  {
+    muduo::AdaptiveMutexLockGuard lock(mutex_);
+    if (policy_ == kBlock)
     {
-      currentBuffer_ = std::move(nextBuffer_);
+      while (currentBuffer_->avail() <= len && overBudget(level) && running_)
+      {
+        spaceCond_.wait();
+      }
     }
-    else
+    if (currentBuffer_->avail() > len)
     {
-      currentBuffer_.reset(new Buffer); // Rarely happens
+      currentBuffer_->append(logline, len);
+      ring->sharedRound = rounds_ + 1;
+      return;
     }
-    currentBuffer_->append(logline, len);
-    cond_.notify();
+
+    if (!overBudget(level))
+    {
+      buffers_.push_back(std::move(currentBuffer_));
+
+      if (nextBuffer_)
+      {
+        currentBuffer_ = std::move(nextBuffer_);
+      }
+      else
+      {
+        currentBuffer_.reset(new Buffer); // Rarely happens
+      }
+      currentBuffer_->append(logline, len);
+      ring->sharedRound = rounds_ + 1;
+      cond_.notify();
+      return;
+    }
+    if (!spill_)
+    {
+      drop(len, level);
+      return;
+    }
+  }
+  // LogFile has its own lock
+  spill_->append(logline, len);
+  spilledLines_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncLogging::removeClosedRings()
+{
+  auto closed = [](const std::unique_ptr<Ring>& ring) {
+    return ring->closed.load(std::memory_order_acquire) && ring->drained();
+  };
+  rings_.erase(std::remove_if(rings_.begin(), rings_.end(), closed), rings_.end());
+}
+
+// Chunks of all rings, oldest first, slots are released by the caller.
+void AsyncLogging::collectRings(std::vector<Ring*>* rings, std::vector<Chunk>* chunks)
+{
+  for (Ring* ring : *rings)
+  {
+    uint32_t head = ring->head.load(std::memory_order_acquire);
+    uint32_t slot = ring->tail.load(std::memory_order_relaxed);
+    int from = ring->consumed;
+    for (;; ++slot)
+    {
+      int end = ring->committed[slot % Ring::kSlots].load(std::memory_order_acquire);
+      if (end > from)
+      {
+        Chunk chunk = { ring->since[slot % Ring::kSlots].load(std::memory_order_relaxed),
+                        ring->buffers[slot % Ring::kSlots]->data() + from,
+                        end - from };
+        chunks->push_back(chunk);
+      }
+      if (slot == head)
+      {
+        ring->headSeen = head;
+        ring->committedSeen = end;
+        break;
+      }
+      from = 0;
+    }
+  }
+  std::stable_sort(chunks->begin(), chunks->end(),
+                   [](const Chunk& lhs, const Chunk& rhs) { return lhs.since < rhs.since; });
+}
+
+// Lines of text are written as they are, records are formatted unless
+// keepBinary_.
+void AsyncLogging::write(LogFile* output, const char* data, int len)
+{
+  if (!binary_.load(std::memory_order_relaxed))
+  {
+    output->append(data, len);
+    return;
+  }
+  const char* end = data + len;
+  const char* text = data;
+  const char* p = data;
+  while (p < end)
+  {
+    if (*p != BinaryLog::kRecordMarker)
+    {
+      const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+      p = eol ? eol + 1 : end;
+      continue;
+    }
+    int n = BinaryLog::entryLength(p, end - p);
+    if (n == 0)  // broken, write the rest as it is
+    {
+      break;
+    }
+    if (p > text)
+    {
+      output->append(text, static_cast<int>(p - text));
+    }
+    writeRecord(output, p, n);
+    p += n;
+    text = p;
+  }
+  if (end > text)
+  {
+    output->append(text, static_cast<int>(end - text));
+  }
+}
+
+void AsyncLogging::writeRecord(LogFile* output, const char* record, int len)
+{
+  uint32_t id = BinaryLog::siteId(record);
+  if (id >= sites_.size())
+  {
+    sites_.resize(id + 1);
+    sitesWritten_.resize(id + 1);
+  }
+  if (!sites_[id])
+  {
+    sites_[id] = BinaryLog::site(record);
+    if (!sites_[id])
+      return;
   }
+  const BinaryLogSite& site = *sites_[id];
+
+  if (!keepBinary_)
+  {
+    formatted_.clear();
+    BinaryLog::format(site, record, len, &formatted_);
+    output->append(formatted_.data(), static_cast<int>(formatted_.size()));
+    return;
+  }
+  // each file has the sites of its records, written before them
+  while (output->rollCount() != sitesRollCount_ || !sitesWritten_[id])
+  {
+    if (output->rollCount() != sitesRollCount_)
+    {
+      sitesRollCount_ = output->rollCount();
+      sitesWritten_.assign(sitesWritten_.size(), false);
+    }
+    formatted_.clear();
+    BinaryLog::appendSite(site, &formatted_);
+    output->append(formatted_.data(), static_cast<int>(formatted_.size()));
+    sitesWritten_[id] = true;
+  }
+  output->append(record, len);
 }
 
 void AsyncLogging::threadFunc()
 {
   assert(running_ == true);
   latch_.countDown();
-  LogFile output(basename_, rollSize_, false);
+  LogFile output(basename_, rollSize_, false, 3, 1024, writer_, gzipLevel_);
+  output.setRollCallback(rollCallback_);
   BufferPtr newBuffer1(new Buffer);
   BufferPtr newBuffer2(new Buffer);
   newBuffer1->bzero();
   newBuffer2->bzero();
   BufferVector buffersToWrite;
   buffersToWrite.reserve(16);
-  while (running_)
+  std::vector<Ring*> ringsToWrite;
+  std::vector<Chunk> chunks;
+  int64_t reportedDrops = 0;
+  int64_t round = 0;
+  // one more round after stop(), for lines appended before it
+  bool more = true;
+  while (more)
   {
     assert(newBuffer1 && newBuffer1->length() == 0);
     assert(newBuffer2 && newBuffer2->length() == 0);
     assert(buffersToWrite.empty());
 
+    more = running_;
     {
-      muduo::MutexLockGuard lock(mutex_);
-      if (buffers_.empty())  // unusual usage!
+      muduo::AdaptiveMutexLockGuard lock(mutex_);
+      if (more && buffers_.empty() && !ringFilled_)  // unusual usage!
       {
         cond_.waitForSeconds(flushInterval_);
       }
+      ringFilled_ = false;
       buffers_.push_back(std::move(currentBuffer_));
       currentBuffer_ = std::move(newBuffer1);
       buffersToWrite.swap(buffers_);
+      writing_ = buffersToWrite.size();
+      round = ++rounds_;
       if (!nextBuffer_)
       {
         nextBuffer_ = std::move(newBuffer2);
       }
+      removeClosedRings();
+      ringsToWrite.clear();
+      for (const auto& ring : rings_)
+      {
+        ringsToWrite.push_back(ring.get());
+      }
     }
 
     assert(!buffersToWrite.empty());
 
-    if (buffersToWrite.size() > 25)
+    collectRings(&ringsToWrite, &chunks);
+    for (const Chunk& chunk : chunks)
+    {
+      write(&output, chunk.data, chunk.len);
+    }
+    chunks.clear();
+    for (Ring* ring : ringsToWrite)
+    {
+      ring->release();
+    }
+
+    int64_t dropped = totalDropped();
+    if (dropped != reportedDrops)
     {
       char buf[256];
-      snprintf(buf, sizeof buf, "Dropped log messages at %s, %zd larger buffers\n",
+      snprintf(buf, sizeof buf, "Dropped %lld log messages at %s, %lld in total\n",
+               static_cast<long long>(dropped - reportedDrops),
                Timestamp::now().toFormattedString().c_str(),
-               buffersToWrite.size()-2);
+               static_cast<long long>(dropped));
       fputs(buf, stderr);
       output.append(buf, static_cast<int>(strlen(buf)));
-      buffersToWrite.erase(buffersToWrite.begin()+2, buffersToWrite.end());
+      reportedDrops = dropped;
     }
 
+    // after the rings, a line goes to a shared buffer only when the ring
+    // of its thread is full
     for (const auto& buffer : buffersToWrite)
     {
       // FIXME: use unbuffered stdio FILE ? or use ::writev ?
-      output.append(buffer->data(), buffer->length());
+      write(&output, buffer->data(), buffer->length());
+    }
+    writtenRounds_.store(round, std::memory_order_release);
+    {
+      muduo::AdaptiveMutexLockGuard lock(mutex_);
+      writing_ = 0;
+      spaceCond_.notifyAll();
     }
 
     if (buffersToWrite.size() > 2)
@@ -130,6 +534,10 @@ void AsyncLogging::threadFunc()
 
     buffersToWrite.clear();
     output.flush();
+    if (spill_)
+    {
+      spill_->flush();
+    }
   }
   output.flush();
 }
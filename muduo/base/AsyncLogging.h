@@ -6,11 +6,16 @@
 #ifndef MUDUO_BASE_ASYNCLOGGING_H
 #define MUDUO_BASE_ASYNCLOGGING_H
 
+#include "muduo/base/AdaptiveCondition.h"
+#include "muduo/base/AdaptiveMutex.h"
 #include "muduo/base/BlockingQueue.h"
 #include "muduo/base/BoundedBlockingQueue.h"
 #include "muduo/base/CountDownLatch.h"
+#include "muduo/base/LogFile.h"
+#include "muduo/base/Logging.h"
 #include "muduo/base/Mutex.h"
 #include "muduo/base/Thread.h"
+#include "muduo/base/ThreadLocal.h"
 #include "muduo/base/LogStream.h"
 
 #include <atomic>
@@ -19,57 +24,154 @@
 namespace muduo
 {
 
+struct BinaryLogSite;
+
+///
+/// Writes log lines to LogFile in a background thread.
+///
+/// Each thread appends to its own ring of buffers without locking,
+/// the background thread collects them and writes lines of different
+/// threads in approximate timestamp order. Lines that don't fit in a full
+/// ring go to a buffer shared by all threads under a lock.
+///
+/// Lines of one thread are written in the order they were appended:
+/// shared buffers are written after the rings in each round, and a thread
+/// that has lines in them keeps to them until they are written.
+/// Spilled lines go to another file.
+///
+/// Shared buffers are bounded by a memory budget, what happens to lines
+/// beyond it is chosen by OverflowPolicy. Dropped lines are counted
+/// per level.
+///
+/// BinaryLog records are formatted in the background thread, or written
+/// as they are for logdecoder.
 class AsyncLogging : noncopyable
 {
  public:
+  enum OverflowPolicy
+  {
+    kDrop,          // drops lines beyond the budget
+    kBlock,         // blocks the logging threads until the backend catches up
+    kDropBelowWarn, // drops lines below WARN once 3/4 of the budget is used,
+                    // WARN and above only beyond the budget
+    kSpill,         // writes lines beyond the budget to basename.spill
+                    // in the logging thread
+  };
 
   AsyncLogging(const string& basename,
                off_t rollSize,
                int flushInterval = 3);
 
-  ~AsyncLogging()
-  {
-    if (running_)
-    {
-      stop();
-    }
-  }
-
-  void append(const char* logline, int len);
-
-  void start()
-  {
-    running_ = true;
-    thread_.start();
-    latch_.wait();
-  }
-
-  void stop() NO_THREAD_SAFETY_ANALYSIS
-  {
-    running_ = false;
-    cond_.notify();
-    thread_.join();
-  }
+  ~AsyncLogging();
+
+  /// Must be called before start(), default is kDrop.
+  void setOverflowPolicy(OverflowPolicy policy)
+  { policy_ = policy; }
+
+  /// Bytes of shared buffers waiting for the backend, at least two buffers.
+  /// Rings of the threads are not counted, they have a fixed size.
+  /// Must be called before start(), default is 100MB.
+  void setMemoryBudget(size_t bytes);
+
+  /// Writes BinaryLog records as they are, with the sites they use,
+  /// instead of formatting them. Must be called before start().
+  void setKeepBinary(bool on)
+  { keepBinary_ = on; }
+
+  /// How the log files are written, default is LogFile::kStdio.
+  /// kPwrite and kDirect preallocate rollSize for each file.
+  /// Must be called before start().
+  void setFileWriter(LogFile::Writer writer)
+  { writer_ = writer; }
+
+  /// Writes log files of gzip members, one for the lines written in each
+  /// round of the background thread, 0 for plain text, the default.
+  /// gzip -d reads a file up to the last round even if the process died.
+  /// Must be called before start().
+  void setGzipLevel(int level)
+  { gzipLevel_ = level; }
+
+  /// See LogFile::setRollCallback(), called in the background thread.
+  /// Must be called before start().
+  void setRollCallback(const LogFile::RollCallback& cb)
+  { rollCallback_ = cb; }
+
+  /// The level is Logger::outputLevel(), for use as Logger's output.
+  void append(const char* logline, int len)
+  { append(logline, len, Logger::outputLevel()); }
+
+  /// logline is a line of text or a BinaryLog record.
+  void append(const char* logline, int len, Logger::LogLevel level);
+
+  /// Thread safe.
+  int64_t droppedLines(Logger::LogLevel level) const
+  { return droppedLines_[level].load(std::memory_order_relaxed); }
+  int64_t droppedBytes(Logger::LogLevel level) const
+  { return droppedBytes_[level].load(std::memory_order_relaxed); }
+  int64_t spilledLines() const
+  { return spilledLines_.load(std::memory_order_relaxed); }
+
+  AdaptiveMutexLock::Stats lockStats() const
+  { return mutex_.stats(); }
+
+  void start();
+  void stop();
 
  private:
 
   void threadFunc();
 
+  struct Ring;
+  struct RingHolder;
+  struct Chunk;
+  Ring* threadRing();
+  void appendShared(Ring* ring, const char* logline, int len, Logger::LogLevel level);
+  bool overBudget(Logger::LogLevel level) const REQUIRES(mutex_);
+  void drop(int len, Logger::LogLevel level) REQUIRES(mutex_);
+  int64_t totalDropped() const;
+  void collectRings(std::vector<Ring*>* rings, std::vector<Chunk>* chunks);
+  void removeClosedRings() REQUIRES(mutex_);
+  void write(LogFile* output, const char* data, int len);
+  void writeRecord(LogFile* output, const char* record, int len);
+
   typedef muduo::detail::FixedBuffer<muduo::detail::kLargeBuffer> Buffer;
   typedef std::vector<std::unique_ptr<Buffer>> BufferVector;
   typedef BufferVector::value_type BufferPtr;
 
   const int flushInterval_;
   std::atomic<bool> running_;
+  OverflowPolicy policy_;
+  size_t maxBuffers_;                   // memory budget in buffers
+  bool keepBinary_;
+  LogFile::Writer writer_;
+  LogFile::RollCallback rollCallback_;
+  int gzipLevel_;
+  std::atomic<bool> binary_;            // any BinaryLog record appended
   const string basename_;
   const off_t rollSize_;
   muduo::Thread thread_;
   muduo::CountDownLatch latch_;
-  muduo::MutexLock mutex_;
-  muduo::Condition cond_ GUARDED_BY(mutex_);
+  muduo::AdaptiveMutexLock mutex_;
+  muduo::AdaptiveCondition cond_ GUARDED_BY(mutex_);
+  muduo::AdaptiveCondition spaceCond_ GUARDED_BY(mutex_);  // kBlock waits here
   BufferPtr currentBuffer_ GUARDED_BY(mutex_);
   BufferPtr nextBuffer_ GUARDED_BY(mutex_);
   BufferVector buffers_ GUARDED_BY(mutex_);
+  std::vector<std::unique_ptr<Ring>> rings_ GUARDED_BY(mutex_);  // one per thread
+  bool ringFilled_ GUARDED_BY(mutex_);
+  size_t writing_ GUARDED_BY(mutex_);   // buffers the backend is writing
+  int64_t rounds_ GUARDED_BY(mutex_);   // shared buffers taken by the backend
+  std::atomic<int64_t> writtenRounds_;  // and written
+  muduo::ThreadLocal<RingHolder> threadRing_;
+  std::unique_ptr<LogFile> spill_;
+  std::atomic<int64_t> droppedLines_[Logger::NUM_LOG_LEVELS];
+  std::atomic<int64_t> droppedBytes_[Logger::NUM_LOG_LEVELS];
+  std::atomic<int64_t> spilledLines_;
+  // used by the background thread only
+  std::vector<const BinaryLogSite*> sites_;   // by id
+  std::vector<bool> sitesWritten_;            // to the current file, by id
+  int sitesRollCount_;
+  string formatted_;
 };
 
 }  // namespace muduo
@@ -0,0 +1,229 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/BinaryLog.h"
+
+#include "muduo/base/Mutex.h"
+
+#include <vector>
+
+#include <stdio.h>
+#include <time.h>
+
+using namespace muduo;
+
+namespace
+{
+
+const int kHeaderLength = 1 + sizeof(uint16_t);
+// header, site, microseconds, tid
+const int kRecordPrefix = kHeaderLength + sizeof(uint32_t) + sizeof(int64_t) + sizeof(int32_t);
+
+const char* const kLevelNames[Logger::NUM_LOG_LEVELS] =
+{
+  "TRACE ",
+  "DEBUG ",
+  "INFO  ",
+  "WARN  ",
+  "ERROR ",
+  "FATAL ",
+};
+
+BinaryLog::OutputFunc g_binaryOutput = NULL;
+
+MutexLock g_sitesMutex;
+std::vector<BinaryLogSite*> g_sites GUARDED_BY(g_sitesMutex);  // id is index + 1
+
+template<typename T>
+T load(const char* p)
+{
+  T v;
+  memcpy(&v, p, sizeof v);
+  return v;
+}
+
+// One argument at p, returns the bytes it takes, 0 if it is malformed.
+int formatArg(const char* p, const char* end, LogStream* stream)
+{
+  if (p >= end)
+    return 0;
+  size_t left = static_cast<size_t>(end - p) - 1;
+  switch (*p)
+  {
+    case 'b':
+      if (left < 1) return 0;
+      *stream << (p[1] != 0);
+      return 2;
+    case 'c':
+      if (left < 1) return 0;
+      *stream << p[1];
+      return 2;
+    case 'i':
+      if (left < sizeof(int32_t)) return 0;
+      *stream << load<int32_t>(p + 1);
+      return 1 + sizeof(int32_t);
+    case 'u':
+      if (left < sizeof(uint32_t)) return 0;
+      *stream << load<uint32_t>(p + 1);
+      return 1 + sizeof(uint32_t);
+    case 'I':
+      if (left < sizeof(int64_t)) return 0;
+      *stream << load<int64_t>(p + 1);
+      return 1 + sizeof(int64_t);
+    case 'U':
+      if (left < sizeof(uint64_t)) return 0;
+      *stream << load<uint64_t>(p + 1);
+      return 1 + sizeof(uint64_t);
+    case 'd':
+      if (left < sizeof(double)) return 0;
+      *stream << load<double>(p + 1);
+      return 1 + sizeof(double);
+    case 'p':
+      if (left < sizeof(uint64_t)) return 0;
+      *stream << reinterpret_cast<const void*>(load<uint64_t>(p + 1));
+      return 1 + sizeof(uint64_t);
+    case 's':
+    {
+      if (left < sizeof(uint16_t)) return 0;
+      uint16_t len = load<uint16_t>(p + 1);
+      if (left - sizeof(uint16_t) < len) return 0;
+      stream->append(p + 1 + sizeof(uint16_t), len);
+      return 1 + static_cast<int>(sizeof(uint16_t)) + len;
+    }
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+void BinaryLog::setOutput(OutputFunc out)
+{
+  g_binaryOutput = out;
+}
+
+uint32_t BinaryLog::registerSite(BinaryLogSite* site)
+{
+  MutexLockGuard lock(g_sitesMutex);
+  uint32_t id = site->id.load(std::memory_order_relaxed);
+  if (id == 0)
+  {
+    g_sites.push_back(site);
+    id = static_cast<uint32_t>(g_sites.size());
+    site->id.store(id, std::memory_order_release);
+  }
+  return id;
+}
+
+const BinaryLogSite* BinaryLog::site(const char* record)
+{
+  uint32_t id = siteId(record);
+  MutexLockGuard lock(g_sitesMutex);
+  return id > 0 && id <= g_sites.size() ? g_sites[id - 1] : NULL;
+}
+
+uint32_t BinaryLog::siteId(const char* entry)
+{
+  return load<uint32_t>(entry + kHeaderLength);
+}
+
+void BinaryLog::output(const char* record, int len, Logger::LogLevel level)
+{
+  if (g_binaryOutput)
+  {
+    g_binaryOutput(record, len, level);
+  }
+  else
+  {
+    string line;
+    format(*site(record), record, len, &line);
+    Logger::output(level, line.data(), static_cast<int>(line.size()));
+  }
+}
+
+int BinaryLog::entryLength(const char* data, size_t len)
+{
+  if (len < static_cast<size_t>(kHeaderLength))
+    return 0;
+  uint16_t n = load<uint16_t>(data + 1);
+  return n >= kHeaderLength && n <= len ? n : 0;
+}
+
+void BinaryLog::format(const BinaryLogSite& site, const char* record, int len, string* out)
+{
+  LogStream stream;
+  int64_t us = load<int64_t>(record + kHeaderLength + sizeof(uint32_t));
+  time_t seconds = static_cast<time_t>(us / Timestamp::kMicroSecondsPerSecond);
+  struct tm tm_time;
+  ::gmtime_r(&seconds, &tm_time);
+  char buf[64];
+  snprintf(buf, sizeof buf, "%4d%02d%02d %02d:%02d:%02d.%06dZ %5d ",
+           tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+           tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec,
+           static_cast<int>(us % Timestamp::kMicroSecondsPerSecond),
+           load<int32_t>(record + kHeaderLength + sizeof(uint32_t) + sizeof(int64_t)));
+  stream << buf << kLevelNames[site.level];
+
+  const char* arg = record + kRecordPrefix;
+  const char* end = record + len;
+  const char* fmt = site.format;
+  while (*fmt)
+  {
+    const char* hole = strstr(fmt, "{}");
+    if (hole == NULL)
+    {
+      stream << fmt;
+      break;
+    }
+    stream.append(fmt, static_cast<int>(hole - fmt));
+    int n = formatArg(arg, end, &stream);
+    if (n == 0)
+      stream.append("{}", 2);
+    arg += n;
+    fmt = hole + 2;
+  }
+  // more arguments than holes
+  for (int n; (n = formatArg(arg, end, &stream)) > 0; arg += n)
+  {
+  }
+
+  const char* slash = strrchr(site.file, '/');
+  stream << " - " << (slash ? slash + 1 : site.file) << ':' << site.line << '\n';
+  out->append(stream.buffer().data(), stream.buffer().length());
+}
+
+void BinaryLog::appendSite(const BinaryLogSite& site, string* out)
+{
+  size_t fileLen = strlen(site.file) + 1;
+  size_t formatLen = strlen(site.format) + 1;
+  uint16_t len = static_cast<uint16_t>(kHeaderLength + sizeof(uint32_t) + 1 + sizeof(int32_t)
+                                       + fileLen + formatLen);
+  uint32_t id = site.id.load(std::memory_order_relaxed);
+  uint8_t level = static_cast<uint8_t>(site.level);
+  int32_t line = site.line;
+  out->push_back(kSiteMarker);
+  out->append(reinterpret_cast<const char*>(&len), sizeof len);
+  out->append(reinterpret_cast<const char*>(&id), sizeof id);
+  out->append(reinterpret_cast<const char*>(&level), sizeof level);
+  out->append(reinterpret_cast<const char*>(&line), sizeof line);
+  out->append(site.file, fileLen);
+  out->append(site.format, formatLen);
+}
+
+bool BinaryLog::parseSite(const char* entry, int len, BinaryLogSite* site)
+{
+  const int kFixed = kHeaderLength + sizeof(uint32_t) + 1 + sizeof(int32_t);
+  if (len < kFixed + 2 || entry[0] != kSiteMarker || entry[len - 1] != '\0')
+    return false;
+  uint8_t level = static_cast<uint8_t>(entry[kHeaderLength + sizeof(uint32_t)]);
+  if (level >= Logger::NUM_LOG_LEVELS)
+    return false;
+  site->id.store(siteId(entry), std::memory_order_relaxed);
+  site->level = static_cast<Logger::LogLevel>(level);
+  site->line = load<int32_t>(entry + kHeaderLength + sizeof(uint32_t) + 1);
+  site->file = entry + kFixed;
+  site->format = site->file + strlen(site->file) + 1;
+  return site->format < entry + len;
+}
@@ -0,0 +1,195 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_BINARYLOG_H
+#define MUDUO_BASE_BINARYLOG_H
+
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Timestamp.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <string.h>
+
+namespace muduo
+{
+
+///
+/// A call site of LOG_BINARY, registered at its first call.
+///
+struct BinaryLogSite
+{
+  Logger::LogLevel level;
+  const char* file;
+  int line;
+  const char* format;             // "{}" are replaced by the arguments in turn
+  std::atomic<uint32_t> id;       // 0 until registered
+};
+
+namespace detail
+{
+
+// Writes the arguments of a record with a type tag each,
+// strings are cut to fit in the record.
+class BinaryLogEncoder : noncopyable
+{
+ public:
+  BinaryLogEncoder(char* buf, int size)
+    : cur_(buf), end_(buf + size)
+  { }
+
+  void put(bool v) { tagged('b', static_cast<char>(v)); }
+  void put(char v) { tagged('c', v); }
+  void put(short v) { tagged('i', static_cast<int32_t>(v)); }
+  void put(unsigned short v) { tagged('u', static_cast<uint32_t>(v)); }
+  void put(int v) { tagged('i', static_cast<int32_t>(v)); }
+  void put(unsigned int v) { tagged('u', static_cast<uint32_t>(v)); }
+  void put(long v) { tagged('I', static_cast<int64_t>(v)); }
+  void put(unsigned long v) { tagged('U', static_cast<uint64_t>(v)); }
+  void put(long long v) { tagged('I', static_cast<int64_t>(v)); }
+  void put(unsigned long long v) { tagged('U', static_cast<uint64_t>(v)); }
+  void put(float v) { tagged('d', static_cast<double>(v)); }
+  void put(double v) { tagged('d', v); }
+  void put(const void* p) { tagged('p', reinterpret_cast<uint64_t>(p)); }
+  void put(const char* str) { putString(str, str ? strlen(str) : 0); }
+  void put(const string& v) { putString(v.data(), v.size()); }
+  void put(const StringPiece& v) { putString(v.data(), v.size()); }
+
+  template<typename T>
+  void raw(T v)
+  {
+    if (end_ - cur_ >= static_cast<ptrdiff_t>(sizeof v))
+    {
+      memcpy(cur_, &v, sizeof v);
+      cur_ += sizeof v;
+    }
+  }
+
+  char* current() { return cur_; }
+
+ private:
+  template<typename T>
+  void tagged(char tag, T v)
+  {
+    if (end_ - cur_ >= static_cast<ptrdiff_t>(1 + sizeof v))
+    {
+      *cur_++ = tag;
+      memcpy(cur_, &v, sizeof v);
+      cur_ += sizeof v;
+    }
+  }
+
+  void putString(const char* str, size_t len)
+  {
+    const size_t kHeader = 1 + sizeof(uint16_t);
+    if (end_ - cur_ < static_cast<ptrdiff_t>(kHeader))
+      return;
+    len = std::min(len, static_cast<size_t>(end_ - cur_) - kHeader);
+    uint16_t n = static_cast<uint16_t>(len);
+    *cur_++ = 's';
+    memcpy(cur_, &n, sizeof n);
+    memcpy(cur_ + sizeof n, str, len);
+    cur_ += sizeof n + len;
+  }
+
+  char* cur_;
+  char* const end_;
+};
+
+}  // namespace detail
+
+///
+/// Binary log records, formatted later by AsyncLogging or logdecoder.
+///
+/// A record is the site id, time, thread id and the raw arguments,
+/// so the logging thread does no formatting. Records are in native byte
+/// order, decode them on a host of the same kind.
+///
+/// Entry layout, the length includes the 3 bytes header:
+///   record: '\0' uint16 length, uint32 site, int64 microseconds,
+///           int32 tid, tagged arguments
+///   site:   '\1' uint16 length, uint32 site, uint8 level, int32 line,
+///           file '\0' format '\0'
+class BinaryLog : noncopyable
+{
+ public:
+  static const char kRecordMarker = '\0';
+  static const char kSiteMarker = '\1';
+  static const int kMaxRecord = 1024;
+
+  typedef void (*OutputFunc)(const char* record, int len, Logger::LogLevel level);
+
+  /// Where records go, eg. AsyncLogging::append().
+  /// NULL (default) formats them in the logging thread
+  /// and writes them with Logger::output().
+  static void setOutput(OutputFunc out);
+
+  template<typename... Args>
+  static void log(BinaryLogSite* site, const Args&... args)
+  {
+    uint32_t id = site->id.load(std::memory_order_acquire);
+    if (id == 0)
+    {
+      id = registerSite(site);
+    }
+    char buf[kMaxRecord];
+    detail::BinaryLogEncoder encoder(buf, sizeof buf);
+    encoder.raw(kRecordMarker);
+    encoder.raw(static_cast<uint16_t>(0));
+    encoder.raw(id);
+    encoder.raw(Timestamp::now().microSecondsSinceEpoch());
+    encoder.raw(static_cast<int32_t>(CurrentThread::tid()));
+    int dummy[] = { 0, (encoder.put(args), 0)... };
+    (void) dummy;
+    uint16_t len = static_cast<uint16_t>(encoder.current() - buf);
+    memcpy(buf + 1, &len, sizeof len);
+    output(buf, len, site->level);
+  }
+
+  /// Length of the entry at data, 0 if it is incomplete.
+  static int entryLength(const char* data, size_t len);
+  /// Site of a record, NULL if it wasn't registered in this process.
+  static const BinaryLogSite* site(const char* record);
+  /// Appends a record as a line of text like Logger's, in UTC.
+  static void format(const BinaryLogSite& site, const char* record, int len, string* out);
+  /// Appends a site entry, for decoding records elsewhere.
+  static void appendSite(const BinaryLogSite& site, string* out);
+  /// Parses a site entry, file and format point into the entry.
+  static bool parseSite(const char* entry, int len, BinaryLogSite* site);
+  static uint32_t siteId(const char* entry);
+
+ private:
+  static uint32_t registerSite(BinaryLogSite* site);
+  static void output(const char* record, int len, Logger::LogLevel level);
+};
+
+}  // namespace muduo
+
+//
+// LOG_BINARY_INFO("{} connected in {} us", name, elapsed);
+//
+// Arguments are integers, floating points, chars, bools, pointers
+// and strings, those of other types don't compile.
+//
+#define LOG_BINARY(level, format, ...) \
+  do { \
+    if (MUDUO_LOG_ENABLED(level)) \
+    { \
+      static muduo::BinaryLogSite muduoLogSite = \
+          { (level), __FILE__, __LINE__, (format), { 0 } }; \
+      muduo::BinaryLog::log(&muduoLogSite, ##__VA_ARGS__); \
+    } \
+  } while (0)
+
+#define LOG_BINARY_TRACE(format, ...) LOG_BINARY(muduo::Logger::TRACE, format, ##__VA_ARGS__)
+#define LOG_BINARY_DEBUG(format, ...) LOG_BINARY(muduo::Logger::DEBUG, format, ##__VA_ARGS__)
+#define LOG_BINARY_INFO(format, ...) LOG_BINARY(muduo::Logger::INFO, format, ##__VA_ARGS__)
+#define LOG_BINARY_WARN(format, ...) LOG_BINARY(muduo::Logger::WARN, format, ##__VA_ARGS__)
+#define LOG_BINARY_ERROR(format, ...) LOG_BINARY(muduo::Logger::ERROR, format, ##__VA_ARGS__)
+
+#endif  // MUDUO_BASE_BINARYLOG_H
@@ -9,7 +9,9 @@
 #include "muduo/base/Condition.h"
 #include "muduo/base/Mutex.h"
 
+#include <algorithm>
 #include <deque>
+#include <vector>
 #include <assert.h>
 
 namespace muduo
@@ -24,6 +26,7 @@ class BlockingQueue : noncopyable
   BlockingQueue()
     : mutex_(),
       notEmpty_(mutex_),
+      waiters_(0),
       queue_()
   {
   }
@@ -48,22 +51,55 @@ class BlockingQueue : noncopyable
     notEmpty_.notify();
   }
 
+  // Moves all items in one critical section,
+  // wakes at most as many consumers as there are items.
+  void putAll(std::vector<T>&& xs)
+  {
+    if (xs.empty())
+    {
+      return;
+    }
+    MutexLockGuard lock(mutex_);
+    for (auto& x : xs)
+    {
+      queue_.push_back(std::move(x));
+    }
+    wakeUp(xs.size());
+    xs.clear();
+  }
+
   //消费者
   T take()
   {
     //加锁
     MutexLockGuard lock(mutex_);
     // always use a while-loop, due to spurious wakeup
-    while (queue_.empty())
-    {
-      notEmpty_.wait();
-    }
+    waitForItems();
     assert(!queue_.empty());
     T front(std::move(queue_.front()));
     queue_.pop_front();
     return front;
   }
 
+  // Blocks until the queue is not empty, then takes at most maxItems.
+  std::vector<T> takeUpTo(size_t maxItems)
+  {
+    assert(maxItems > 0);
+    std::vector<T> items;
+    MutexLockGuard lock(mutex_);
+    waitForItems();
+    moveTo(&items, maxItems);
+    return items;
+  }
+
+  // Non-blocking, appends at most maxItems to *out,
+  // returns the number of items moved.
+  size_t drainTo(std::vector<T>* out, size_t maxItems = static_cast<size_t>(-1))
+  {
+    MutexLockGuard lock(mutex_);
+    return moveTo(out, maxItems);
+  }
+
   queue_type drain()
   {
     std::deque<T> queue;
@@ -83,8 +119,46 @@ class BlockingQueue : noncopyable
   }
 
  private:
+  void waitForItems() REQUIRES(mutex_)
+  {
+    while (queue_.empty())
+    {
+      ++waiters_;
+      notEmpty_.wait();
+      --waiters_;
+    }
+  }
+
+  void wakeUp(size_t items) REQUIRES(mutex_)
+  {
+    if (items >= static_cast<size_t>(waiters_))
+    {
+      notEmpty_.notifyAll();
+    }
+    else
+    {
+      for (size_t i = 0; i < items; ++i)
+      {
+        notEmpty_.notify();
+      }
+    }
+  }
+
+  size_t moveTo(std::vector<T>* out, size_t maxItems) REQUIRES(mutex_)
+  {
+    size_t n = std::min(maxItems, queue_.size());
+    out->reserve(out->size() + n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      out->push_back(std::move(queue_.front()));
+      queue_.pop_front();
+    }
+    return n;
+  }
+
   mutable MutexLock mutex_;   //需要一个互斥量，有个函数是 mutable
   Condition         notEmpty_ GUARDED_BY(mutex_);   //一个条件变量
+  int               waiters_ GUARDED_BY(mutex_);    //阻塞在 take 上的消费者个数
   queue_type        queue_ GUARDED_BY(mutex_);      //模板队列
 };  // __attribute__ ((aligned (64)));
 
@@ -6,10 +6,13 @@
 #include "muduo/base/FileUtil.h"
 #include "muduo/base/Logging.h"
 
+#include <algorithm>
+
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -64,6 +67,163 @@ size_t FileUtil::AppendFile::write(const char* logline, size_t len)
   return ::fwrite_unlocked(logline, 1, len, fp_);
 }
 
+FileUtil::DirectAppendFile::DirectAppendFile(StringArg filename, bool direct, off_t preallocate)
+  : fd_(-1),
+    direct_(direct),
+    failed_(false),
+    buffer_(NULL),
+    length_(0),
+    fileOffset_(0),
+    writtenBytes_(0),
+    syncedBytes_(0),
+    droppedBytes_(0)
+{
+  // readable for the last partial block with O_DIRECT
+  const int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+  if (direct_)
+  {
+    fd_ = ::open(filename.c_str(), flags | O_DIRECT, 0644);
+    if (fd_ < 0 && errno == EINVAL)  // eg. tmpfs
+    {
+      direct_ = false;
+    }
+  }
+  if (!direct_)
+  {
+    fd_ = ::open(filename.c_str(), flags, 0644);
+  }
+  assert(fd_ >= 0);
+
+  void* buf = NULL;
+  int ret = ::posix_memalign(&buf, kAlignment, kBufferSize);
+  assert(ret == 0); (void) ret;
+  buffer_ = static_cast<char*>(buf);
+
+  // appends to an existing file, rereading its last partial block
+  struct stat st;
+  off_t size = ::fstat(fd_, &st) == 0 ? st.st_size : 0;
+  if (size > 0)
+  {
+    fileOffset_ = size;
+    syncedBytes_ = droppedBytes_ = size;
+    if (direct_)
+    {
+      fileOffset_ = size / kAlignment * kAlignment;
+      length_ = static_cast<size_t>(size - fileOffset_);
+      if (length_ > 0 && ::pread(fd_, buffer_, kAlignment, fileOffset_) < static_cast<ssize_t>(length_))
+      {
+        fprintf(stderr, "DirectAppendFile() pread failed %s\n", strerror_tl(errno));
+        failed_ = true;
+      }
+    }
+  }
+  if (preallocate > size
+      && ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, preallocate) < 0
+      && errno != EOPNOTSUPP)
+  {
+    fprintf(stderr, "DirectAppendFile() fallocate failed %s\n", strerror_tl(errno));
+  }
+}
+
+FileUtil::DirectAppendFile::~DirectAppendFile()
+{
+  flush();
+  // frees what fallocate() preallocated beyond the end
+  if (::ftruncate(fd_, fileOffset_ + static_cast<off_t>(length_)) < 0)
+  {
+    fprintf(stderr, "DirectAppendFile::~DirectAppendFile() ftruncate failed %s\n",
+            strerror_tl(errno));
+  }
+  ::close(fd_);
+  ::free(buffer_);
+}
+
+void FileUtil::DirectAppendFile::append(const char* logline, size_t len)
+{
+  writtenBytes_ += len;
+  while (len > 0)
+  {
+    size_t n = std::min(len, kBufferSize - length_);
+    memcpy(buffer_ + length_, logline, n);
+    length_ += n;
+    logline += n;
+    len -= n;
+    if (length_ == kBufferSize)
+    {
+      write(kBufferSize);
+      fileOffset_ += kBufferSize;
+      length_ = 0;
+      writeBack();
+    }
+  }
+}
+
+// With O_DIRECT the last partial block is written padded with zeros, the
+// block stays in buffer_ to be written again. The file is not truncated
+// until closed, for ftruncate() would free the preallocation beyond the
+// end as well, so meanwhile it ends with zeros, writtenBytes() has the
+// length of the content.
+void FileUtil::DirectAppendFile::flush()
+{
+  if (length_ == 0)
+    return;
+  if (!direct_)
+  {
+    write(length_);
+    fileOffset_ += length_;
+    length_ = 0;
+    writeBack();
+    return;
+  }
+
+  size_t padded = (length_ + kAlignment - 1) / kAlignment * kAlignment;
+  memset(buffer_ + length_, 0, padded - length_);
+  write(padded);
+  size_t aligned = length_ / kAlignment * kAlignment;
+  if (aligned > 0)
+  {
+    memmove(buffer_, buffer_ + aligned, length_ - aligned);
+    fileOffset_ += aligned;
+    length_ -= aligned;
+  }
+}
+
+// buffer_[0, len) at fileOffset_
+void FileUtil::DirectAppendFile::write(size_t len)
+{
+  size_t written = 0;
+  while (!failed_ && written < len)
+  {
+    ssize_t n = ::pwrite(fd_, buffer_ + written, len - written,
+                         fileOffset_ + static_cast<off_t>(written));
+    if (n > 0)
+    {
+      written += n;
+    }
+    else if (n < 0 && errno != EINTR)
+    {
+      fprintf(stderr, "DirectAppendFile::write() failed %s\n", strerror_tl(errno));
+      failed_ = true;
+    }
+  }
+}
+
+void FileUtil::DirectAppendFile::writeBack()
+{
+  if (direct_ || fileOffset_ - syncedBytes_ < kSyncBytes)
+    return;
+  // the window started last time is likely on disk by now
+  if (syncedBytes_ > droppedBytes_)
+  {
+    ::sync_file_range(fd_, droppedBytes_, syncedBytes_ - droppedBytes_,
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    ::posix_fadvise(fd_, droppedBytes_, syncedBytes_ - droppedBytes_, POSIX_FADV_DONTNEED);
+    droppedBytes_ = syncedBytes_;
+  }
+  ::sync_file_range(fd_, syncedBytes_, fileOffset_ - syncedBytes_, SYNC_FILE_RANGE_WRITE);
+  syncedBytes_ = fileOffset_;
+}
+
 FileUtil::ReadSmallFile::ReadSmallFile(StringArg filename)
   : fd_(::open(filename.c_str(), O_RDONLY | O_CLOEXEC)),
     err_(0)
@@ -82,6 +82,49 @@ class AppendFile : noncopyable
   off_t writtenBytes_;    //已写入字符
 };
 
+// not thread safe
+// Appends with pwrite(2) from an aligned buffer, with O_DIRECT if direct
+// and the filesystem allows, bypassing the page cache. Preallocates the
+// file with fallocate(2). Without O_DIRECT, the writeback of every
+// kSyncBytes is started with sync_file_range(2) and waited for a window
+// later, then dropped from the page cache, so there are never many dirty
+// pages to flush at once. With O_DIRECT the file ends with the zeros
+// padding its last block until it is closed.
+class DirectAppendFile : noncopyable
+{
+ public:
+  DirectAppendFile(StringArg filename, bool direct, off_t preallocate);
+
+  ~DirectAppendFile();
+
+  void append(const char* logline, size_t len);
+
+  void flush();
+
+  off_t writtenBytes() const { return writtenBytes_; }
+
+  /// Whether O_DIRECT is in use.
+  bool direct() const { return direct_; }
+
+  static const size_t kBufferSize = 256*1024;
+  static const size_t kAlignment = 4096;
+  static const off_t kSyncBytes = 1024*1024;
+
+ private:
+  void write(size_t len);
+  void writeBack();
+
+  int fd_;
+  bool direct_;
+  bool failed_;           //写入出错后不再写
+  char* buffer_;          //按 kAlignment 对齐
+  size_t length_;         //buffer_ 中的字节数
+  off_t fileOffset_;      //buffer_[0] 在文件中的位置，O_DIRECT 时对齐
+  off_t writtenBytes_;    //已写入字符
+  off_t syncedBytes_;     //已开始回写的位置
+  off_t droppedBytes_;    //已回写完并从 page cache 中丢弃的位置
+};
+
 }  // namespace FileUtil
 }  // namespace muduo
 
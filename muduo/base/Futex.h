@@ -0,0 +1,44 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_FUTEX_H
+#define MUDUO_BASE_FUTEX_H
+
+#include <atomic>
+
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace muduo
+{
+namespace detail
+{
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+              "futex word must be a plain 32-bit integer");
+
+// Blocks while *addr == expected, spurious wakeups are possible.
+// timeout is relative, NULL means forever.
+inline int futexWait(std::atomic<int32_t>* addr, int32_t expected,
+                     const struct timespec* timeout = NULL)
+{
+  return static_cast<int>(::syscall(SYS_futex, reinterpret_cast<int32_t*>(addr),
+                                    FUTEX_WAIT_PRIVATE, expected, timeout, NULL, 0));
+}
+
+// Wakes at most count waiters, returns the number woken.
+inline int futexWake(std::atomic<int32_t>* addr, int count)
+{
+  return static_cast<int>(::syscall(SYS_futex, reinterpret_cast<int32_t*>(addr),
+                                    FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0));
+}
+
+}  // namespace detail
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_FUTEX_H
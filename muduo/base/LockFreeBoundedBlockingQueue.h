@@ -0,0 +1,270 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_LOCKFREEBOUNDEDBLOCKINGQUEUE_H
+#define MUDUO_BASE_LOCKFREEBOUNDEDBLOCKINGQUEUE_H
+
+#include "muduo/base/Futex.h"
+#include "muduo/base/noncopyable.h"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace muduo
+{
+
+// Drop-in replacement of BoundedBlockingQueue, a multi-producer
+// multi-consumer ring of sequence-numbered slots (Dmitry Vyukov's
+// bounded MPMC queue). put() and take() never take a lock, they
+// only sleep on a futex when the ring is full or empty.
+//
+// T must be default constructible and move assignable.
+template<typename T>
+class LockFreeBoundedBlockingQueue : noncopyable
+{
+ public:
+  explicit LockFreeBoundedBlockingQueue(int maxSize)
+    : capacity_(static_cast<size_t>(maxSize)),
+      cells_(new Cell[capacity_]),
+      tail_(0),
+      head_(0)
+  {
+    assert(maxSize > 0);
+    for (size_t i = 0; i < capacity_; ++i)
+    {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~LockFreeBoundedBlockingQueue()
+  {
+    T x;
+    while (tryTake(&x))
+    {
+    }
+  }
+
+  //生产者
+  void put(const T& x)
+  {
+    putImpl(x);
+  }
+
+  void put(T&& x)
+  {
+    putImpl(std::move(x));
+  }
+
+  //消费者
+  T take()
+  {
+    T x;
+    bool taken = tryTake(&x);
+    while (!taken)
+    {
+      taken = notEmpty_.wait([this, &x] { return tryTake(&x); });
+    }
+    notFull_.wake();
+    // pass the baton, in case puts were coalesced into our wakeup
+    if (!empty())
+    {
+      notEmpty_.wake();
+    }
+    return x;
+  }
+
+  // Non-blocking versions, return false if full/empty.
+  bool tryPut(const T& x)
+  {
+    if (!tryPutImpl(x)) return false;
+    notEmpty_.wake();
+    return true;
+  }
+
+  bool tryPut(T&& x)
+  {
+    if (!tryPutImpl(std::move(x))) return false;
+    notEmpty_.wake();
+    return true;
+  }
+
+  bool tryTake(T* out)
+  {
+    Cell* cell;
+    size_t pos = head_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &cells_[pos % capacity_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0)
+      {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false;  // empty
+      }
+      else
+      {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    T* p = cell->get();
+    *out = std::move(*p);
+    p->~T();
+    cell->sequence.store(pos + capacity_, std::memory_order_release);
+    return true;
+  }
+
+  // The following are snapshots, they may be stale once returned.
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  bool full() const
+  {
+    return size() >= capacity_;
+  }
+
+  size_t size() const
+  {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  size_t capacity() const
+  {
+    return capacity_;
+  }
+
+ private:
+  static const size_t kCacheLineSize = 64;
+
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+    T* get() { return reinterpret_cast<T*>(&storage); }
+  };
+
+  template<typename U>
+  void putImpl(U&& x)
+  {
+    bool put = tryPutImpl(std::forward<U>(x));
+    while (!put)
+    {
+      put = notFull_.wait([this, &x] { return tryPutImpl(std::forward<U>(x)); });
+    }
+    notEmpty_.wake();
+    if (!full())
+    {
+      notFull_.wake();
+    }
+  }
+
+  // x is only consumed when a slot was claimed.
+  template<typename U>
+  bool tryPutImpl(U&& x)
+  {
+    Cell* cell;
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &cells_[pos % capacity_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0)
+      {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false;  // full
+      }
+      else
+      {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    new (cell->get()) T(std::forward<U>(x));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // An event count on a futex word. wake() makes no syscall unless somebody
+  // is sleeping, and at most one wakeup is in flight at a time; the woken
+  // thread passes it on if there is more to do.
+  struct EventCount
+  {
+    EventCount()
+      : seq(0), waiters(0), pending(0)
+    {
+    }
+
+    // Sleeps once, unless ready() turns true after registering.
+    // Returns ready()'s result, i.e. false after sleeping.
+    template<typename Ready>
+    bool wait(Ready ready)
+    {
+      int32_t s = seq.load(std::memory_order_acquire);
+      waiters.fetch_add(1);
+      pending.store(0);
+      // re-check after registering, so a waker either sees us or we see its item
+      bool done = ready();
+      if (!done)
+      {
+        detail::futexWait(&seq, s);
+      }
+      waiters.fetch_sub(1);
+      pending.store(0);
+      return done;
+    }
+
+    void wake()
+    {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (waiters.load(std::memory_order_relaxed) > 0
+          && pending.exchange(1) == 0)
+      {
+        seq.fetch_add(1, std::memory_order_release);
+        detail::futexWake(&seq, 1);
+      }
+    }
+
+    std::atomic<int32_t> seq;      // futex word
+    std::atomic<int32_t> waiters;  // threads between register and return
+    std::atomic<int32_t> pending;  // a wakeup is in flight
+    char pad[kCacheLineSize - 3 * sizeof(std::atomic<int32_t>)];
+  };
+
+  const size_t capacity_;
+  std::unique_ptr<Cell[]> cells_;
+
+  // producers and consumers touch different cache lines
+  char pad0_[kCacheLineSize];
+  std::atomic<size_t> tail_;
+  char pad1_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> head_;
+  char pad2_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+  EventCount notEmpty_;  // consumers sleep here when empty
+  EventCount notFull_;   // producers sleep here when full
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_LOCKFREEBOUNDEDBLOCKINGQUEUE_H
@@ -0,0 +1,192 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/LockProfiler.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace muduo;
+
+namespace
+{
+
+struct CStrLess
+{
+  bool operator()(const char* lhs, const char* rhs) const
+  {
+    return ::strcmp(lhs, rhs) < 0;
+  }
+};
+
+typedef std::map<const char*, LockSite*, CStrLess> SiteMap;
+
+// Not a MutexLock, which would include us. Sites are created at
+// construction of named locks, possibly during static initialization,
+// so everything here is constant-initialized or created on demand.
+pthread_mutex_t g_sitesMutex = PTHREAD_MUTEX_INITIALIZER;
+SiteMap* g_sites = NULL;
+uint64_t g_startTicks = 0;
+int64_t g_startNs = 0;
+
+int64_t monotonicNs()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// calibrated against CLOCK_MONOTONIC since the first site was created
+double ticksPerUs()
+{
+  int64_t elapsedNs = monotonicNs() - g_startNs;
+  uint64_t elapsedTicks = detail::cycleClock() - g_startTicks;
+  if (elapsedNs < 1000000)
+  {
+    return 1000.0;  // cycleClock is in ns without rdtsc, roughly right for a 1GHz TSC
+  }
+  return static_cast<double>(elapsedTicks) * 1000.0 / static_cast<double>(elapsedNs);
+}
+
+// upper bound of the bucket holding the given percentile
+uint64_t percentile(const std::atomic<int64_t>* histogram, int64_t total, double p)
+{
+  if (total <= 0)
+  {
+    return 0;
+  }
+  int64_t target = static_cast<int64_t>(static_cast<double>(total) * p);
+  int64_t count = 0;
+  for (int i = 0; i < LockSite::kBuckets; ++i)
+  {
+    count += histogram[i].load(std::memory_order_relaxed);
+    if (count > target)
+    {
+      return i == 0 ? 0 : (static_cast<uint64_t>(1) << i);
+    }
+  }
+  return static_cast<uint64_t>(1) << (LockSite::kBuckets - 1);
+}
+
+bool initEnabled()
+{
+  const char* env = ::getenv("MUDUO_LOCK_PROFILE");
+  return env != NULL && ::strcmp(env, "0") != 0;
+}
+
+}  // namespace
+
+std::atomic<bool> LockProfiler::s_enabled(initEnabled());
+
+const int LockSite::kBuckets;
+const int LockSite::kHoldSampleEvery;
+
+LockSite::LockSite(const char* siteName)
+  : name(siteName),
+    acquired(0),
+    contended(0),
+    waitTicks(0)
+{
+  for (int i = 0; i < kBuckets; ++i)
+  {
+    waitHistogram[i].store(0, std::memory_order_relaxed);
+    holdHistogram[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+LockSite* LockProfiler::site(const char* name)
+{
+  ::pthread_mutex_lock(&g_sitesMutex);
+  if (g_sites == NULL)
+  {
+    g_sites = new SiteMap;  // never deleted, locks may outlive static destructors
+    g_startTicks = detail::cycleClock();
+    g_startNs = monotonicNs();
+  }
+  LockSite*& site = (*g_sites)[name];
+  if (site == NULL)
+  {
+    site = new LockSite(name);
+  }
+  LockSite* result = site;
+  ::pthread_mutex_unlock(&g_sitesMutex);
+  return result;
+}
+
+string LockProfiler::report()
+{
+  std::vector<LockSite*> sites;
+  ::pthread_mutex_lock(&g_sitesMutex);
+  if (g_sites)
+  {
+    for (const auto& entry : *g_sites)
+    {
+      sites.push_back(entry.second);
+    }
+  }
+  ::pthread_mutex_unlock(&g_sitesMutex);
+
+  std::sort(sites.begin(), sites.end(), [](const LockSite* lhs, const LockSite* rhs)
+            {
+              return lhs->waitTicks.load(std::memory_order_relaxed)
+                   > rhs->waitTicks.load(std::memory_order_relaxed);
+            });
+
+  const double tpu = ticksPerUs();
+  string result;
+  char buf[512];
+  snprintf(buf, sizeof buf, "%-48s %12s %12s %8s %14s %12s %12s %12s\n",
+           "site", "acquired", "contended", "rate%", "wait_total_us",
+           "wait_p99_us", "hold_p50_us", "hold_p99_us");
+  result += buf;
+  for (const LockSite* site : sites)
+  {
+    int64_t acquired = site->acquired.load(std::memory_order_relaxed);
+    int64_t holdSamples = 0;
+    for (int i = 0; i < LockSite::kBuckets; ++i)
+    {
+      holdSamples += site->holdHistogram[i].load(std::memory_order_relaxed);
+    }
+    int64_t contended = site->contended.load(std::memory_order_relaxed);
+    snprintf(buf, sizeof buf, "%-48s %12lld %12lld %8.3f %14.1f %12.3f %12.3f %12.3f\n",
+             site->name,
+             static_cast<long long>(acquired),
+             static_cast<long long>(contended),
+             acquired > 0 ? 100.0 * static_cast<double>(contended) / static_cast<double>(acquired) : 0.0,
+             static_cast<double>(site->waitTicks.load(std::memory_order_relaxed)) / tpu,
+             static_cast<double>(percentile(site->waitHistogram, contended, 0.99)) / tpu,
+             static_cast<double>(percentile(site->holdHistogram, holdSamples, 0.50)) / tpu,
+             static_cast<double>(percentile(site->holdHistogram, holdSamples, 0.99)) / tpu);
+    result += buf;
+  }
+  return result;
+}
+
+void LockProfiler::reset()
+{
+  ::pthread_mutex_lock(&g_sitesMutex);
+  if (g_sites)
+  {
+    for (const auto& entry : *g_sites)
+    {
+      LockSite* site = entry.second;
+      site->acquired.store(0, std::memory_order_relaxed);
+      site->contended.store(0, std::memory_order_relaxed);
+      site->waitTicks.store(0, std::memory_order_relaxed);
+      for (int i = 0; i < LockSite::kBuckets; ++i)
+      {
+        site->waitHistogram[i].store(0, std::memory_order_relaxed);
+        site->holdHistogram[i].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+  ::pthread_mutex_unlock(&g_sitesMutex);
+}
@@ -0,0 +1,112 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_LOCKPROFILER_H
+#define MUDUO_BASE_LOCKPROFILER_H
+
+#include "muduo/base/Types.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <time.h>
+
+#define MUDUO_STRINGIFY_IMPL(x) #x
+#define MUDUO_STRINGIFY(x) MUDUO_STRINGIFY_IMPL(x)
+
+// Names a lock by where it is constructed, eg.
+//   Foo::Foo() : mutex_(MUDUO_LOCK_SITE) {}
+#define MUDUO_LOCK_SITE __FILE__ ":" MUDUO_STRINGIFY(__LINE__)
+
+namespace muduo
+{
+namespace detail
+{
+
+// Cheap monotonic tick counter, only differences are meaningful.
+inline uint64_t cycleClock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+}  // namespace detail
+
+// Statistics of all named MutexLocks sharing one name.
+// Histograms are log2 buckets of ticks, bucket i holds [2^(i-1), 2^i).
+// Every contended acquisition is timed, hold time is sampled.
+struct LockSite
+{
+  static const int kBuckets = 48;
+  static const int kHoldSampleEvery = 8;  // power of 2
+
+  explicit LockSite(const char* siteName);
+
+  void recordWait(uint64_t ticks)
+  {
+    contended.fetch_add(1, std::memory_order_relaxed);
+    waitTicks.fetch_add(ticks, std::memory_order_relaxed);
+    waitHistogram[bucket(ticks)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void recordAcquired(int64_t count)
+  {
+    acquired.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  void recordHold(uint64_t ticks)
+  {
+    holdHistogram[bucket(ticks)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static int bucket(uint64_t ticks)
+  {
+    int b = ticks == 0 ? 0 : 64 - __builtin_clzll(ticks);
+    return b < kBuckets ? b : kBuckets - 1;
+  }
+
+  const char* const name;
+  std::atomic<int64_t> acquired;
+  std::atomic<int64_t> contended;
+  std::atomic<uint64_t> waitTicks;
+  std::atomic<int64_t> waitHistogram[kBuckets];
+  std::atomic<int64_t> holdHistogram[kBuckets];
+};
+
+// Opt-in lock contention profiler, for MutexLocks constructed with a name.
+// Enabled by setEnabled(true) or by the MUDUO_LOCK_PROFILE environment
+// variable. When disabled, a named lock costs one extra branch.
+class LockProfiler
+{
+ public:
+  static bool enabled()
+  {
+    return s_enabled.load(std::memory_order_relaxed);
+  }
+
+  static void setEnabled(bool on)
+  {
+    s_enabled.store(on, std::memory_order_relaxed);
+  }
+
+  // Locks with the same name share one site, sites live forever.
+  static LockSite* site(const char* name);
+
+  // One line per site, sorted by total wait time, times in microseconds.
+  static string report();
+
+  static void reset();
+
+ private:
+  static std::atomic<bool> s_enabled;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_LOCKPROFILER_H
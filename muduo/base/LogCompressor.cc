@@ -0,0 +1,257 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/LogCompressor.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/Timestamp.h"
+
+#ifdef HAVE_ZLIB
+#include "muduo/base/GzipFile.h"
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+namespace
+{
+
+const int kIoprioClassIdle = 3;
+const int kIoprioClassShift = 13;
+const int kIoprioWhoProcess = 1;
+
+bool endsWith(const string& s, const char* suffix)
+{
+  size_t n = strlen(suffix);
+  return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// basename.YYYYMMDD-HHMMSS.hostname.pid.log[.gz] of LogFile, but not
+// basename.spill.YYYYMMDD-HHMMSS... of the spill file of AsyncLogging.
+bool isLogFile(const string& name, const string& basename)
+{
+  const char kTime[] = "YYYYMMDD-HHMMSS.";
+  const size_t kTimeLength = sizeof kTime - 1;
+  if (name.size() < basename.size() + 1 + kTimeLength
+      || name.compare(0, basename.size(), basename) != 0
+      || name[basename.size()] != '.')
+    return false;
+  const char* time = name.c_str() + basename.size() + 1;
+  for (size_t i = 0; i < kTimeLength; ++i)
+  {
+    if (kTime[i] == '-' || kTime[i] == '.' ? time[i] != kTime[i] : !isdigit(time[i]))
+      return false;
+  }
+  return endsWith(name, ".log") || endsWith(name, ".log.gz");
+}
+
+string withoutGz(const string& name)
+{
+  return endsWith(name, ".gz") ? name.substr(0, name.size() - 3) : name;
+}
+
+}  // namespace
+
+LogCompressor::LogCompressor(const string& basename)
+  : basename_(basename),
+    bytesPerSecond_(16*1024*1024),
+    maxFiles_(0),
+    maxBytes_(0),
+    running_(false),
+    thread_(std::bind(&LogCompressor::threadFunc, this), "LogCompressor"),
+    compressedFiles_(0),
+    removedFiles_(0)
+{
+}
+
+LogCompressor::~LogCompressor()
+{
+  if (running_)
+  {
+    stop();
+  }
+}
+
+void LogCompressor::start()
+{
+  assert(!running_);
+  running_ = true;
+  thread_.start();
+}
+
+void LogCompressor::stop()
+{
+  assert(running_);
+  running_ = false;
+  queue_.put(string());
+  thread_.join();
+}
+
+void LogCompressor::add(const string& filename)
+{
+  assert(!filename.empty());
+  queue_.put(filename);
+}
+
+void LogCompressor::threadFunc()
+{
+  // per thread on Linux
+  pid_t tid = CurrentThread::tid();
+  if (::setpriority(PRIO_PROCESS, static_cast<id_t>(tid), 19) < 0)
+  {
+    LOG_SYSERR << "LogCompressor setpriority";
+  }
+  if (::syscall(SYS_ioprio_set, kIoprioWhoProcess, tid,
+                kIoprioClassIdle << kIoprioClassShift) < 0)
+  {
+    LOG_SYSERR << "LogCompressor ioprio_set";
+  }
+
+  removeOldFiles();
+  for (;;)
+  {
+    string filename = queue_.take();
+    if (filename.empty())
+      break;
+    lastClosed_ = withoutGz(filename);
+    // already compressed by LogFile
+    if (!endsWith(filename, ".gz") && compress(filename))
+    {
+      compressedFiles_.fetch_add(1, std::memory_order_relaxed);
+    }
+    removeOldFiles();
+  }
+}
+
+// To filename.gz through a temporary file, then removes filename.
+bool LogCompressor::compress(const string& filename)
+{
+#ifdef HAVE_ZLIB
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    LOG_SYSERR << "LogCompressor open " << filename;
+    return false;
+  }
+  // the page cache of the input is of no more use
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  string tmpname = filename + ".gz.tmp";
+  bool ok = true;
+  {
+    GzipFile gz = GzipFile::openForWriteTruncate(tmpname);
+    if (!gz.valid())
+    {
+      LOG_SYSERR << "LogCompressor gzopen " << tmpname;
+      ::close(fd);
+      return false;
+    }
+    gz.setBuffer(64*1024);
+    char buf[64*1024];
+    int64_t total = 0;
+    Timestamp start(Timestamp::now());
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0)
+    {
+      if (gz.write(StringPiece(buf, static_cast<int>(n))) != n)
+      {
+        LOG_ERROR << "LogCompressor gzwrite " << tmpname;
+        ok = false;
+        break;
+      }
+      total += n;
+      if (bytesPerSecond_ > 0)
+      {
+        double ahead = static_cast<double>(total) / static_cast<double>(bytesPerSecond_)
+                       - timeDifference(Timestamp::now(), start);
+        if (ahead > 0)
+        {
+          ::usleep(static_cast<useconds_t>(ahead * 1e6));
+        }
+      }
+    }
+    if (n < 0)
+    {
+      LOG_SYSERR << "LogCompressor read " << filename;
+      ok = false;
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+  if (ok && ::rename(tmpname.c_str(), (filename + ".gz").c_str()) == 0)
+  {
+    ::unlink(filename.c_str());
+    return true;
+  }
+  ::unlink(tmpname.c_str());
+  return false;
+#else
+  (void) filename;
+  return false;
+#endif
+}
+
+// LogFile names start with the time, so the order of names is the order
+// of files. The file being written is never removed.
+void LogCompressor::removeOldFiles()
+{
+  if (maxFiles_ <= 0 && maxBytes_ <= 0)
+    return;
+  DIR* dir = ::opendir(".");
+  if (!dir)
+  {
+    LOG_SYSERR << "LogCompressor opendir";
+    return;
+  }
+  std::vector<std::pair<string, int64_t>> files;
+  int64_t total = 0;
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    string name(entry->d_name);
+    struct stat st;
+    if (isLogFile(name, basename_)
+        && ::stat(name.c_str(), &st) == 0)
+    {
+      files.push_back(std::make_pair(name, static_cast<int64_t>(st.st_size)));
+      total += st.st_size;
+    }
+  }
+  ::closedir(dir);
+  std::sort(files.begin(), files.end());
+
+  // the newest file and those after the last one closed may be open
+  size_t removable = files.empty() ? 0 : files.size() - 1;
+  while (removable > 0 && !lastClosed_.empty()
+         && withoutGz(files[removable - 1].first) > lastClosed_)
+  {
+    --removable;
+  }
+  int count = static_cast<int>(files.size());
+  for (size_t i = 0; i < removable; ++i)
+  {
+    if ((maxFiles_ <= 0 || count <= maxFiles_) && (maxBytes_ <= 0 || total <= maxBytes_))
+      break;
+    if (::unlink(files[i].first.c_str()) == 0)
+    {
+      removedFiles_.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+      LOG_SYSERR << "LogCompressor unlink " << files[i].first;
+    }
+    --count;
+    total -= files[i].second;
+  }
+}
@@ -0,0 +1,84 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_LOGCOMPRESSOR_H
+#define MUDUO_BASE_LOGCOMPRESSOR_H
+
+#include "muduo/base/BlockingQueue.h"
+#include "muduo/base/Thread.h"
+#include "muduo/base/Types.h"
+
+#include <atomic>
+
+namespace muduo
+{
+
+///
+/// Compresses rolled log files to .gz in a background thread, and removes
+/// the oldest files of basename beyond the retention limits.
+///
+/// The thread runs at nice 19 in the idle I/O class and reads at most
+/// setRateLimit() bytes a second, so it doesn't compete with the service
+/// for CPU or disk. Files are compressed only if muduo is built with zlib,
+/// the retention applies anyway.
+///
+/// LogCompressor compressor(basename);
+/// compressor.setRetention(30, 0);
+/// compressor.start();
+/// asyncLog.setRollCallback(std::bind(&LogCompressor::add, &compressor, _1));
+///
+class LogCompressor : noncopyable
+{
+ public:
+  /// Files of the current directory named basename.YYYYMMDD-HHMMSS.*.log
+  /// or .log.gz, as LogFile names them.
+  explicit LogCompressor(const string& basename);
+  ~LogCompressor();
+
+  /// Bytes of input a second, 0 for unlimited, default is 16MB.
+  /// Must be called before start().
+  void setRateLimit(int64_t bytesPerSecond)
+  { bytesPerSecond_ = bytesPerSecond; }
+
+  /// Keeps at most maxFiles files and maxBytes bytes of them, 0 for
+  /// unlimited. The newest file and the files after the last one added
+  /// are always kept, they may be open.
+  /// Must be called before start().
+  void setRetention(int maxFiles, int64_t maxBytes)
+  {
+    maxFiles_ = maxFiles;
+    maxBytes_ = maxBytes;
+  }
+
+  void start();
+  /// Compresses the files added so far and stops the thread.
+  void stop();
+
+  /// A closed log file to compress, thread safe, for LogFile::setRollCallback().
+  void add(const string& filename);
+
+  int64_t compressedFiles() const { return compressedFiles_.load(std::memory_order_relaxed); }
+  int64_t removedFiles() const { return removedFiles_.load(std::memory_order_relaxed); }
+
+ private:
+  void threadFunc();
+  bool compress(const string& filename);
+  void removeOldFiles();
+
+  const string basename_;
+  int64_t bytesPerSecond_;
+  int maxFiles_;
+  int64_t maxBytes_;
+  bool running_;
+  Thread thread_;
+  BlockingQueue<string> queue_;       // "" to stop
+  std::atomic<int64_t> compressedFiles_;
+  std::atomic<int64_t> removedFiles_;
+  string lastClosed_;                 // without .gz, used by the thread only
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_LOGCOMPRESSOR_H
@@ -12,28 +12,79 @@
 #include <stdio.h>
 #include <time.h>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 using namespace muduo;
 
+#ifdef HAVE_ZLIB
+// Each flush ends a gzip member and deflateReset() starts the next one,
+// a file of members is a valid gzip file, and all members but the last
+// one being written survive a crash.
+struct LogFile::Deflater
+{
+  explicit Deflater(int level)
+  {
+    memZero(&stream, sizeof stream);
+    // 16 for the gzip header and trailer
+    int ret = ::deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    assert(ret == Z_OK); (void) ret;
+  }
+
+  ~Deflater()
+  {
+    ::deflateEnd(&stream);
+  }
+
+  z_stream stream;
+  bool pending = false;                 //当前 member 有未结束的数据
+  char output[64*1024];
+};
+#else
+struct LogFile::Deflater
+{
+};
+#endif
+
 LogFile::LogFile(const string& basename,
                  off_t rollSize,
                  bool threadSafe,
                  int flushInterval,
-                 int checkEveryN)
+                 int checkEveryN,
+                 Writer writer,
+                 int gzipLevel)
   : basename_(basename),
     rollSize_(rollSize),
     flushInterval_(flushInterval),
     checkEveryN_(checkEveryN),
+    writer_(writer),
+    gzipLevel_(gzipLevel),
     count_(0),
+    rollCount_(0),
     mutex_(threadSafe ? new MutexLock : NULL),
     startOfPeriod_(0),
     lastRoll_(0),
     lastFlush_(0)
 {
   assert(basename.find('/') == string::npos);   //如果不是一个目录，报错
+#ifndef HAVE_ZLIB
+  if (gzipLevel_ != 0)
+  {
+    fprintf(stderr, "LogFile: built without zlib, %s is not compressed\n", basename.c_str());
+  }
+#endif
   rollFile();
 }
 
-LogFile::~LogFile() = default;
+LogFile::~LogFile()
+{
+  //结束最后一个 gzip member
+  if (deflater_)
+  {
+    deflate_unlocked(NULL, 0, true);
+  }
+}
 
 void LogFile::append(const char* logline, int len)
 {
@@ -53,22 +104,78 @@ void LogFile::flush()
   if (mutex_)
   {
     MutexLockGuard lock(*mutex_);
-    file_->flush();
+    flush_unlocked();
   }
   else
   {
+    flush_unlocked();
+  }
+}
+
+void LogFile::flush_unlocked()
+{
+  if (deflater_)
+    deflate_unlocked(NULL, 0, true);
+  if (directFile_)
+    directFile_->flush();
+  else
     file_->flush();
+}
+
+off_t LogFile::writtenBytes() const
+{
+  return directFile_ ? directFile_->writtenBytes() : file_->writtenBytes();
+}
+
+void LogFile::write_unlocked(const char* data, size_t len)
+{
+  if (directFile_)
+    directFile_->append(data, len);
+  else
+    file_->append(data, len);
+}
+
+void LogFile::deflate_unlocked(const char* data, size_t len, bool finish)
+{
+#ifdef HAVE_ZLIB
+  Deflater& d = *deflater_;
+  if (finish && !d.pending)
+    return;
+  d.pending = true;
+  d.stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  d.stream.avail_in = static_cast<uInt>(len);
+  int ret = Z_OK;
+  do
+  {
+    d.stream.next_out = reinterpret_cast<Bytef*>(d.output);
+    d.stream.avail_out = sizeof d.output;
+    ret = ::deflate(&d.stream, finish ? Z_FINISH : Z_NO_FLUSH);
+    assert(ret != Z_STREAM_ERROR);
+    write_unlocked(d.output, sizeof d.output - d.stream.avail_out);
+  } while (d.stream.avail_out == 0);
+  assert(d.stream.avail_in == 0);
+  if (finish)
+  {
+    assert(ret == Z_STREAM_END);
+    ::deflateReset(&d.stream);
+    d.pending = false;
   }
+#else
+  (void) data; (void) len; (void) finish;
+#endif
 }
 
 void LogFile::append_unlocked(const char* logline, int len)
 {
-  //将字符串加入文件缓冲区中
-  file_->append(logline, len);
+  //将字符串加入文件缓冲区中，压缩时先经过 deflater_
+  if (deflater_)
+    deflate_unlocked(logline, len, false);
+  else
+    write_unlocked(logline, len);
 
   //如果文件写满了，就滚动日志
   //缓冲区写满了会自动 flush
-  if (file_->writtenBytes() > rollSize_)
+  if (writtenBytes() > rollSize_)
   {
     rollFile();
   }
@@ -91,7 +198,7 @@ void LogFile::append_unlocked(const char* logline, int len)
       else if (now - lastFlush_ > flushInterval_)
       {
         lastFlush_ = now;
-        file_->flush();
+        flush_unlocked();
       }
     }
   }
@@ -103,6 +210,12 @@ bool LogFile::rollFile()
 
   //filename 是目录名+日期+主机名+pid+.log
   string filename = getLogFileName(basename_, &now);
+#ifdef HAVE_ZLIB
+  if (gzipLevel_ != 0)
+  {
+    filename += ".gz";
+  }
+#endif
   
   //start 等价于 now - (now % kRollPerSeconds_)
   //将时间调整为当前零点
@@ -113,8 +226,35 @@ bool LogFile::rollFile()
     lastRoll_ = now;
     lastFlush_ = now;
     startOfPeriod_ = start;   
+    //旧文件的最后一个 gzip member 要在关闭前结束
+    if (deflater_)
+    {
+      deflate_unlocked(NULL, 0, true);
+    }
+#ifdef HAVE_ZLIB
+    else if (gzipLevel_ != 0)
+    {
+      deflater_.reset(new Deflater(gzipLevel_));
+    }
+#endif
     //改变 file_ 的内容
-    file_.reset(new FileUtil::AppendFile(filename));    
+    if (writer_ == kStdio)
+    {
+      file_.reset(new FileUtil::AppendFile(filename));
+    }
+    else
+    {
+      // the old file is closed first, giving back its preallocation
+      directFile_.reset();
+      directFile_.reset(new FileUtil::DirectAppendFile(filename, writer_ == kDirect, rollSize_));
+    }
+    ++rollCount_;
+    //通知旧文件已经关闭
+    filename_.swap(filename);
+    if (rollCallback_ && !filename.empty())
+    {
+      rollCallback_(filename);
+    }
     return true;
   }
   return false;
@@ -9,6 +9,7 @@
 #include "muduo/base/Mutex.h"
 #include "muduo/base/Types.h"
 
+#include <functional>
 #include <memory>
 
 namespace muduo
@@ -17,24 +18,48 @@ namespace muduo
 namespace FileUtil
 {
 class AppendFile;
+class DirectAppendFile;
 }
 
 class LogFile : noncopyable
 {
  public:
+  typedef std::function<void (const string& filename)> RollCallback;
+
+  enum Writer
+  {
+    kStdio,     // FileUtil::AppendFile, through a FILE
+    kPwrite,    // FileUtil::DirectAppendFile, preallocated, smooth writeback
+    kDirect,    // kPwrite with O_DIRECT where the filesystem allows
+  };
+
   LogFile(const string& basename,               //文件基本名称
           off_t rollSize,                       //一次最大刷新字节数
           bool threadSafe = true,               //通过对写入操作加锁，来决定是否线程安全
           int flushInterval = 3,                //隔多少毫秒刷新一次
-          int checkEveryN = 1024);              //文件最大行数
+          int checkEveryN = 1024,               //文件最大行数
+          Writer writer = kStdio,               //写文件的方式
+          int gzipLevel = 0);                   //gzip 压缩级别，0 不压缩
   ~LogFile();
 
   void append(const char* logline, int len);
+  /// With gzipLevel, ends the gzip member of what was appended since the
+  /// last flush, so the file is readable by gzip -d up to here.
   void flush();
   bool rollFile();
+  /// Files started so far, including the first one.
+  int rollCount() const { return rollCount_; }
+  /// Called with the name of the file just closed whenever a new file is
+  /// started, under the lock of LogFile, e.g. LogCompressor::add.
+  void setRollCallback(const RollCallback& cb)
+  { rollCallback_ = cb; }
 
  private:
   void append_unlocked(const char* logline, int len);
+  void flush_unlocked();
+  void write_unlocked(const char* data, size_t len);
+  void deflate_unlocked(const char* data, size_t len, bool finish);
+  off_t writtenBytes() const;
 
   static string getLogFileName(const string& basename, time_t* now);
 
@@ -42,15 +67,23 @@ class LogFile : noncopyable
   const off_t rollSize_;                //一个文件中允许的最大字节数
   const int flushInterval_;             //刷新频率
   const int checkEveryN_;               //允许停留在 buffer 的最大日志行数
+  const Writer writer_;                 //写文件的方式
+  const int gzipLevel_;                 //gzip 压缩级别
 
   int count_;                           //目前写入的行数
+  int rollCount_;                       //已经创建的文件数
+  string filename_;                     //当前文件名
+  RollCallback rollCallback_;           //旧文件关闭后的回调
 
   std::unique_ptr<MutexLock> mutex_;    //封装的互斥锁
   time_t startOfPeriod_;                //开始记录日志时间（调整至零点时间）单位是秒
   time_t lastRoll_;                     //上一次滚动日志文件的时间
   time_t lastFlush_;                    //上一次刷新的时间
   
-  std::unique_ptr<FileUtil::AppendFile> file_;  //文件缓冲区
+  std::unique_ptr<FileUtil::AppendFile> file_;  //文件缓冲区，kStdio
+  std::unique_ptr<FileUtil::DirectAppendFile> directFile_;  //kPwrite 和 kDirect
+  struct Deflater;
+  std::unique_ptr<Deflater> deflater_;  //gzipLevel_ 不为 0 时压缩
 
   const static int kRollPerSeconds_ = 60*60*24;
 };
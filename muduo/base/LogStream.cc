@@ -6,6 +6,7 @@
 #include "muduo/base/LogStream.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <type_traits>
 #include <assert.h>
@@ -42,32 +43,58 @@ static_assert(sizeof(digits) == 20, "wrong number of digits");
 const char digitsHex[] = "0123456789ABCDEF";
 static_assert(sizeof digitsHex == 17, "wrong number of digitsHex");
 
-// Efficient Integer to String Conversions, by Matthew Wilson.
-// 将整数转换到字符串中
-// value 可正可负
+const char digitPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+static_assert(sizeof(digitPairs) == 201, "wrong number of digitPairs");
+
+// Two digits a division, written backwards from the end of a local
+// buffer, then copied.
+// 将整数转换到字符串中，value 可正可负，返回元素个数
 template<typename T>
 size_t convert(char buf[], T value)
 {
-  T i = value;
-  char* p = buf;
-
-  do
+  typedef typename std::make_unsigned<T>::type U;
+  // negation in unsigned is well defined for the minimum value
+  U i = value < 0 ? static_cast<U>(static_cast<U>(0) - static_cast<U>(value))
+                  : static_cast<U>(value);
+  char tmp[24];
+  char* const end = tmp + sizeof tmp;
+  char* p = end;
+
+  while (i >= 100)
   {
-    int lsd = static_cast<int>(i % 10);
-    i /= 10;
-    *p++ = zero[lsd];
-  } while (i != 0);
-
+    unsigned r = static_cast<unsigned>(i % 100);
+    i /= 100;
+    p -= 2;
+    memcpy(p, digitPairs + 2 * r, 2);
+  }
+  if (i >= 10)
+  {
+    p -= 2;
+    memcpy(p, digitPairs + 2 * i, 2);
+  }
+  else
+  {
+    *--p = zero[i];
+  }
   if (value < 0)
   {
-    *p++ = '-';
+    *--p = '-';
   }
-  *p = '\0';
-  //将[buf, p) 中间的元素反转
-  std::reverse(buf, p);
 
-  //返回元素个数
-  return p - buf;
+  size_t len = end - p;
+  memcpy(buf, p, len);
+  buf[len] = '\0';
+  return len;
 }
 
 size_t convertHex(char buf[], uintptr_t value)
@@ -88,7 +115,359 @@ size_t convertHex(char buf[], uintptr_t value)
   return p - buf;
 }
 
+// Shortest digits that read back to the same double or float, by Grisu2 of
+// Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+// with Integers", after the implementation in RapidJSON by Milo Yip.
+// About one double in two thousand gets a digit or two more than the
+// shortest, it still reads back the same.
+namespace dtoa
+{
+
+const int kSignificandBits = 52;
+const int kExponentBias = 0x3FF + kSignificandBits;
+const uint64_t kExponentMask = UINT64_C(0x7FF0000000000000);
+const uint64_t kSignificandMask = UINT64_C(0x000FFFFFFFFFFFFF);
+const uint64_t kHiddenBit = UINT64_C(0x0010000000000000);
+
+const int kFloatSignificandBits = 23;
+const int kFloatExponentBias = 0x7F + kFloatSignificandBits;
+const uint32_t kFloatExponentMask = 0x7F800000;
+const uint32_t kFloatSignificandMask = 0x007FFFFF;
+const uint32_t kFloatHiddenBit = 0x00800000;
+
+// f * 2^e
+struct DiyFp
+{
+  DiyFp(uint64_t fp, int exp) : f(fp), e(exp) { }
+
+  explicit DiyFp(double d)
+  {
+    uint64_t u;
+    memcpy(&u, &d, sizeof u);
+    int biasedExponent = static_cast<int>((u & kExponentMask) >> kSignificandBits);
+    uint64_t significand = u & kSignificandMask;
+    if (biasedExponent != 0)
+    {
+      f = significand + kHiddenBit;
+      e = biasedExponent - kExponentBias;
+    }
+    else  // subnormal
+    {
+      f = significand;
+      e = 1 - kExponentBias;
+    }
+  }
+
+  explicit DiyFp(float v)
+  {
+    uint32_t u;
+    memcpy(&u, &v, sizeof u);
+    int biasedExponent = static_cast<int>((u & kFloatExponentMask) >> kFloatSignificandBits);
+    uint32_t significand = u & kFloatSignificandMask;
+    if (biasedExponent != 0)
+    {
+      f = significand + kFloatHiddenBit;
+      e = biasedExponent - kFloatExponentBias;
+    }
+    else  // subnormal
+    {
+      f = significand;
+      e = 1 - kFloatExponentBias;
+    }
+  }
+
+  DiyFp operator-(const DiyFp& rhs) const
+  {
+    return DiyFp(f - rhs.f, e);
+  }
+
+  // upper 64 bits of the product, rounded
+  DiyFp operator*(const DiyFp& rhs) const
+  {
+    const uint64_t kMask32 = 0xFFFFFFFF;
+    uint64_t a = f >> 32, b = f & kMask32;
+    uint64_t c = rhs.f >> 32, d = rhs.f & kMask32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & kMask32) + (bc & kMask32);
+    tmp += UINT64_C(1) << 31;
+    return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+  }
+
+  // f != 0
+  DiyFp normalize() const
+  {
+    int shift = __builtin_clzll(f);
+    return DiyFp(f << shift, e - shift);
+  }
+
+  // the halfway points to the neighbours, with the exponent of plus,
+  // hiddenBit is of double or float
+  void normalizedBoundaries(uint64_t hiddenBit, DiyFp* minus, DiyFp* plus) const
+  {
+    DiyFp pl = DiyFp((f << 1) + 1, e - 1).normalize();
+    // the lower neighbour is closer at a power of two
+    DiyFp mi = f == hiddenBit ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *minus = mi;
+    *plus = pl;
+  }
+
+  uint64_t f;
+  int e;
+};
+
+// 10^k for k in [-348, 340] step 8, normalized
+const uint64_t kCachedPowersF[] =
+{
+  UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x8b16fb203055ac76),
+  UINT64_C(0xcf42894a5dce35ea), UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df),
+  UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f), UINT64_C(0xbe5691ef416bd60c),
+  UINT64_C(0x8dd01fad907ffc3c), UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+  UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d), UINT64_C(0x823c12795db6ce57),
+  UINT64_C(0xc21094364dfb5637), UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7),
+  UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5), UINT64_C(0xb23867fb2a35b28e),
+  UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+  UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6), UINT64_C(0xf3e2f893dec3f126),
+  UINT64_C(0xb5b5ada8aaff80b8), UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053),
+  UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd), UINT64_C(0xa6dfbd9fb8e5b88f),
+  UINT64_C(0xf8a95fcf88747d94), UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+  UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac), UINT64_C(0xe45c10c42a2b3b06),
+  UINT64_C(0xaa242499697392d3), UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb),
+  UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c), UINT64_C(0x9c40000000000000),
+  UINT64_C(0xe8d4a51000000000), UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+  UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70), UINT64_C(0xd5d238a4abe98068),
+  UINT64_C(0x9f4f2726179a2245), UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8),
+  UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a), UINT64_C(0x924d692ca61be758),
+  UINT64_C(0xda01ee641a708dea), UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+  UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2), UINT64_C(0xc83553c5c8965d3d),
+  UINT64_C(0x952ab45cfa97a0b3), UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25),
+  UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece), UINT64_C(0x88fcf317f22241e2),
+  UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+  UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0xbb764c4ca7a44410),
+  UINT64_C(0x8bab8eefb6409c1a), UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129),
+  UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429), UINT64_C(0x80444b5e7aa7cf85),
+  UINT64_C(0xbf21e44003acdd2d), UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+  UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9), UINT64_C(0xaf87023b9bf0ee6b),
+};
+
+const int16_t kCachedPowersE[] =
+{
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+  -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+  -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+  -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+  -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+  109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+  375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+  641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+  907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static_assert(sizeof kCachedPowersF / sizeof kCachedPowersF[0]
+              == sizeof kCachedPowersE / sizeof kCachedPowersE[0], "cached powers");
+
+// c = 10^-k so that c * 2^e has its exponent in [-60, -32]
+DiyFp cachedPower(int e, int* k)
+{
+  double dk = (-61 - e) * 0.30102999566398114 + 347;  // log10(2)
+  int ik = static_cast<int>(dk);
+  if (dk - ik > 0.0)
+    ik++;
+  int index = (ik >> 3) + 1;
+  *k = -(-348 + index * 8);
+  return DiyFp(kCachedPowersF[index], kCachedPowersE[index]);
+}
+
+const uint64_t kPow10[] =
+{
+  UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+  UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+  UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+  UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+  UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+  UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+  UINT64_C(10000000000000000000)
+};
+
+int countDecimalDigits(uint32_t n)
+{
+  int digits = 1;
+  while (digits < 10 && n >= kPow10[digits])
+    ++digits;
+  return digits;
+}
+
+// Moves the last digit towards w while it stays within the boundaries.
+void grisuRound(char* buffer, int len, uint64_t delta, uint64_t rest,
+                uint64_t tenKappa, uint64_t wpW)
+{
+  while (rest < wpW && delta - rest >= tenKappa &&
+         (rest + tenKappa < wpW || wpW - rest > rest + tenKappa - wpW))
+  {
+    buffer[len - 1]--;
+    rest += tenKappa;
+  }
+}
+
+void digitGen(const DiyFp& w, const DiyFp& mp, uint64_t delta,
+              char* buffer, int* len, int* k)
+{
+  const DiyFp one(UINT64_C(1) << -mp.e, mp.e);
+  const DiyFp wpW = mp - w;
+  uint32_t p1 = static_cast<uint32_t>(mp.f >> -one.e);
+  uint64_t p2 = mp.f & (one.f - 1);
+  int kappa = countDecimalDigits(p1);
+  *len = 0;
+
+  // integral part
+  while (kappa > 0)
+  {
+    uint32_t d = static_cast<uint32_t>(p1 / kPow10[kappa - 1]);
+    p1 = static_cast<uint32_t>(p1 % kPow10[kappa - 1]);
+    if (d || *len)
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    kappa--;
+    uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+    if (rest <= delta)
+    {
+      *k += kappa;
+      grisuRound(buffer, *len, delta, rest, kPow10[kappa] << -one.e, wpW.f);
+      return;
+    }
+  }
+
+  // fractional part
+  for (;;)
+  {
+    p2 *= 10;
+    delta *= 10;
+    char d = static_cast<char>(p2 >> -one.e);
+    if (d || *len)
+      buffer[(*len)++] = static_cast<char>('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta)
+    {
+      *k += kappa;
+      int index = -kappa;
+      grisuRound(buffer, *len, delta, p2, one.f, wpW.f * (index < 20 ? kPow10[index] : 0));
+      return;
+    }
+  }
+}
+
+// v > 0 and finite, value is buffer[0, len) * 10^k
+template<typename T>
+void grisu2(T v, char* buffer, int* len, int* k)
+{
+  const DiyFp d(v);
+  DiyFp wMinus(0, 0), wPlus(0, 0);
+  d.normalizedBoundaries(sizeof(T) == sizeof(float) ? kFloatHiddenBit : kHiddenBit,
+                         &wMinus, &wPlus);
+  const DiyFp c = cachedPower(wPlus.e, k);
+  const DiyFp w = d.normalize() * c;
+  DiyFp wp = wPlus * c;
+  DiyFp wm = wMinus * c;
+  wm.f++;
+  wp.f--;
+  digitGen(w, wp, wp.f - wm.f, buffer, len, k);
+}
+
+char* writeExponent(char* p, int exponent)
+{
+  *p++ = 'e';
+  *p++ = exponent < 0 ? '-' : '+';
+  if (exponent < 0)
+    exponent = -exponent;
+  if (exponent >= 100)
+  {
+    *p++ = static_cast<char>('0' + exponent / 100);
+    exponent %= 100;
+  }
+  memcpy(p, digitPairs + 2 * exponent, 2);
+  return p + 2;
+}
+
+}  // namespace dtoa
+
+// Shortest round trip digits of T, laid out as %g does: the scientific
+// notation when the exponent is below -4 or above 16.
+template<typename T>
+size_t formatFloating(char buf[], T value)
+{
+  char* p = buf;
+  if (std::signbit(value))
+  {
+    *p++ = '-';
+    value = -value;
+  }
+  if (std::isnan(value))
+  {
+    // "-nan" like printf
+    memcpy(p, "nan", 4);
+    return p + 3 - buf;
+  }
+  if (std::isinf(value))
+  {
+    memcpy(p, "inf", 4);
+    return p + 3 - buf;
+  }
+  if (value == 0)
+  {
+    memcpy(p, "0", 2);
+    return p + 1 - buf;
+  }
+
+  char decimals[20];
+  int len = 0;
+  int k = 0;
+  dtoa::grisu2(value, decimals, &len, &k);
+  // value is 0.ddd * 10^(len + k), exponent of the first digit
+  int exponent = len + k - 1;
+
+  if (exponent < -4 || exponent > 16)
+  {
+    *p++ = decimals[0];
+    if (len > 1)
+    {
+      *p++ = '.';
+      memcpy(p, decimals + 1, len - 1);
+      p += len - 1;
+    }
+    p = dtoa::writeExponent(p, exponent);
+  }
+  else if (exponent < 0)
+  {
+    // 0.000ddd
+    memcpy(p, "0.0000", 1 - exponent);
+    p += 1 - exponent;
+    memcpy(p, decimals, len);
+    p += len;
+  }
+  else if (len <= exponent + 1)
+  {
+    // ddd000
+    memcpy(p, decimals, len);
+    p += len;
+    memset(p, '0', exponent + 1 - len);
+    p += exponent + 1 - len;
+  }
+  else
+  {
+    // ddd.ddd
+    memcpy(p, decimals, exponent + 1);
+    p += exponent + 1;
+    *p++ = '.';
+    memcpy(p, decimals + exponent + 1, len - exponent - 1);
+    p += len - exponent - 1;
+  }
+  *p = '\0';
+  return p - buf;
+}
+
 template class FixedBuffer<kSmallBuffer>;
+template class FixedBuffer<kMediumBuffer>;
 template class FixedBuffer<kLargeBuffer>;
 
 }  // namespace detail
@@ -317,11 +696,21 @@ LogStream& LogStream::operator<<(const void* p)
 }
 
 // FIXME: replace this with Grisu3 by Florian Loitsch.
+LogStream& LogStream::operator<<(float v)
+{
+  if (buffer_.avail() >= kMaxNumericSize)
+  {
+    size_t len = formatFloating(buffer_.current(), v);
+    buffer_.add(len);
+  }
+  return *this;
+}
+
 LogStream& LogStream::operator<<(double v)
 {
   if (buffer_.avail() >= kMaxNumericSize)
   {
-    int len = snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v);
+    size_t len = formatFloating(buffer_.current(), v);
     buffer_.add(len);
   }
   return *this;
@@ -19,6 +19,7 @@ namespace detail
 {
 
 const int kSmallBuffer = 4000;
+const int kMediumBuffer = 4000*64;
 const int kLargeBuffer = 4000*1000;
 
 //缓冲区类
@@ -119,11 +120,8 @@ class LogStream : noncopyable
 
   self& operator<<(const void*);
 
-  self& operator<<(float v)
-  {
-    *this << static_cast<double>(v);
-    return *this;
-  }
+  // shortest digits that read back to the same float or double
+  self& operator<<(float);
   self& operator<<(double);
   // self& operator<<(long double);
 
@@ -6,14 +6,19 @@
 #include "muduo/base/Logging.h"
 
 #include "muduo/base/CurrentThread.h"
+#include "muduo/base/Mutex.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/base/TimeZone.h"
 
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
+#include <algorithm>
+#include <map>
 #include <sstream>
+#include <vector>
 
 namespace muduo
 {
@@ -36,8 +41,12 @@ class LoggerImpl
 */
 
 __thread char t_errnobuf[512];
-__thread char t_time[64];       //格式化后的时间
+__thread char t_time[64];       //格式化后的时间，"YYYYMMDD HH:MM:SS"
 __thread time_t t_lastSecond;   //每个线程所拥有的时间
+__thread time_t t_lastMinute;   //t_time 前 15 个字符对应的 UTC 分钟
+__thread int t_secondOffset;    //该分钟内本地秒数减去 UTC 秒数
+__thread int t_timeZoneVersion; //t_time 所用时区的版本
+__thread Logger::LogLevel t_outputLevel = Logger::INFO;  //正在输出的日志级别
 
 const char* strerror_tl(int savedErrno)
 {
@@ -55,9 +64,6 @@ Logger::LogLevel initLogLevel()
     return Logger::INFO;
 }
 
-//定义日志级别
-Logger::LogLevel g_logLevel = initLogLevel();
-
 const char* LogLevelName[Logger::NUM_LOG_LEVELS] =
 {
   "TRACE ",
@@ -68,6 +74,54 @@ const char* LogLevelName[Logger::NUM_LOG_LEVELS] =
   "FATAL ",
 };
 
+bool parseLogLevel(const string& name, Logger::LogLevel* level)
+{
+  for (int i = 0; i < Logger::NUM_LOG_LEVELS; ++i)
+  {
+    string levelName(LogLevelName[i]);
+    levelName.erase(levelName.find_last_not_of(' ') + 1);
+    if (name == levelName)
+    {
+      *level = static_cast<Logger::LogLevel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Modules register in static initializers of any source file,
+// so this is created on first use and never destroyed.
+struct LogModules
+{
+  LogModules() : level(initLogLevel()) { }
+
+  MutexLock mutex;
+  Logger::LogLevel level GUARDED_BY(mutex);
+  std::vector<detail::LogModule*> modules GUARDED_BY(mutex);
+  std::map<string, Logger::LogLevel> levels GUARDED_BY(mutex);  // set by setModuleLevel
+};
+
+LogModules& logModules()
+{
+  static LogModules* modules = new LogModules;
+  return *modules;
+}
+
+Logger::LogLevel initModules()
+{
+  const char* spec = ::getenv("MUDUO_LOG_LEVELS");
+  if (spec)
+  {
+    Logger::setLevels(spec);
+  }
+  LogModules& m = logModules();
+  MutexLockGuard lock(m.mutex);
+  return m.level;
+}
+
+//定义日志级别
+std::atomic<Logger::LogLevel> g_logLevel(initModules());
+
 // helper class for known string length at compile time
 class T
 {
@@ -114,6 +168,43 @@ void defaultFlush()
 Logger::OutputFunc g_output = defaultOutput;
 Logger::FlushFunc g_flush = defaultFlush;
 TimeZone g_logTimeZone;
+int g_timeZoneVersion = 0;      // changed by setTimeZone
+bool g_monotonicTime = false;
+int64_t g_monotonicStart = 0;   // microseconds of CLOCK_MONOTONIC
+
+const char kDigitPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// v in [0, 100)
+inline void formatTwoDigits(char* buf, int v)
+{
+  memcpy(buf, kDigitPairs + 2 * v, 2);
+}
+
+// ".uuuuuu", 7 chars
+inline void formatMicroseconds(char* buf, int microseconds)
+{
+  buf[0] = '.';
+  formatTwoDigits(buf + 1, microseconds / 10000);
+  formatTwoDigits(buf + 3, microseconds / 100 % 100);
+  formatTwoDigits(buf + 5, microseconds % 100);
+}
+
+int64_t monotonicMicroseconds()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+}
 
 }  // namespace muduo
 
@@ -141,8 +232,20 @@ Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile& file, int l
   }
 }
 
+// Without snprintf, the date and the hour and minute are formatted once
+// a minute, the second once a second.
 void Logger::Impl::formatTime()
 {
+  if (g_monotonicTime)
+  {
+    int64_t elapsed = monotonicMicroseconds() - g_monotonicStart;
+    char us[8];
+    formatMicroseconds(us, static_cast<int>(elapsed % Timestamp::kMicroSecondsPerSecond));
+    us[7] = ' ';
+    stream_ << '+' << elapsed / Timestamp::kMicroSecondsPerSecond;
+    stream_.append(us, sizeof us);
+    return;
+  }
   //可以得到微秒数
   int64_t microSecondsSinceEpoch = time_.microSecondsSinceEpoch();
   //得到秒
@@ -150,40 +253,54 @@ void Logger::Impl::formatTime()
   //得到微妙
   int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
   //每个线程都拥有自己的 t_lastSecond，一开始为 NULL
-  if (seconds != t_lastSecond)
+  if (seconds != t_lastSecond || t_timeZoneVersion != g_timeZoneVersion)
   {
     t_lastSecond = seconds;
-    struct tm tm_time;
-    if (g_logTimeZone.valid())
-    {
-      tm_time = g_logTimeZone.toLocalTime(seconds);
-    }
-    else
+    time_t minute = seconds / 60;
+    int second = static_cast<int>(seconds % 60) + t_secondOffset;
+    // offsets of some historical timezones are not whole minutes
+    if (minute != t_lastMinute || t_timeZoneVersion != g_timeZoneVersion
+        || second < 0 || second >= 60)
     {
-      ::gmtime_r(&seconds, &tm_time); // FIXME TimeZone::fromUtcTime
+      t_timeZoneVersion = g_timeZoneVersion;
+      struct tm tm_time;
+      if (g_logTimeZone.valid())
+      {
+        tm_time = g_logTimeZone.toLocalTime(seconds);
+      }
+      else
+      {
+        ::gmtime_r(&seconds, &tm_time); // FIXME TimeZone::fromUtcTime
+      }
+      t_lastMinute = minute;
+      t_secondOffset = tm_time.tm_sec - static_cast<int>(seconds % 60);
+      second = tm_time.tm_sec;
+
+      int year = tm_time.tm_year + 1900;
+      formatTwoDigits(t_time, year / 100 % 100);
+      formatTwoDigits(t_time + 2, year % 100);
+      formatTwoDigits(t_time + 4, tm_time.tm_mon + 1);
+      formatTwoDigits(t_time + 6, tm_time.tm_mday);
+      t_time[8] = ' ';
+      formatTwoDigits(t_time + 9, tm_time.tm_hour);
+      t_time[11] = ':';
+      formatTwoDigits(t_time + 12, tm_time.tm_min);
+      t_time[14] = ':';
     }
-
-    //格式化
-    int len = snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
-        tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
-        tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
-    assert(len == 17); (void)len;
+    formatTwoDigits(t_time + 15, second);
   }
 
-  if (g_logTimeZone.valid())
-  {
-    Fmt us(".%06d ", microseconds);
-    assert(us.length() == 8);
-    stream_ << T(t_time, 17) << T(us.data(), 8);
-  }
-  else
+  // "YYYYMMDD HH:MM:SS.uuuuuu " or with 'Z' before the space for UTC
+  char buf[32];
+  memcpy(buf, t_time, 17);
+  formatMicroseconds(buf + 17, microseconds);
+  int len = 24;
+  if (!g_logTimeZone.valid())
   {
-    //调用 Fmt 将毫秒格式化
-    Fmt us(".%06dZ ", microseconds);
-    assert(us.length() == 9);
-    //输出，重载了插入运算符
-    stream_ << T(t_time, 17) << T(us.data(), 9);
+    buf[len++] = 'Z';
   }
+  buf[len++] = ' ';
+  stream_.append(buf, len);
 }
 
 void Logger::Impl::finish()
@@ -220,7 +337,7 @@ Logger::~Logger()
   //引用缓冲区的内容
   const LogStream::Buffer& buf(stream().buffer());
   //输出缓冲区的内容，默认输出到标准输出缓冲区
-  g_output(buf.data(), buf.length());
+  output(impl_.level_, buf.data(), buf.length());
   if (impl_.level_ == FATAL)
   {
     //如果是 FATAL，我们先要刷新一下缓冲区
@@ -231,7 +348,129 @@ Logger::~Logger()
 
 void Logger::setLogLevel(Logger::LogLevel level)
 {
-  g_logLevel = level;
+  LogModules& m = logModules();
+  MutexLockGuard lock(m.mutex);
+  m.level = level;
+  g_logLevel.store(level, std::memory_order_relaxed);
+  for (detail::LogModule* module : m.modules)
+  {
+    if (m.levels.find(module->name_) == m.levels.end())
+    {
+      module->level_.store(level, std::memory_order_relaxed);
+    }
+  }
+}
+
+void Logger::setModuleLevel(const string& module, LogLevel level)
+{
+  LogModules& m = logModules();
+  MutexLockGuard lock(m.mutex);
+  m.levels[module] = level;
+  for (detail::LogModule* mod : m.modules)
+  {
+    if (mod->name_ == module)
+    {
+      mod->level_.store(level, std::memory_order_relaxed);
+    }
+  }
+}
+
+void Logger::resetModuleLevel(const string& module)
+{
+  LogModules& m = logModules();
+  MutexLockGuard lock(m.mutex);
+  m.levels.erase(module);
+  for (detail::LogModule* mod : m.modules)
+  {
+    if (mod->name_ == module)
+    {
+      mod->level_.store(m.level, std::memory_order_relaxed);
+    }
+  }
+}
+
+bool Logger::setLevels(const string& spec)
+{
+  bool ok = true;
+  size_t start = 0;
+  while (start <= spec.size())
+  {
+    size_t end = std::min(spec.find(',', start), spec.size());
+    string item = spec.substr(start, end - start);
+    start = end + 1;
+    if (item.empty())
+      continue;
+    size_t eq = item.find('=');
+    LogLevel level;
+    if (eq == string::npos)
+    {
+      if (parseLogLevel(item, &level))
+        setLogLevel(level);
+      else
+        ok = false;
+    }
+    else if (eq == 0)
+    {
+      ok = false;
+    }
+    else if (eq + 1 == item.size())
+    {
+      resetModuleLevel(item.substr(0, eq));
+    }
+    else if (parseLogLevel(item.substr(eq + 1), &level))
+    {
+      setModuleLevel(item.substr(0, eq), level);
+    }
+    else
+    {
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+string Logger::levels()
+{
+  LogModules& m = logModules();
+  MutexLockGuard lock(m.mutex);
+  std::map<string, LogLevel> modules;
+  for (detail::LogModule* module : m.modules)
+  {
+    modules[module->name_] = module->level();
+  }
+  // set before any file of the module is loaded
+  modules.insert(m.levels.begin(), m.levels.end());
+  string result = "* ";
+  result += LogLevelName[m.level];
+  result += '\n';
+  for (const auto& it : modules)
+  {
+    result += m.levels.count(it.first) ? "* " : "  ";
+    result += LogLevelName[it.second];
+    result += it.first;
+    result += '\n';
+  }
+  return result;
+}
+
+detail::LogModule::LogModule(const char* file)
+  : level_(Logger::INFO)
+{
+  const char* slash = strrchr(file, '/');
+  name_ = slash ? slash + 1 : file;
+  name_.erase(std::min(name_.find('.'), name_.size()));
+  LogModules& m = logModules();
+  MutexLockGuard lock(m.mutex);
+  auto it = m.levels.find(name_);
+  level_.store(it != m.levels.end() ? it->second : m.level, std::memory_order_relaxed);
+  m.modules.push_back(this);
+}
+
+detail::LogModule::~LogModule()
+{
+  LogModules& m = logModules();
+  MutexLockGuard lock(m.mutex);
+  m.modules.erase(std::remove(m.modules.begin(), m.modules.end(), this), m.modules.end());
 }
 
 //设置输出函数
@@ -240,6 +479,18 @@ void Logger::setOutput(OutputFunc out)
   g_output = out;
 }
 
+Logger::LogLevel Logger::outputLevel()
+{
+  return t_outputLevel;
+}
+
+void Logger::output(LogLevel level, const char* msg, int len)
+{
+  t_outputLevel = level;
+  g_output(msg, len);
+  t_outputLevel = INFO;
+}
+
 
 //设置刷新还书
 void Logger::setFlush(FlushFunc flush)
@@ -250,4 +501,11 @@ void Logger::setFlush(FlushFunc flush)
 void Logger::setTimeZone(const TimeZone& tz)
 {
   g_logTimeZone = tz;
+  ++g_timeZoneVersion;
+}
+
+void Logger::setMonotonicTime(bool on)
+{
+  g_monotonicStart = monotonicMicroseconds();
+  g_monotonicTime = on;
 }
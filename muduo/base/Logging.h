@@ -9,6 +9,14 @@
 #include "muduo/base/LogStream.h"
 #include "muduo/base/Timestamp.h"
 
+#include <atomic>
+
+// Statements below this level are compiled out, eg. -DMUDUO_MIN_LOG_LEVEL=2
+// leaves LOG_INFO and above. 0 is TRACE, up to 4 for ERROR.
+#ifndef MUDUO_MIN_LOG_LEVEL
+#define MUDUO_MIN_LOG_LEVEL 0
+#endif
+
 namespace muduo
 {
 
@@ -74,13 +82,35 @@ class Logger
   LogStream& stream() { return impl_.stream_; }
 
   static LogLevel logLevel();
+  /// Level of all modules but those set by setModuleLevel().
   static void setLogLevel(LogLevel level);
+  /// Level of a module, the source files of that name without extension,
+  /// eg. "TcpConnection" for TcpConnection.cc.
+  static void setModuleLevel(const string& module, LogLevel level);
+  /// The module follows setLogLevel() again.
+  static void resetModuleLevel(const string& module);
+  /// Applies a comma separated list like "INFO,EPollPoller=TRACE,TcpConnection=",
+  /// a bare level for setLogLevel(), module=LEVEL for setModuleLevel() and
+  /// module= for resetModuleLevel(). Returns false if any item is bad,
+  /// the others are applied. MUDUO_LOG_LEVELS in the environment is
+  /// applied at startup.
+  static bool setLevels(const string& spec);
+  /// One line per module with its level, '*' marks those set.
+  static string levels();
 
   typedef void (*OutputFunc)(const char* msg, int len);
   typedef void (*FlushFunc)();
   static void setOutput(OutputFunc);
+  /// Level of the line being written, valid inside the output function.
+  static LogLevel outputLevel();
+  /// Writes a formatted line with the output function.
+  static void output(LogLevel level, const char* msg, int len);
   static void setFlush(FlushFunc);
   static void setTimeZone(const TimeZone& tz);
+  /// Lines start with "+seconds.microseconds" since this call instead of
+  /// the date and time, from CLOCK_MONOTONIC so they don't jump with the
+  /// wall clock. Call it before logging threads start.
+  static void setMonotonicTime(bool on);
 
  private:
 
@@ -104,13 +134,38 @@ class Impl
 
 };
 
-extern Logger::LogLevel g_logLevel;   
+// set under the mutex of the modules, read by anyone
+extern std::atomic<Logger::LogLevel> g_logLevel;
 
 inline Logger::LogLevel Logger::logLevel()
 {
-  return g_logLevel;
+  return g_logLevel.load(std::memory_order_relaxed);
 }
 
+namespace detail
+{
+
+// Log level of the source file, registered by name for Logger::setModuleLevel().
+class LogModule : noncopyable
+{
+ public:
+  explicit LogModule(const char* file);
+  ~LogModule();
+
+  Logger::LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+  const string& name() const { return name_; }
+
+ private:
+  friend class muduo::Logger;
+  string name_;
+  std::atomic<Logger::LogLevel> level_;  // set under the mutex of the modules
+};
+
+// one in each source file, __BASE_FILE__ is the .cc being compiled
+static LogModule muduoLogModule(__BASE_FILE__);
+
+}  // namespace detail
+
 //
 // CAUTION: do not write:
 //
@@ -144,16 +199,25 @@ inline Logger::LogLevel Logger::logLevel()
     3.调用 Logger 的析构函数，析构函数会将缓冲区中的内容输出到文件缓冲区或者标准输出缓冲区
 */
 
-#define LOG_TRACE if (muduo::Logger::logLevel() <= muduo::Logger::TRACE) \
+// Whether level is logged in this source file, the first half is a
+// compile time constant, the second one load of the module level.
+#define MUDUO_LOG_ENABLED(lvl) \
+  (MUDUO_MIN_LOG_LEVEL <= (lvl) && muduo::detail::muduoLogModule.level() <= (lvl))
+
+#define LOG_TRACE if (MUDUO_LOG_ENABLED(muduo::Logger::TRACE)) \
   muduo::Logger(__FILE__, __LINE__, muduo::Logger::TRACE, __func__).stream()
-#define LOG_DEBUG if (muduo::Logger::logLevel() <= muduo::Logger::DEBUG) \
+#define LOG_DEBUG if (MUDUO_LOG_ENABLED(muduo::Logger::DEBUG)) \
   muduo::Logger(__FILE__, __LINE__, muduo::Logger::DEBUG, __func__).stream()
-#define LOG_INFO if (muduo::Logger::logLevel() <= muduo::Logger::INFO) \
+#define LOG_INFO if (MUDUO_LOG_ENABLED(muduo::Logger::INFO)) \
   muduo::Logger(__FILE__, __LINE__).stream()
-#define LOG_WARN muduo::Logger(__FILE__, __LINE__, muduo::Logger::WARN).stream()
-#define LOG_ERROR muduo::Logger(__FILE__, __LINE__, muduo::Logger::ERROR).stream()
+// if-else keeps an enclosing else with its own if
+#define LOG_WARN if (MUDUO_MIN_LOG_LEVEL > muduo::Logger::WARN) {} else \
+  muduo::Logger(__FILE__, __LINE__, muduo::Logger::WARN).stream()
+#define LOG_ERROR if (MUDUO_MIN_LOG_LEVEL > muduo::Logger::ERROR) {} else \
+  muduo::Logger(__FILE__, __LINE__, muduo::Logger::ERROR).stream()
 #define LOG_FATAL muduo::Logger(__FILE__, __LINE__, muduo::Logger::FATAL).stream()
-#define LOG_SYSERR muduo::Logger(__FILE__, __LINE__, false).stream()
+#define LOG_SYSERR if (MUDUO_MIN_LOG_LEVEL > muduo::Logger::ERROR) {} else \
+  muduo::Logger(__FILE__, __LINE__, false).stream()
 #define LOG_SYSFATAL muduo::Logger(__FILE__, __LINE__, true).stream()
 
 const char* strerror_tl(int savedErrno);
@@ -0,0 +1,186 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/base/MmapLog.h"
+
+#include "muduo/base/Logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+// The first page of the file.
+struct MmapLog::Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t capacity;
+  std::atomic<uint64_t> head;   // bytes ever appended, the ring wraps at capacity
+};
+
+namespace
+{
+
+const char kMagic[8] = { 'M', 'U', 'D', 'U', 'O', 'M', 'L', 'G' };
+const uint32_t kVersion = 1;
+const size_t kHeaderSize = 4096;
+
+bool validHeader(const void* map, size_t fileSize)
+{
+  const char* header = static_cast<const char*>(map);
+  uint32_t version, headerSize;
+  uint64_t capacity;
+  memcpy(&version, header + 8, sizeof version);
+  memcpy(&headerSize, header + 12, sizeof headerSize);
+  memcpy(&capacity, header + 16, sizeof capacity);
+  return memcmp(header, kMagic, sizeof kMagic) == 0
+      && version == kVersion
+      && headerSize == kHeaderSize
+      && capacity == fileSize - kHeaderSize;
+}
+
+}  // namespace
+
+MmapLog::MmapLog(const string& filename, size_t capacity)
+  : fd_(::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)),
+    capacity_((capacity + kHeaderSize - 1) / kHeaderSize * kHeaderSize),
+    mapSize_(kHeaderSize + capacity_),
+    map_(NULL),
+    header_(NULL),
+    data_(NULL)
+{
+  static_assert(sizeof(Header) <= kHeaderSize, "Header fits in a page");
+  if (fd_ < 0)
+  {
+    LOG_SYSFATAL << "MmapLog::MmapLog open " << filename;
+  }
+  struct stat st;
+  bool reuse = ::fstat(fd_, &st) == 0 && static_cast<size_t>(st.st_size) == mapSize_;
+  // blocks are allocated now, a full disk would be SIGBUS in append()
+  if (!reuse && (::ftruncate(fd_, 0) < 0
+                 || ::posix_fallocate(fd_, 0, static_cast<off_t>(mapSize_)) != 0))
+  {
+    LOG_SYSFATAL << "MmapLog::MmapLog allocate " << filename;
+  }
+  void* map = ::mmap(NULL, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED)
+  {
+    LOG_SYSFATAL << "MmapLog::MmapLog mmap " << filename;
+  }
+  map_ = static_cast<char*>(map);
+  data_ = map_ + kHeaderSize;
+  if (reuse && validHeader(map_, mapSize_))
+  {
+    header_ = reinterpret_cast<Header*>(map_);
+  }
+  else
+  {
+    memset(map_, 0, mapSize_);
+    header_ = new (map_) Header;
+    memcpy(header_->magic, kMagic, sizeof kMagic);
+    header_->version = kVersion;
+    header_->headerSize = kHeaderSize;
+    header_->capacity = capacity_;
+    header_->head.store(0);
+  }
+}
+
+MmapLog::~MmapLog()
+{
+  ::munmap(map_, mapSize_);
+  ::close(fd_);
+}
+
+void MmapLog::append(const char* logline, int len)
+{
+  size_t n = static_cast<size_t>(len);
+  if (n > capacity_)
+  {
+    logline += n - capacity_;
+    n = capacity_;
+  }
+  uint64_t pos = header_->head.fetch_add(n, std::memory_order_relaxed);
+  size_t offset = static_cast<size_t>(pos % capacity_);
+  size_t first = std::min(n, capacity_ - offset);
+  memcpy(data_ + offset, logline, first);
+  memcpy(data_, logline + first, n - first);
+}
+
+void MmapLog::flush()
+{
+  ::msync(map_, mapSize_, MS_ASYNC);
+}
+
+uint64_t MmapLog::writtenBytes() const
+{
+  return header_->head.load(std::memory_order_relaxed);
+}
+
+int MmapLog::read(const string& filename, string* lines)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return errno;
+  int err = 0;
+  struct stat st;
+  if (::fstat(fd, &st) < 0)
+  {
+    err = errno;
+  }
+  else if (static_cast<size_t>(st.st_size) <= kHeaderSize)
+  {
+    err = EINVAL;
+  }
+  else
+  {
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+      err = errno;
+    }
+    else if (!validHeader(map, size))
+    {
+      err = EINVAL;
+      ::munmap(map, size);
+    }
+    else
+    {
+      const Header* header = static_cast<const Header*>(map);
+      const char* data = static_cast<const char*>(map) + kHeaderSize;
+      size_t capacity = static_cast<size_t>(header->capacity);
+      uint64_t head = header->head.load();
+      size_t start = lines->size();
+      if (head <= capacity)
+      {
+        lines->append(data, static_cast<size_t>(head));
+      }
+      else
+      {
+        size_t offset = static_cast<size_t>(head % capacity);
+        lines->append(data + offset, capacity - offset);
+        lines->append(data, offset);
+        // the oldest line was partly overwritten
+        size_t eol = lines->find('\n', start);
+        lines->erase(start, eol == string::npos ? string::npos : eol + 1 - start);
+      }
+      // room reserved by threads that never wrote it
+      lines->erase(std::remove(lines->begin() + start, lines->end(), '\0'), lines->end());
+      ::munmap(map, size);
+    }
+  }
+  ::close(fd);
+  return err;
+}
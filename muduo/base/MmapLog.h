@@ -0,0 +1,63 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_MMAPLOG_H
+#define MUDUO_BASE_MMAPLOG_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Types.h"
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Log lines in a ring buffer of a mmap(2)ed file, for Logger::setOutput().
+///
+/// append() reserves room with an atomic add and copies the line into the
+/// shared mapping, no lock and no syscall. The kernel writes the pages
+/// back even if the process crashes, so the last capacity bytes of log
+/// survive abort() in LOG_FATAL, read them with read() or mmaplogdump.
+/// Lines other threads were writing at the crash may be torn.
+///
+/// MmapLog* g_mmapLog = NULL;
+/// void output(const char* msg, int len) { g_mmapLog->append(msg, len); }
+/// Logger::setOutput(output);
+///
+class MmapLog : noncopyable
+{
+ public:
+  /// Continues a file of the same capacity, otherwise starts it over.
+  /// capacity is rounded up to pages.
+  MmapLog(const string& filename, size_t capacity);
+  ~MmapLog();
+
+  /// Thread safe.
+  void append(const char* logline, int len);
+  /// Starts writing dirty pages back, for Logger::setFlush().
+  void flush();
+
+  size_t capacity() const { return capacity_; }
+  /// Bytes appended since the file was created.
+  uint64_t writtenBytes() const;
+
+  /// Lines in the ring of filename, oldest first, returns errno.
+  static int read(const string& filename, string* lines);
+
+ private:
+  struct Header;
+
+  int fd_;
+  size_t capacity_;
+  size_t mapSize_;
+  char* map_;
+  Header* header_;
+  char* data_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_MMAPLOG_H
@@ -7,6 +7,7 @@
 #define MUDUO_BASE_MUTEX_H
 
 #include "muduo/base/CurrentThread.h"
+#include "muduo/base/LockProfiler.h"
 #include "muduo/base/noncopyable.h"
 #include <assert.h>
 #include <pthread.h>
@@ -118,20 +119,39 @@ namespace muduo
 //   mutable MutexLock mutex_;
 //   std::vector<int> data_ GUARDED_BY(mutex_);
 // };
+//
+// A lock constructed with a name (a string literal, or MUDUO_LOCK_SITE)
+// is profiled by LockProfiler when it is enabled.
 class CAPABILITY("mutex") MutexLock : noncopyable
 {
  public:
   MutexLock()
-    : holder_(0)
+    : holder_(0),
+      site_(NULL),
+      holdStart_(0),
+      profiledCount_(0)
   {
     //初始化互斥锁
     MCHECK(pthread_mutex_init(&mutex_, NULL));
   }
 
+  explicit MutexLock(const char* name)
+    : holder_(0),
+      site_(LockProfiler::site(name)),
+      holdStart_(0),
+      profiledCount_(0)
+  {
+    MCHECK(pthread_mutex_init(&mutex_, NULL));
+  }
+
   ~MutexLock()
   {
     //没有线程拥有这把锁，我们才可以销毁锁
     assert(holder_ == 0);
+    if (site_ != NULL)
+    {
+      site_->recordAcquired(profiledCount_ & (LockSite::kHoldSampleEvery - 1));
+    }
     MCHECK(pthread_mutex_destroy(&mutex_));
   }
 
@@ -153,7 +173,14 @@ class CAPABILITY("mutex") MutexLock : noncopyable
   //加锁
   void lock() ACQUIRE()
   {
-    MCHECK(pthread_mutex_lock(&mutex_));
+    if (__builtin_expect(site_ != NULL, 0) && LockProfiler::enabled())
+    {
+      lockProfiled();
+    }
+    else
+    {
+      MCHECK(pthread_mutex_lock(&mutex_));
+    }
     assignHolder();
   }
 
@@ -162,6 +189,7 @@ class CAPABILITY("mutex") MutexLock : noncopyable
   {
     //没有线程拥有锁
     unassignHolder();
+    endHold();
     MCHECK(pthread_mutex_unlock(&mutex_));
   }
 
@@ -181,11 +209,13 @@ class CAPABILITY("mutex") MutexLock : noncopyable
       : owner_(owner)
     {
       owner_.unassignHolder();
+      owner_.pauseHold();
     }
 
     ~UnassignGuard()
     {
       owner_.assignHolder();
+      owner_.beginHold();
     }
 
    private:
@@ -203,8 +233,58 @@ class CAPABILITY("mutex") MutexLock : noncopyable
     holder_ = CurrentThread::tid();
   }
 
+  // uncontended: a trylock and a counter increment, and every
+  // kHoldSampleEvery times, an atomic add and two cycleClock() reads.
+  void lockProfiled()
+  {
+    int ret = pthread_mutex_trylock(&mutex_);
+    if (ret != 0)
+    {
+      uint64_t start = detail::cycleClock();
+      MCHECK(pthread_mutex_lock(&mutex_));
+      site_->recordWait(detail::cycleClock() - start);
+    }
+    // under the lock, no need to be atomic
+    if ((++profiledCount_ & (LockSite::kHoldSampleEvery - 1)) == 0)
+    {
+      site_->recordAcquired(LockSite::kHoldSampleEvery);
+      holdStart_ = detail::cycleClock();
+    }
+  }
+
+  // after Condition::wait(), keep sampling the rest of the hold
+  void beginHold()
+  {
+    if (holdStart_ == 1)
+    {
+      holdStart_ = detail::cycleClock();
+    }
+  }
+
+  void endHold()
+  {
+    if (holdStart_ != 0)
+    {
+      site_->recordHold(detail::cycleClock() - holdStart_);
+      holdStart_ = 0;
+    }
+  }
+
+  // Condition::wait() splits a sampled hold in two
+  void pauseHold()
+  {
+    if (holdStart_ != 0)
+    {
+      endHold();
+      holdStart_ = 1;
+    }
+  }
+
   pthread_mutex_t mutex_;       //互斥锁
   pid_t holder_;                //拥有这把锁的线程，tid
+  LockSite* site_;              //性能统计，只有带名字的锁才有
+  uint64_t holdStart_;          //加锁时的 cycleClock()，0 表示这次不采样
+  int64_t profiledCount_;       //统计过的加锁次数
 };
 
 // Use as a stack variable, eg.
@@ -17,9 +17,18 @@ ThreadPool::ThreadPool(const string& nameArg)
     notEmpty_(mutex_),
     notFull_(mutex_),
     name_(nameArg),
+    queueSize_(0),
     maxQueueSize_(0),
     running_(false)
 {
+  weights_[kHigh] = 8;
+  weights_[kNormal] = 4;
+  weights_[kLow] = 1;
+  for (int i = 0; i < kNumPriorities; ++i)
+  {
+    credits_[i] = weights_[i];
+    memZero(&stats_[i], sizeof stats_[i]);
+  }
 }
 
 ThreadPool::~ThreadPool()
@@ -30,6 +39,15 @@ ThreadPool::~ThreadPool()
   }
 }
 
+void ThreadPool::setPriorityWeight(Priority priority, int weight)
+{
+  assert(weight > 0);
+  AdaptiveMutexLockGuard lock(mutex_);
+  weights_[priority] = weight;
+  // the constructor gave credits of the default weights
+  credits_[priority] = weight;
+}
+
 void ThreadPool::start(int numThreads)
 {
   assert(threads_.empty());
@@ -52,7 +70,7 @@ void ThreadPool::start(int numThreads)
 void ThreadPool::stop()
 {
   {
-  MutexLockGuard lock(mutex_);
+  AdaptiveMutexLockGuard lock(mutex_);
   running_ = false;
   notEmpty_.notifyAll();
   notFull_.notifyAll();
@@ -65,14 +83,34 @@ void ThreadPool::stop()
 
 size_t ThreadPool::queueSize() const
 {
-  MutexLockGuard lock(mutex_);
-  return queue_.size();
+  AdaptiveMutexLockGuard lock(mutex_);
+  return queueSize_;
+}
+
+size_t ThreadPool::queueSize(Priority priority) const
+{
+  AdaptiveMutexLockGuard lock(mutex_);
+  return queues_[priority].size();
+}
+
+ThreadPool::Stats ThreadPool::stats(Priority priority) const
+{
+  AdaptiveMutexLockGuard lock(mutex_);
+  Stats result = stats_[priority];
+  result.queueDepth = queues_[priority].size();
+  return result;
 }
 
 //向任务队列添加任务
 //对于任务队列属于生产者
 void ThreadPool::run(Task task)
 {
+  run(std::move(task), kNormal);
+}
+
+void ThreadPool::run(Task task, Priority priority, Timestamp deadline)
+{
+  assert(0 <= priority && priority < kNumPriorities);
   //如果线程队列为空，直接执行该任务，否则添加进任务队列
   if (threads_.empty())
   {
@@ -80,7 +118,7 @@ void ThreadPool::run(Task task)
   }
   else
   {
-    MutexLockGuard lock(mutex_);
+    AdaptiveMutexLockGuard lock(mutex_);
     //如果 maxQueueSize_ == 0，则 isFull 返回 false
     //如果 maxQueueSize_ = 0， 就是无界队列
     while (isFull() && running_)
@@ -90,29 +128,133 @@ void ThreadPool::run(Task task)
     if (!running_) return;
     assert(!isFull());
 
-    queue_.push_back(std::move(task));
+    Entry entry = { std::move(task), Timestamp::now(), deadline };
+    queues_[priority].push_back(std::move(entry));
+    ++queueSize_;
+    ++stats_[priority].enqueued;
     notEmpty_.notify();
   }
 }
 
+void ThreadPool::runBatch(std::vector<Task>&& tasks, Priority priority)
+{
+  assert(0 <= priority && priority < kNumPriorities);
+  if (threads_.empty())
+  {
+    for (auto& task : tasks)
+    {
+      task();
+    }
+  }
+  else
+  {
+    size_t i = 0;
+    AdaptiveMutexLockGuard lock(mutex_);
+    while (i < tasks.size())
+    {
+      while (isFull() && running_)
+      {
+        notFull_.wait();
+      }
+      if (!running_) break;
+
+      Timestamp now(Timestamp::now());
+      size_t added = 0;
+      for (; i < tasks.size() && !isFull(); ++i, ++added)
+      {
+        Entry entry = { std::move(tasks[i]), now, Timestamp::invalid() };
+        queues_[priority].push_back(std::move(entry));
+        ++queueSize_;
+      }
+      stats_[priority].enqueued += static_cast<int64_t>(added);
+      if (added >= threads_.size())
+      {
+        notEmpty_.notifyAll();
+      }
+      else
+      {
+        for (size_t j = 0; j < added; ++j)
+        {
+          notEmpty_.notify();
+        }
+      }
+    }
+  }
+  tasks.clear();
+}
+
+// weighted round-robin: the highest class that still has credit in
+// this round wins, credits are refilled once every non-empty class
+// has used up its share.
+int ThreadPool::pickQueue()
+{
+  assert(queueSize_ > 0);
+  for (int round = 0; round < 2; ++round)
+  {
+    for (int i = 0; i < kNumPriorities; ++i)
+    {
+      if (!queues_[i].empty() && credits_[i] > 0)
+      {
+        --credits_[i];
+        return i;
+      }
+    }
+    for (int i = 0; i < kNumPriorities; ++i)
+    {
+      credits_[i] = weights_[i];
+    }
+  }
+  assert(false);
+  return kNormal;
+}
+
 //对于任务队列属于消费者
 ThreadPool::Task ThreadPool::take()
 {
-  MutexLockGuard lock(mutex_);
+  AdaptiveMutexLockGuard lock(mutex_);
   // always use a while-loop, due to spurious wakeup
-  while (queue_.empty() && running_)
+  while (queueSize_ == 0 && running_)
   {
     notEmpty_.wait();
   }
   Task task;
-  if (!queue_.empty())
+  Timestamp now(Timestamp::now());
+  // expired tasks are dropped in place, keep looking for a live one
+  while (!task && queueSize_ > 0)
   {
-    task = queue_.front();
-    queue_.pop_front();
+    int priority = pickQueue();
+    Entry entry(std::move(queues_[priority].front()));
+    queues_[priority].pop_front();
+    --queueSize_;
     if (maxQueueSize_ > 0)
     {
       notFull_.notify();    //
     }
+
+    Stats& stats = stats_[priority];
+    int64_t waitUs = now.microSecondsSinceEpoch() - entry.enqueued.microSecondsSinceEpoch();
+    stats.totalWaitUs += waitUs;
+    if (waitUs > stats.maxWaitUs)
+    {
+      stats.maxWaitUs = waitUs;
+    }
+
+    if (entry.deadline.valid() && entry.deadline < now)
+    {
+      ++stats.expired;
+      if (expiredTaskCallback_)
+      {
+        ExpiredTaskCallback cb(expiredTaskCallback_);
+        Priority p = static_cast<Priority>(priority);
+        Task expiredTask(std::move(entry.task));
+        task = [cb, p, expiredTask] { cb(p, expiredTask); };
+      }
+    }
+    else
+    {
+      ++stats.executed;
+      task = std::move(entry.task);
+    }
   }
   return task;
 }
@@ -120,7 +262,7 @@ ThreadPool::Task ThreadPool::take()
 bool ThreadPool::isFull() const
 {
   mutex_.assertLocked();
-  return maxQueueSize_ > 0 && queue_.size() >= maxQueueSize_;
+  return maxQueueSize_ > 0 && queueSize_ >= maxQueueSize_;
 }
 
 void ThreadPool::runInThread()
@@ -6,9 +6,10 @@
 #ifndef MUDUO_BASE_THREADPOOL_H
 #define MUDUO_BASE_THREADPOOL_H
 
-#include "muduo/base/Condition.h"
-#include "muduo/base/Mutex.h"
+#include "muduo/base/AdaptiveCondition.h"
+#include "muduo/base/AdaptiveMutex.h"
 #include "muduo/base/Thread.h"
+#include "muduo/base/Timestamp.h"
 #include "muduo/base/Types.h"
 
 #include <deque>
@@ -22,6 +23,31 @@ class ThreadPool : noncopyable
  public:
   typedef std::function<void ()> Task;
 
+  // Task classes, served by weighted round-robin so that
+  // a burst of kLow work cannot starve kHigh tasks, and vice versa.
+  enum Priority
+  {
+    kHigh,
+    kNormal,
+    kLow,
+    kNumPriorities,
+  };
+
+  // Called in a pool thread instead of the task, when the task is
+  // taken after its deadline. If not set, expired tasks are dropped.
+  typedef std::function<void (Priority, const Task&)> ExpiredTaskCallback;
+
+  // Per-class statistics, wait time is from run() to take().
+  struct Stats
+  {
+    size_t queueDepth;
+    int64_t enqueued;
+    int64_t executed;
+    int64_t expired;
+    int64_t totalWaitUs;
+    int64_t maxWaitUs;
+  };
+
   explicit ThreadPool(const string& nameArg = string("ThreadPool"));
   ~ThreadPool();
 
@@ -29,6 +55,10 @@ class ThreadPool : noncopyable
   void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
   void setThreadInitCallback(const Task& cb)
   { threadInitCallback_ = cb; }
+  void setExpiredTaskCallback(const ExpiredTaskCallback& cb)
+  { expiredTaskCallback_ = cb; }
+  // Tasks taken from a class per round, default 8:4:1.
+  void setPriorityWeight(Priority priority, int weight);
 
   void start(int numThreads);     //启动线程池，线程的个数是固定的
   void stop();    
@@ -37,6 +67,10 @@ class ThreadPool : noncopyable
   { return name_; }
 
   size_t queueSize() const;
+  size_t queueSize(Priority priority) const;
+  Stats stats(Priority priority) const;
+  AdaptiveMutexLock::Stats lockStats() const
+  { return mutex_.stats(); }
 
   // Could block if maxQueueSize > 0
   // Call after stop() will return immediately.
@@ -46,18 +80,39 @@ class ThreadPool : noncopyable
   // https://stackoverflow.com/a/25408989
   void run(Task f);   //向任务队列添加任务
 
+  // Same as run(f), with a task class and an optional deadline.
+  // Tasks still queued after deadline are not run, see ExpiredTaskCallback.
+  void run(Task f, Priority priority, Timestamp deadline = Timestamp::invalid());
+
+  // Queues many tasks with one lock acquisition per batch,
+  // could block in the middle if maxQueueSize > 0.
+  void runBatch(std::vector<Task>&& tasks, Priority priority = kNormal);
+
  private:
+  struct Entry
+  {
+    Task task;
+    Timestamp enqueued;
+    Timestamp deadline;
+  };
+
   bool isFull() const REQUIRES(mutex_);
+  int pickQueue() REQUIRES(mutex_);
   void runInThread();     //线程池中的线程执行函数
   Task take();            //获取任务
 
-  mutable MutexLock mutex_;       //互斥锁
-  Condition notEmpty_ GUARDED_BY(mutex_);   //有界队列，判断是否为满
-  Condition notFull_ GUARDED_BY(mutex_);    //判断是否为空
+  mutable AdaptiveMutexLock mutex_;       //互斥锁，临界区很短，先自旋再睡眠
+  AdaptiveCondition notEmpty_ GUARDED_BY(mutex_);   //有界队列，判断是否为满
+  AdaptiveCondition notFull_ GUARDED_BY(mutex_);    //判断是否为空
   string name_;         //线程池名称
   Task threadInitCallback_;
+  ExpiredTaskCallback expiredTaskCallback_;
   std::vector<std::unique_ptr<muduo::Thread>> threads_;   //线程队列
-  std::deque<Task> queue_ GUARDED_BY(mutex_);     //任务队列
+  std::deque<Entry> queues_[kNumPriorities] GUARDED_BY(mutex_);  //每个优先级一个任务队列
+  size_t queueSize_ GUARDED_BY(mutex_);     //所有队列的任务总数
+  int weights_[kNumPriorities] GUARDED_BY(mutex_);
+  int credits_[kNumPriorities] GUARDED_BY(mutex_);   //本轮还可以取的任务数
+  Stats stats_[kNumPriorities] GUARDED_BY(mutex_);
   size_t maxQueueSize_;
   bool running_;        //判断线程池是否处于运行状态
 };
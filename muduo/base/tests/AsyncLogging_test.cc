@@ -1,8 +1,13 @@
 #include "muduo/base/AsyncLogging.h"
 #include "muduo/base/Logging.h"
+#include "muduo/base/Thread.h"
 #include "muduo/base/Timestamp.h"
 
+#include <memory>
+#include <vector>
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/resource.h>
 #include <unistd.h>
 
@@ -42,6 +47,46 @@ void bench(bool longLog)
   }
 }
 
+// lines per second with 1, 2, 4 ... maxThreads threads logging at once
+void benchThreads(int maxThreads)
+{
+  muduo::Logger::setOutput(asyncOutput);
+  const int kLines = 200*1000;
+
+  for (int n = 1; n <= maxThreads; n *= 2)
+  {
+    muduo::AdaptiveMutexLock::Stats before = g_asyncLog->lockStats();
+    std::vector<std::unique_ptr<muduo::Thread>> threads;
+    for (int i = 0; i < n; ++i)
+    {
+      threads.emplace_back(new muduo::Thread([kLines] {
+        for (int j = 0; j < kLines; ++j)
+        {
+          LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << j;
+        }
+      }));
+    }
+    muduo::Timestamp start = muduo::Timestamp::now();
+    for (auto& thr : threads)
+    {
+      thr->start();
+    }
+    for (auto& thr : threads)
+    {
+      thr->join();
+    }
+    double seconds = timeDifference(muduo::Timestamp::now(), start);
+    muduo::AdaptiveMutexLock::Stats after = g_asyncLog->lockStats();
+    printf("%2d threads %10.0f lines/s, %lld locks %lld contended\n",
+           n, n * kLines / seconds,
+           static_cast<long long>(after.lockCount - before.lockCount),
+           static_cast<long long>(after.contendedCount - before.contendedCount));
+    struct timespec ts = { 0, 500*1000*1000 };
+    nanosleep(&ts, NULL);
+  }
+}
+
+// Usage: asynclogging_test [pwrite | direct] [gzip] [long | threads [max_threads]]
 int main(int argc, char* argv[])
 {
   {
@@ -56,9 +101,28 @@ int main(int argc, char* argv[])
   char name[256] = { '\0' };
   strncpy(name, argv[0], sizeof name - 1);
   muduo::AsyncLogging log(::basename(name), kRollSize);
+  if (argc > 1 && (strcmp(argv[1], "pwrite") == 0 || strcmp(argv[1], "direct") == 0))
+  {
+    log.setFileWriter(argv[1][0] == 'p' ? muduo::LogFile::kPwrite : muduo::LogFile::kDirect);
+    --argc;
+    ++argv;
+  }
+  if (argc > 1 && strcmp(argv[1], "gzip") == 0)
+  {
+    log.setGzipLevel(1);
+    --argc;
+    ++argv;
+  }
   log.start();
   g_asyncLog = &log;
 
-  bool longLog = argc > 1;
-  bench(longLog);
+  if (argc > 1 && strcmp(argv[1], "threads") == 0)
+  {
+    benchThreads(argc > 2 ? atoi(argv[2]) : 16);
+  }
+  else
+  {
+    bool longLog = argc > 1;
+    bench(longLog);
+  }
 }
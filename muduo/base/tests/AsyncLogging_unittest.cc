@@ -0,0 +1,214 @@
+// AsyncLogging overflow policies and drop counters.
+
+#include "muduo/base/AsyncLogging.h"
+#include "muduo/base/Thread.h"
+#include "muduo/base/tests/ScratchDir.h"
+
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+const int kLineLen = 1000;
+// Lines starting with "line" in files of the current directory whose
+// names start with prefix, removing the files.
+int64_t countLines(const string& prefix)
+{
+  int64_t lines = 0;
+  DIR* dir = ::opendir(".");
+  assert(dir);
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) != 0)
+      continue;
+    FILE* fp = ::fopen(entry->d_name, "r");
+    char buf[kLineLen + 64];
+    while (::fgets(buf, sizeof buf, fp))
+    {
+      if (strncmp(buf, "line", 4) == 0)
+        ++lines;
+    }
+    ::fclose(fp);
+    ::unlink(entry->d_name);
+  }
+  ::closedir(dir);
+  return lines;
+}
+
+void appendLines(AsyncLogging* log, int n, Logger::LogLevel level)
+{
+  char line[kLineLen];
+  memset(line, 'x', sizeof line);
+  memcpy(line, "line", 4);
+  line[kLineLen - 1] = '\n';
+  for (int i = 0; i < n; ++i)
+  {
+    log->append(line, kLineLen, level);
+  }
+}
+
+int64_t dropped(const AsyncLogging& log)
+{
+  int64_t total = 0;
+  for (int i = 0; i < Logger::NUM_LOG_LEVELS; ++i)
+  {
+    total += log.droppedLines(static_cast<Logger::LogLevel>(i));
+  }
+  return total;
+}
+
+// Before start(), nothing is written, so the budget fills up.
+void testDrop()
+{
+  const int kLines = 20000;
+  string basename = "drop";
+  {
+    AsyncLogging log(basename, 500*1000*1000);
+    log.setMemoryBudget(2 * 4000 * 1000);
+    appendLines(&log, kLines, Logger::INFO);
+    int64_t infoDropped = log.droppedLines(Logger::INFO);
+    printf("drop: %lld INFO lines dropped\n", static_cast<long long>(infoDropped));
+    assert(infoDropped > 0 && infoDropped < kLines);
+    assert(log.droppedBytes(Logger::INFO) == infoDropped * kLineLen);
+    assert(dropped(log) == infoDropped);
+    log.start();
+    log.stop();
+    assert(countLines(basename) + infoDropped == kLines);
+  }
+}
+
+void testDropBelowWarn()
+{
+  const int kInfoLines = 20000;
+  const int kWarnLines = 3000;
+  string basename = "severity";
+  {
+    AsyncLogging log(basename, 500*1000*1000);
+    log.setOverflowPolicy(AsyncLogging::kDropBelowWarn);
+    log.setMemoryBudget(4 * 4000 * 1000);
+    appendLines(&log, kInfoLines, Logger::INFO);
+    // INFO has filled 3/4 of the budget, WARN may use the rest
+    appendLines(&log, kWarnLines, Logger::WARN);
+    printf("severity: %lld INFO %lld WARN lines dropped\n",
+           static_cast<long long>(log.droppedLines(Logger::INFO)),
+           static_cast<long long>(log.droppedLines(Logger::WARN)));
+    assert(log.droppedLines(Logger::INFO) > 0);
+    assert(log.droppedLines(Logger::WARN) == 0);
+    log.start();
+    log.stop();
+    assert(countLines(basename) + log.droppedLines(Logger::INFO) == kInfoLines + kWarnLines);
+  }
+}
+
+// Logging threads outrun the backend.
+void testBlockOrSpill(AsyncLogging::OverflowPolicy policy, const string& basename)
+{
+  const int kThreads = 4;
+  const int kLines = 10000;
+  {
+    AsyncLogging log(basename, 500*1000*1000);
+    log.setOverflowPolicy(policy);
+    log.setMemoryBudget(2 * 4000 * 1000);
+    log.start();
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < kThreads; ++i)
+    {
+      threads.emplace_back(new Thread([&log] { appendLines(&log, kLines, Logger::INFO); }));
+      threads.back()->start();
+    }
+    for (auto& thr : threads)
+    {
+      thr->join();
+    }
+    log.stop();
+    printf("%s: %lld lines spilled\n", basename.c_str(),
+           static_cast<long long>(log.spilledLines()));
+    assert(dropped(log) == 0);
+    if (policy == AsyncLogging::kBlock)
+      assert(log.spilledLines() == 0);
+  }
+  // main file and the spill file
+  assert(countLines(basename) == kThreads * kLines);
+}
+
+// Lines of each thread in the order appended, also when rings are full.
+void testOrder()
+{
+  const int kThreads = 4;
+  const int kLines = 50000;
+  const string basename = "order";
+  {
+    AsyncLogging log(basename, 500*1000*1000);
+    log.start();
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+      threads.emplace_back(new Thread([&log, t] {
+        char line[128];
+        memset(line, 'o', sizeof line);
+        for (int i = 0; i < kLines; ++i)
+        {
+          int n = snprintf(line, sizeof line, "line %d %d ", t, i);
+          line[n] = 'o';
+          line[99] = '\n';
+          log.append(line, 100);
+        }
+      }));
+      threads.back()->start();
+    }
+    for (auto& thr : threads)
+    {
+      thr->join();
+    }
+    log.stop();
+    assert(dropped(log) == 0);
+  }
+
+  std::vector<int> next(kThreads, 0);
+  DIR* dir = ::opendir(".");
+  assert(dir);
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    if (strncmp(entry->d_name, basename.c_str(), basename.size()) != 0)
+      continue;
+    FILE* fp = ::fopen(entry->d_name, "r");
+    char buf[256];
+    while (::fgets(buf, sizeof buf, fp))
+    {
+      int t = 0, i = 0;
+      if (sscanf(buf, "line %d %d ", &t, &i) == 2)
+      {
+        assert(0 <= t && t < kThreads);
+        assert(i == next[t]);
+        ++next[t];
+      }
+    }
+    ::fclose(fp);
+    ::unlink(entry->d_name);
+  }
+  ::closedir(dir);
+  for (int t = 0; t < kThreads; ++t)
+  {
+    assert(next[t] == kLines);
+  }
+}
+
+int main()
+{
+  {
+    ScratchDir dir("/tmp/asynclogging_unittest");
+    testDrop();
+    testDropBelowWarn();
+    testBlockOrSpill(AsyncLogging::kBlock, "block");
+    testBlockOrSpill(AsyncLogging::kSpill, "spill");
+    testOrder();
+  }
+  printf("OK\n");
+}
@@ -0,0 +1,251 @@
+// BinaryLog records, formatted in the logging thread, by AsyncLogging
+// and from a file as logdecoder does.
+
+#include "muduo/base/AsyncLogging.h"
+#include "muduo/base/BinaryLog.h"
+#include "muduo/base/FileUtil.h"
+#include "muduo/base/tests/ScratchDir.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <map>
+#include <memory>
+
+#undef NDEBUG
+#include <assert.h>
+
+using namespace muduo;
+
+string g_record;
+Logger::LogLevel g_level;
+
+void saveRecord(const char* record, int len, Logger::LogLevel level)
+{
+  g_record.assign(record, len);
+  g_level = level;
+}
+
+string g_line;
+
+void saveLine(const char* msg, int len)
+{
+  g_line.assign(msg, len);
+}
+
+bool contains(const string& s, const char* part)
+{
+  return s.find(part) != string::npos;
+}
+
+void testFormat()
+{
+  BinaryLog::setOutput(saveRecord);
+  string name = "conn#1";
+  LOG_BINARY_WARN("{} {} bytes, {} ms, {}/{}", name, 42, 1.5, 'x', -7LL);
+  assert(g_level == Logger::WARN);
+  assert(g_record[0] == BinaryLog::kRecordMarker);
+  assert(BinaryLog::entryLength(g_record.data(), g_record.size()) == static_cast<int>(g_record.size()));
+  assert(BinaryLog::entryLength(g_record.data(), g_record.size() - 1) == 0);
+
+  const BinaryLogSite* site = BinaryLog::site(g_record.data());
+  assert(site != NULL);
+  assert(site->level == Logger::WARN);
+  string line;
+  BinaryLog::format(*site, g_record.data(), static_cast<int>(g_record.size()), &line);
+  printf("%s", line.c_str());
+  assert(contains(line, "Z "));
+  assert(contains(line, "WARN  conn#1 42 bytes, 1.5 ms, x/-7 - BinaryLog_unittest.cc:"));
+  assert(line.back() == '\n');
+
+  // fewer and more arguments than holes
+  LOG_BINARY_INFO("{} and {}", 1);
+  line.clear();
+  BinaryLog::format(*BinaryLog::site(g_record.data()), g_record.data(),
+                    static_cast<int>(g_record.size()), &line);
+  assert(contains(line, "INFO  1 and {} - "));
+  LOG_BINARY_INFO("only", 2, 3);
+  line.clear();
+  BinaryLog::format(*BinaryLog::site(g_record.data()), g_record.data(),
+                    static_cast<int>(g_record.size()), &line);
+  assert(contains(line, "INFO  only23 - "));
+
+  // long strings are cut to fit in the record
+  string big(5000, 'y');
+  LOG_BINARY_ERROR("{}", big);
+  assert(g_record.size() <= static_cast<size_t>(BinaryLog::kMaxRecord));
+
+  // sites survive appendSite and parseSite
+  string entry;
+  BinaryLog::appendSite(*site, &entry);
+  BinaryLogSite parsed;
+  assert(BinaryLog::parseSite(entry.data(), static_cast<int>(entry.size()), &parsed));
+  assert(parsed.id.load() == site->id.load());
+  assert(parsed.level == site->level);
+  assert(parsed.line == site->line);
+  assert(strcmp(parsed.file, site->file) == 0);
+  assert(strcmp(parsed.format, site->format) == 0);
+
+  // the default output formats and writes with Logger
+  BinaryLog::setOutput(NULL);
+  Logger::setOutput(saveLine);
+  LOG_BINARY_INFO("default {}", 99);
+  assert(contains(g_line, "INFO  default 99 - "));
+}
+
+AsyncLogging* g_asyncLog = NULL;
+
+void asyncRecord(const char* record, int len, Logger::LogLevel level)
+{
+  g_asyncLog->append(record, len, level);
+}
+
+void asyncLine(const char* msg, int len)
+{
+  g_asyncLog->append(msg, len);
+}
+
+// Content of the files of the current directory whose names start with
+// prefix, removing the files.
+string readFiles(const string& prefix)
+{
+  string content;
+  DIR* dir = ::opendir(".");
+  assert(dir);
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) != 0)
+      continue;
+    string file;
+    int err = FileUtil::readFile(entry->d_name, 64*1024*1024, &file);
+    assert(err == 0);
+    content += file;
+    ::unlink(entry->d_name);
+  }
+  ::closedir(dir);
+  return content;
+}
+
+const int kLines = 1000;
+
+void logMixed(const string& basename, bool keepBinary)
+{
+  AsyncLogging log(basename, 500*1000*1000);
+  log.setKeepBinary(keepBinary);
+  g_asyncLog = &log;
+  BinaryLog::setOutput(asyncRecord);
+  Logger::setOutput(asyncLine);
+  log.start();
+  for (int i = 0; i < kLines; ++i)
+  {
+    LOG_BINARY_INFO("binary {} of {}", i, basename);
+    LOG_INFO << "text " << i;
+  }
+  log.stop();
+  g_asyncLog = NULL;
+  BinaryLog::setOutput(NULL);
+  Logger::setOutput(saveLine);
+}
+
+void testAsyncFormat()
+{
+  logMixed("formatted", false);
+  string content = readFiles("formatted");
+  assert(content.find('\0') == string::npos);
+  assert(contains(content, "INFO  binary 0 of formatted - "));
+  assert(contains(content, "INFO  binary 999 of formatted - "));
+  assert(contains(content, "INFO  text 999 - "));
+}
+
+// What logdecoder does.
+string decode(const string& content)
+{
+  std::map<uint32_t, std::unique_ptr<BinaryLogSite>> sites;
+  string out;
+  const char* p = content.data();
+  const char* end = p + content.size();
+  while (p < end)
+  {
+    if (*p != BinaryLog::kRecordMarker && *p != BinaryLog::kSiteMarker)
+    {
+      const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+      assert(eol);
+      out.append(p, eol + 1);
+      p = eol + 1;
+      continue;
+    }
+    int n = BinaryLog::entryLength(p, end - p);
+    assert(n > 0);
+    if (*p == BinaryLog::kSiteMarker)
+    {
+      std::unique_ptr<BinaryLogSite> site(new BinaryLogSite);
+      assert(BinaryLog::parseSite(p, n, site.get()));
+      sites[site->id.load()] = std::move(site);
+    }
+    else
+    {
+      // every record is preceded by its site
+      assert(sites.count(BinaryLog::siteId(p)) == 1);
+      BinaryLog::format(*sites[BinaryLog::siteId(p)], p, n, &out);
+    }
+    p += n;
+  }
+  return out;
+}
+
+void testKeepBinary()
+{
+  logMixed("binary", true);
+  string content = readFiles("binary");
+  assert(content.find('\0') != string::npos);
+  string decoded = decode(content);
+  assert(decoded.find('\0') == string::npos);
+  assert(contains(decoded, "INFO  binary 0 of binary - "));
+  assert(contains(decoded, "INFO  binary 999 of binary - "));
+  assert(contains(decoded, "INFO  text 999 - "));
+}
+
+void nullRecord(const char*, int, Logger::LogLevel)
+{
+}
+
+void nullLine(const char*, int)
+{
+}
+
+void bench()
+{
+  const int kN = 1000*1000;
+  BinaryLog::setOutput(nullRecord);
+  Logger::setOutput(nullLine);
+  string name = "conn#1";
+  Timestamp start = Timestamp::now();
+  for (int i = 0; i < kN; ++i)
+  {
+    LOG_BINARY_INFO("{} {} bytes, {} ms", name, i, 1.5);
+  }
+  Timestamp mid = Timestamp::now();
+  for (int i = 0; i < kN; ++i)
+  {
+    LOG_INFO << name << ' ' << i << " bytes, " << 1.5 << " ms";
+  }
+  Timestamp end = Timestamp::now();
+  printf("LOG_BINARY %.1f ns/call, LOG_INFO %.1f ns/call\n",
+         timeDifference(mid, start) * 1e9 / kN,
+         timeDifference(end, mid) * 1e9 / kN);
+  BinaryLog::setOutput(NULL);
+  Logger::setOutput(saveLine);
+}
+
+int main()
+{
+  {
+    ScratchDir dir("/tmp/binarylog_unittest");
+    testFormat();
+    testAsyncFormat();
+    testKeepBinary();
+    bench();
+  }
+  printf("OK\n");
+}
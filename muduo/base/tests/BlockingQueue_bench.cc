@@ -110,6 +110,63 @@ class Bench
   std::vector<std::unique_ptr<muduo::Thread>> threads_;
 };
 
+// Many producers, one consumer, throughput of put/take versus putAll/takeUpTo.
+void benchProducers(int numProducers, int batch)
+{
+  const int kItems = 1000000;
+  const int itemsPerProducer = kItems / numProducers;
+  muduo::BlockingQueue<int> queue;
+  muduo::CountDownLatch latch(1);
+  std::vector<std::unique_ptr<muduo::Thread>> producers;
+  for (int i = 0; i < numProducers; ++i)
+  {
+    producers.emplace_back(new muduo::Thread([&queue, &latch, itemsPerProducer, batch]
+    {
+      latch.wait();
+      std::vector<int> items;
+      for (int n = 0; n < itemsPerProducer; ++n)
+      {
+        if (batch == 1)
+        {
+          queue.put(n);
+          continue;
+        }
+        items.push_back(n);
+        if (static_cast<int>(items.size()) == batch)
+        {
+          queue.putAll(std::move(items));
+        }
+      }
+      queue.putAll(std::move(items));
+    }, "producer"));
+    producers.back()->start();
+  }
+
+  muduo::Timestamp start(muduo::Timestamp::now());
+  latch.countDown();
+  const int total = itemsPerProducer * numProducers;
+  int received = 0;
+  while (received < total)
+  {
+    if (batch == 1)
+    {
+      queue.take();
+      ++received;
+    }
+    else
+    {
+      received += static_cast<int>(queue.takeUpTo(batch).size());
+    }
+  }
+  double elapsed = timeDifference(muduo::Timestamp::now(), start);
+  for (auto& thr : producers)
+  {
+    thr->join();
+  }
+  printf("%d producers, batch %3d: %.3fs, %.0f items/s\n",
+         numProducers, batch, elapsed, total / elapsed);
+}
+
 int main(int argc, char* argv[])
 {
   int threads = argc > 1 ? atoi(argv[1]) : 1;
@@ -117,4 +174,9 @@ int main(int argc, char* argv[])
   Bench t(threads);
   t.run(100000);
   t.joinAll();
+
+  for (int batch : { 1, 16, 128 })
+  {
+    benchProducers(threads, batch);
+  }
 }
@@ -11,12 +11,14 @@
 
 // hot potato benchmarking https://en.wikipedia.org/wiki/Hot_potato
 // N threads, one hot potato.
+// With batch > 1, N threads pass batch potatoes around using putAll/takeUpTo.
 class Bench
 {
  public:
-  Bench(int numThreads)
+  Bench(int numThreads, int batch)
     : startLatch_(numThreads),
-      stopLatch_(1)
+      stopLatch_(1),
+      batch_(batch)
   {
     queues_.reserve(numThreads);
     threads_.reserve(numThreads);
@@ -48,12 +50,20 @@ class Bench
   {
     muduo::Timestamp start = muduo::Timestamp::now();
     const int rounds = 100003;
-    queues_[0]->put(rounds);
+    if (batch_ == 1)
+    {
+      queues_[0]->put(rounds);
+    }
+    else
+    {
+      queues_[0]->putAll(std::vector<int>(batch_, rounds));
+    }
 
     auto done = done_.take();
     double elapsed = timeDifference(done.second, start);
-    printf("thread id=%d done, total %.3fms, %.3fus / round\n",
-           done.first, 1e3 * elapsed, 1e6 * elapsed / rounds);
+    printf("thread id=%d done, total %.3fms, %.3fus / round, %.3fus / potato\n",
+           done.first, 1e3 * elapsed, 1e6 * elapsed / rounds,
+           1e6 * elapsed / rounds / batch_);
   }
 
   void Stop()
@@ -80,6 +90,11 @@ class Bench
 
     muduo::BlockingQueue<int>* input = queues_[id].get();
     muduo::BlockingQueue<int>* output = queues_[(id+1) % queues_.size()].get();
+    if (batch_ > 1)
+    {
+      threadFuncBatch(id, input, output);
+      return;
+    }
     while (true)
     {
       int value = input->take();
@@ -101,21 +116,48 @@ class Bench
     }
   }
 
+  void threadFuncBatch(int id,
+                       muduo::BlockingQueue<int>* input,
+                       muduo::BlockingQueue<int>* output)
+  {
+    bool running = true;
+    std::vector<int> forward;
+    while (running)
+    {
+      for (int value : input->takeUpTo(batch_))
+      {
+        if (value > 0)
+        {
+          forward.push_back(value - 1);
+          continue;
+        }
+        if (value == 0 && running)
+        {
+          done_.put(std::make_pair(id, muduo::Timestamp::now()));
+        }
+        running = false;
+      }
+      output->putAll(std::move(forward));
+    }
+  }
+
   using TimestampQueue = muduo::BlockingQueue<std::pair<int, muduo::Timestamp>>;
   TimestampQueue done_;
   muduo::CountDownLatch startLatch_, stopLatch_;
   std::vector<std::unique_ptr<muduo::BlockingQueue<int>>> queues_;
   std::vector<std::unique_ptr<muduo::Thread>> threads_;
+  const int batch_;
   const bool verbose_ = true;
 };
 
 int main(int argc, char* argv[])
 {
   int threads = argc > 1 ? atoi(argv[1]) : 1;
+  int batch = argc > 2 ? atoi(argv[2]) : 1;
 
   printf("sizeof BlockingQueue = %zd\n", sizeof(muduo::BlockingQueue<int>));
   printf("sizeof deque<int> = %zd\n", sizeof(std::deque<int>));
-  Bench t(threads);
+  Bench t(threads, batch);
   t.Start();
   t.Run();
   t.Stop();
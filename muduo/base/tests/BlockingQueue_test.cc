@@ -95,6 +95,29 @@ void testMove()
   printf("took %d\n", *y);
 }
 
+void testBatch()
+{
+  muduo::BlockingQueue<std::unique_ptr<int>> queue;
+  std::vector<std::unique_ptr<int>> items;
+  for (int i = 0; i < 10; ++i)
+  {
+    items.emplace_back(new int(i));
+  }
+  queue.putAll(std::move(items));
+  assert(items.empty());
+  assert(queue.size() == 10);
+
+  std::vector<std::unique_ptr<int>> first = queue.takeUpTo(4);
+  printf("took %zd, first %d\n", first.size(), *first.front());
+  assert(first.size() == 4);
+
+  std::vector<std::unique_ptr<int>> rest;
+  size_t n = queue.drainTo(&rest);
+  printf("drained %zd, last %d\n", n, *rest.back());
+  assert(n == 6 && queue.size() == 0);
+  (void) n;
+}
+
 int main()
 {
   //两个函数返回相同值
@@ -105,6 +128,7 @@ int main()
   t.joinAll();
 
   testMove();
+  testBatch();
 
   printf("number of created threads %d\n", muduo::Thread::numCreated());
 }
@@ -0,0 +1,83 @@
+#include "muduo/base/BoundedBlockingQueue.h"
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/LockFreeBoundedBlockingQueue.h"
+#include "muduo/base/Thread.h"
+#include "muduo/base/Timestamp.h"
+
+#include <memory>
+#include <vector>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// N producers and N consumers on one bounded queue,
+// mutex + condition versus lock-free ring.
+template<typename Queue>
+double bench(int numThreads, int capacity, int itemsPerProducer)
+{
+  Queue queue(capacity);
+  muduo::CountDownLatch start(1);
+  std::vector<std::unique_ptr<muduo::Thread>> threads;
+  std::vector<int64_t> sums(numThreads);
+  for (int i = 0; i < numThreads; ++i)
+  {
+    threads.emplace_back(new muduo::Thread([&queue, &start, itemsPerProducer]
+    {
+      start.wait();
+      for (int n = 1; n <= itemsPerProducer; ++n)
+      {
+        queue.put(n);
+      }
+    }, "producer"));
+    threads.emplace_back(new muduo::Thread([&queue, &start, &sums, i, itemsPerProducer]
+    {
+      start.wait();
+      int64_t sum = 0;
+      for (int n = 0; n < itemsPerProducer; ++n)
+      {
+        sum += queue.take();
+      }
+      sums[i] = sum;
+    }, "consumer"));
+  }
+  for (auto& thr : threads)
+  {
+    thr->start();
+  }
+
+  muduo::Timestamp begin(muduo::Timestamp::now());
+  start.countDown();
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+  double elapsed = timeDifference(muduo::Timestamp::now(), begin);
+
+  int64_t total = 0;
+  for (int64_t sum : sums)
+  {
+    total += sum;
+  }
+  int64_t expected = static_cast<int64_t>(itemsPerProducer) * (itemsPerProducer + 1) / 2 * numThreads;
+  if (total != expected)
+  {
+    printf("checksum mismatch %" PRId64 " != %" PRId64 "\n", total, expected);
+    abort();
+  }
+  return static_cast<double>(itemsPerProducer) * numThreads / elapsed;
+}
+
+int main(int argc, char* argv[])
+{
+  int capacity = argc > 1 ? atoi(argv[1]) : 1024;
+  const int kItems = 1000000;
+  printf("capacity %d\n", capacity);
+  printf("%8s %16s %16s\n", "threads", "mutex items/s", "lockfree items/s");
+  for (int threads = 1; threads <= 32; threads *= 2)
+  {
+    int items = kItems / threads;
+    double mutex = bench<muduo::BoundedBlockingQueue<int>>(threads, capacity, items);
+    double lockfree = bench<muduo::LockFreeBoundedBlockingQueue<int>>(threads, capacity, items);
+    printf("%8d %16.0f %16.0f\n", threads, mutex, lockfree);
+  }
+}
@@ -0,0 +1,93 @@
+#include "muduo/base/LockFreeBoundedBlockingQueue.h"
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Thread.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+void testSingleThread()
+{
+  muduo::LockFreeBoundedBlockingQueue<std::string> queue(3);
+  assert(queue.empty());
+  assert(queue.capacity() == 3);
+  queue.put("a");
+  queue.put(std::string("b"));
+  assert(queue.tryPut("c"));
+  assert(queue.full());
+  assert(!queue.tryPut("d"));
+  assert(queue.take() == "a");
+  queue.put("d");
+  assert(queue.take() == "b");
+  assert(queue.take() == "c");
+  assert(queue.take() == "d");
+  std::string x;
+  assert(!queue.tryTake(&x));
+  assert(queue.size() == 0);
+  printf("testSingleThread passed\n");
+}
+
+void testMove()
+{
+  muduo::LockFreeBoundedBlockingQueue<std::unique_ptr<int>> queue(1);
+  queue.put(std::unique_ptr<int>(new int(42)));
+  std::unique_ptr<int> x = queue.take();
+  assert(*x == 42);
+  queue.put(std::move(x));
+  printf("testMove passed\n");
+}
+
+// small ring, so producers and consumers keep blocking on the futexes
+void testBlocking(int numThreads)
+{
+  const int kItems = 100000;
+  muduo::LockFreeBoundedBlockingQueue<int> queue(4);
+  muduo::CountDownLatch latch(numThreads);
+  std::vector<std::unique_ptr<muduo::Thread>> consumers;
+  std::vector<int64_t> sums(numThreads);
+  for (int i = 0; i < numThreads; ++i)
+  {
+    consumers.emplace_back(new muduo::Thread([&queue, &latch, &sums, i]
+    {
+      latch.countDown();
+      int64_t sum = 0;
+      int x;
+      while ((x = queue.take()) >= 0)
+      {
+        sum += x;
+      }
+      sums[i] = sum;
+    }, "consumer"));
+    consumers.back()->start();
+  }
+  latch.wait();
+  for (int n = 1; n <= kItems; ++n)
+  {
+    queue.put(n);
+  }
+  for (int i = 0; i < numThreads; ++i)
+  {
+    queue.put(-1);
+  }
+  int64_t total = 0;
+  for (int i = 0; i < numThreads; ++i)
+  {
+    consumers[i]->join();
+    total += sums[i];
+  }
+  assert(total == static_cast<int64_t>(kItems) * (kItems + 1) / 2);
+  assert(queue.empty());
+  printf("testBlocking(%d) passed\n", numThreads);
+  (void) total;
+}
+
+int main()
+{
+  testSingleThread();
+  testMove();
+  testBlocking(1);
+  testBlocking(4);
+}
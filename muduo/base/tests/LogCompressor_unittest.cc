@@ -0,0 +1,239 @@
+// Rolled files compressed by LogCompressor and the retention of old files.
+
+#include "muduo/base/LogCompressor.h"
+#include "muduo/base/FileUtil.h"
+#include "muduo/base/GzipFile.h"
+#include "muduo/base/LogFile.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/base/tests/ScratchDir.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#undef NDEBUG
+#include <assert.h>
+
+using namespace muduo;
+
+bool exists(const string& filename)
+{
+  return ::access(filename.c_str(), F_OK) == 0;
+}
+
+// Sorted names of the files of the current directory starting with prefix.
+std::vector<string> listFiles(const string& prefix)
+{
+  std::vector<string> names;
+  DIR* dir = ::opendir(".");
+  assert(dir);
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0)
+      names.push_back(entry->d_name);
+  }
+  ::closedir(dir);
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+void removeFiles(const string& prefix)
+{
+  for (const string& name : listFiles(prefix))
+  {
+    ::unlink(name.c_str());
+  }
+}
+
+void writeFile(const string& filename, const string& content)
+{
+  FileUtil::AppendFile file(filename);
+  file.append(content.data(), content.size());
+}
+
+string readGzip(const string& filename)
+{
+  GzipFile gz = GzipFile::openForRead(filename);
+  assert(gz.valid());
+  string content;
+  char buf[8192];
+  int n;
+  while ((n = gz.read(buf, sizeof buf)) > 0)
+  {
+    content.append(buf, n);
+  }
+  assert(n == 0);
+  return content;
+}
+
+std::vector<string> g_rolled;
+
+void rolled(const string& filename)
+{
+  g_rolled.push_back(filename);
+}
+
+void testRollCallback()
+{
+  string line(100, 'x');
+  line.back() = '\n';
+  {
+    LogFile log("roll", 1000, false);
+    log.setRollCallback(rolled);
+    // at most one file a second
+    for (int i = 0; i < 20; ++i)
+      log.append(line.data(), static_cast<int>(line.size()));
+    assert(g_rolled.empty());
+    ::sleep(1);
+    log.append(line.data(), static_cast<int>(line.size()));
+    assert(g_rolled.size() == 1);
+    assert(log.rollCount() == 2);
+  }
+  std::vector<string> files = listFiles("roll.");
+  assert(files.size() == 2);
+  // the file closed is the older one
+  assert(g_rolled[0] == files[0]);
+  int64_t size = 0;
+  string content;
+  FileUtil::readFile(g_rolled[0], 1024*1024, &content, &size);
+  assert(size == 2100);
+  removeFiles("roll.");
+}
+
+void testCompress()
+{
+  string content;
+  for (int i = 0; i < 10000; ++i)
+  {
+    char buf[64];
+    snprintf(buf, sizeof buf, "20261019 01:02:03.%06dZ  1234 INFO  line %d\n", i, i);
+    content += buf;
+  }
+  const string name = "compress.20261019-010203.host.1234.log";
+  writeFile(name, content);
+
+  LogCompressor compressor("compress");
+  compressor.start();
+  compressor.add(name);
+  compressor.stop();
+  assert(compressor.compressedFiles() == 1);
+  assert(compressor.removedFiles() == 0);
+  assert(!exists(name));
+  assert(!exists(name + ".gz.tmp"));
+  assert(readGzip(name + ".gz") == content);
+
+  // a file gone is skipped
+  LogCompressor again("compress");
+  again.start();
+  again.add("compress.20261019-010204.host.1234.log");
+  again.stop();
+  assert(again.compressedFiles() == 0);
+  assert(listFiles("compress.").size() == 1);
+  removeFiles("compress.");
+}
+
+void testRetention()
+{
+  for (int i = 1; i <= 5; ++i)
+  {
+    char name[64];
+    snprintf(name, sizeof name, "keep.2026101%d-000000.host.1.log", i);
+    writeFile(name, string(1000, 'k'));
+  }
+  writeFile("keep.txt", "other files are kept");
+  writeFile("keeper.20261011-000000.host.1.log", "other basenames are kept");
+  writeFile("keep.spill.20261019-000000.host.1.log", "spill files are kept");
+
+  {
+    LogCompressor compressor("keep");
+    compressor.setRetention(3, 0);
+    compressor.start();
+    compressor.stop();
+    assert(compressor.removedFiles() == 2);
+  }
+  std::vector<string> files = listFiles("keep.");
+  assert(files.size() == 5);
+  assert(files[0] == "keep.20261013-000000.host.1.log");
+
+  // compressed files count too
+  {
+    LogCompressor compressor("keep");
+    compressor.setRetention(3, 0);
+    compressor.start();
+    compressor.add("keep.20261014-000000.host.1.log");
+    compressor.stop();
+    assert(compressor.compressedFiles() == 1);
+  }
+  files = listFiles("keep.");
+  assert(files.size() == 5);
+  assert(files[1] == "keep.20261014-000000.host.1.log.gz");
+
+  // by size, the newest is kept even if it is over
+  {
+    LogCompressor compressor("keep");
+    compressor.setRetention(0, 1);
+    compressor.start();
+    compressor.stop();
+    assert(compressor.removedFiles() == 2);
+  }
+  files = listFiles("keep");
+  assert(files.size() == 4);
+  assert(files[0] == "keep.20261015-000000.host.1.log");
+  assert(files[1] == "keep.spill.20261019-000000.host.1.log");
+  assert(files[2] == "keep.txt");
+  assert(files[3] == "keeper.20261011-000000.host.1.log");
+
+  // files after the last one closed may be open
+  {
+    LogCompressor compressor("keep");
+    compressor.setRetention(1, 0);
+    compressor.start();
+    // after the first scan
+    ::usleep(100*1000);
+    writeFile("keep.20261016-000000.host.1.log", string(1000, 'k'));
+    writeFile("keep.20261017-000000.host.1.log", string(1000, 'k'));
+    compressor.add("keep.20261015-000000.host.1.log");
+    compressor.stop();
+    assert(compressor.compressedFiles() == 1);
+    assert(compressor.removedFiles() == 1);
+  }
+  files = listFiles("keep.");
+  assert(files.size() == 4);
+  assert(files[0] == "keep.20261016-000000.host.1.log");
+  assert(files[1] == "keep.20261017-000000.host.1.log");
+  assert(files[2] == "keep.spill.20261019-000000.host.1.log");
+  removeFiles("keep");
+}
+
+void testRateLimit()
+{
+  const string name = "slow.20261019-000000.host.1.log";
+  writeFile(name, string(1024*1024, 's'));
+  LogCompressor compressor("slow");
+  compressor.setRateLimit(4*1024*1024);
+  Timestamp start(Timestamp::now());
+  compressor.start();
+  compressor.add(name);
+  compressor.stop();
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("1MB at 4MB/s in %.3f seconds\n", seconds);
+  assert(seconds > 0.2);
+  assert(readGzip(name + ".gz").size() == 1024*1024);
+  removeFiles("slow.");
+}
+
+int main()
+{
+  {
+    // LogFile and LogCompressor work in the current directory
+    ScratchDir dir("/tmp/logcompressor_unittest");
+    testRollCallback();
+    testCompress();
+    testRetention();
+    testRateLimit();
+  }
+  printf("OK\n");
+}
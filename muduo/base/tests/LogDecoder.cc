@@ -0,0 +1,88 @@
+// Formats the BinaryLog records in files written by AsyncLogging with
+// setKeepBinary(true), lines of text are printed as they are.
+//
+// Usage: logdecoder file...
+
+#include "muduo/base/BinaryLog.h"
+#include "muduo/base/FileUtil.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+
+// Sites point into the contents of the files, kept until exit.
+std::map<uint32_t, std::unique_ptr<BinaryLogSite>> g_sites;
+
+void decode(const string& content)
+{
+  const char* p = content.data();
+  const char* end = p + content.size();
+  string line;
+  while (p < end)
+  {
+    if (*p != BinaryLog::kRecordMarker && *p != BinaryLog::kSiteMarker)
+    {
+      const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+      const char* next = eol ? eol + 1 : end;
+      fwrite(p, 1, next - p, stdout);
+      p = next;
+      continue;
+    }
+    int n = BinaryLog::entryLength(p, end - p);
+    if (n == 0)
+    {
+      fprintf(stderr, "broken entry at offset %zd\n", p - content.data());
+      return;
+    }
+    if (*p == BinaryLog::kSiteMarker)
+    {
+      std::unique_ptr<BinaryLogSite> site(new BinaryLogSite);
+      if (BinaryLog::parseSite(p, n, site.get()))
+      {
+        g_sites[site->id.load()] = std::move(site);
+      }
+    }
+    else
+    {
+      auto it = g_sites.find(BinaryLog::siteId(p));
+      if (it != g_sites.end())
+      {
+        line.clear();
+        BinaryLog::format(*it->second, p, n, &line);
+        fwrite(line.data(), 1, line.size(), stdout);
+      }
+      else
+      {
+        printf("record of unknown site %u\n", BinaryLog::siteId(p));
+      }
+    }
+    p += n;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    printf("Usage: %s file...\n", argv[0]);
+    return 1;
+  }
+  std::vector<std::unique_ptr<string>> contents;
+  for (int i = 1; i < argc; ++i)
+  {
+    contents.emplace_back(new string);
+    int64_t size = 0;
+    int err = FileUtil::readFile(argv[i], 1024*1024*1024, contents.back().get(), &size);
+    if (err != 0)
+    {
+      fprintf(stderr, "%s: %s\n", argv[i], strerror(err));
+      return 1;
+    }
+    decode(*contents.back());
+  }
+}
@@ -0,0 +1,253 @@
+// LogFile writers give the same files.
+
+#include "muduo/base/FileUtil.h"
+#include "muduo/base/LogFile.h"
+#include "muduo/base/tests/ScratchDir.h"
+
+#ifdef HAVE_ZLIB
+#include "muduo/base/GzipFile.h"
+#endif
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#undef NDEBUG
+#include <assert.h>
+
+using namespace muduo;
+
+// Content of the files of the current directory whose names start with
+// prefix, in the order of their names, removing the files.
+string readFiles(const string& prefix, int* files)
+{
+  std::vector<string> names;
+  DIR* dir = ::opendir(".");
+  assert(dir);
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0)
+      names.push_back(entry->d_name);
+  }
+  ::closedir(dir);
+  std::sort(names.begin(), names.end());
+  string content;
+  for (const string& name : names)
+  {
+    string file;
+    int err = FileUtil::readFile(name, 64*1024*1024, &file);
+    assert(err == 0);
+    content += file;
+    ::unlink(name.c_str());
+  }
+  *files = static_cast<int>(names.size());
+  return content;
+}
+
+string randomLine(std::mt19937* gen, int n)
+{
+  size_t len = (*gen)() % 3000;
+  string line = "line " + std::to_string(n) + " ";
+  line.append(len, static_cast<char>('a' + n % 26));
+  line += '\n';
+  return line;
+}
+
+void testDirectAppendFile(bool direct)
+{
+  const char* name = "direct.log";
+  string expected;
+  std::mt19937 gen(7);
+  bool usedDirect = false;
+  {
+    FileUtil::DirectAppendFile file(name, direct, 1024*1024);
+    usedDirect = file.direct();
+    for (int i = 0; i < 2000; ++i)
+    {
+      string line = randomLine(&gen, i);
+      file.append(line.data(), line.size());
+      expected += line;
+      if (i % 97 == 0)
+      {
+        file.flush();
+        // the file ends at what was written, padded to a block with O_DIRECT
+        struct stat st;
+        assert(::stat(name, &st) == 0);
+        off_t size = static_cast<off_t>(expected.size());
+        if (file.direct())
+        {
+          const off_t kBlock = FileUtil::DirectAppendFile::kAlignment;
+          size = (size + kBlock - 1) / kBlock * kBlock;
+        }
+        assert(st.st_size == size);
+      }
+    }
+    assert(file.writtenBytes() == static_cast<off_t>(expected.size()));
+  }
+  // appending to an existing file
+  {
+    FileUtil::DirectAppendFile file(name, direct, 0);
+    file.append("tail\n", 5);
+    expected += "tail\n";
+  }
+  printf("DirectAppendFile O_DIRECT %s, %zd bytes\n",
+         usedDirect ? "on" : "off", expected.size());
+  int files = 0;
+  assert(readFiles(name, &files) == expected);
+  assert(files == 1);
+}
+
+void testPreallocate(bool direct)
+{
+  const char* name = "prealloc.log";
+  const off_t kPreallocate = 8*1024*1024;
+  struct stat st;
+  {
+    FileUtil::DirectAppendFile file(name, direct, kPreallocate);
+    file.append("line\n", 5);
+    file.flush();
+    assert(::stat(name, &st) == 0);
+    const off_t kBlock = FileUtil::DirectAppendFile::kAlignment;
+    assert(st.st_size == (file.direct() ? kBlock : 5));
+    printf("preallocated %lld bytes, O_DIRECT %s\n",
+           static_cast<long long>(st.st_blocks) * 512, file.direct() ? "on" : "off");
+    // kept after a flush
+    assert(st.st_blocks * 512 >= kPreallocate);
+    file.append("more\n", 5);
+    file.flush();
+    assert(::stat(name, &st) == 0);
+    assert(st.st_blocks * 512 >= kPreallocate);
+  }
+  // given back when closed
+  assert(::stat(name, &st) == 0);
+  assert(st.st_size == 10);
+  assert(st.st_blocks * 512 < kPreallocate / 2);
+  string content;
+  assert(FileUtil::readFile(name, 1024, &content) == 0);
+  assert(content == "line\nmore\n");
+  ::unlink(name);
+}
+
+void testLogFile(LogFile::Writer writer)
+{
+  const string basename = "writer";
+  const off_t kRollSize = 1024*1024;
+  string expected;
+  std::mt19937 gen(11);
+  {
+    LogFile log(basename, kRollSize, false, 3, 64, writer);
+    const int kLines = 1000;
+    for (int i = 0; i < kLines; ++i)
+    {
+      string line = randomLine(&gen, i);
+      log.append(line.data(), static_cast<int>(line.size()));
+      expected += line;
+      // LogFile rolls at most once a second
+      if (i == kLines / 2)
+      {
+        log.flush();
+        ::sleep(1);
+      }
+    }
+  }
+  int files = 0;
+  assert(readFiles(basename, &files) == expected);
+  printf("LogFile writer %d, %d files\n", writer, files);
+  assert(files > 1);
+}
+
+#ifdef HAVE_ZLIB
+string gunzip(const string& filename)
+{
+  GzipFile gz = GzipFile::openForRead(filename);
+  assert(gz.valid());
+  string content;
+  char buf[8192];
+  int n;
+  // a truncated member is an error after what it gives
+  while ((n = gz.read(buf, sizeof buf)) > 0)
+  {
+    content.append(buf, n);
+  }
+  return content;
+}
+
+void testGzip(LogFile::Writer writer)
+{
+  const string basename = "gzip";
+  string expected;
+  string flushed;   // up to the last flush
+  std::mt19937 gen(13);
+  string filename;
+  {
+    LogFile log(basename, 64*1024*1024, false, 3, 1024, writer, 1);
+    for (int i = 0; i < 1000; ++i)
+    {
+      string line = randomLine(&gen, i);
+      log.append(line.data(), static_cast<int>(line.size()));
+      expected += line;
+      if (i % 300 == 0)
+      {
+        log.flush();
+        flushed = expected;
+      }
+    }
+    log.flush();
+    log.flush();  // no empty member
+    flushed = expected;
+    log.append("unflushed\n", 10);
+
+    DIR* dir = ::opendir(".");
+    while (struct dirent* entry = ::readdir(dir))
+    {
+      if (strncmp(entry->d_name, basename.c_str(), basename.size()) == 0)
+        filename = entry->d_name;
+    }
+    ::closedir(dir);
+    assert(filename.size() > 7 && filename.compare(filename.size() - 7, 7, ".log.gz") == 0);
+
+    // as if the process died now
+    string content;
+    int err = FileUtil::readFile(filename, 64*1024*1024, &content);
+    assert(err == 0);
+    assert(content.size() < expected.size() / 10);
+    // 5 members, each with its own header
+    int members = 0;
+    for (size_t pos = 0; (pos = content.find("\x1f\x8b\x08", pos)) != string::npos; ++pos)
+      ++members;
+    assert(members >= 5);
+    assert(gunzip(filename) == flushed);
+  }
+  // the last member is ended when closed
+  expected += "unflushed\n";
+  assert(gunzip(filename) == expected);
+  printf("LogFile gzip writer %d, %zd bytes\n", writer, expected.size());
+  ::unlink(filename.c_str());
+}
+#endif
+
+int main()
+{
+  {
+    // not in /tmp, which is often tmpfs without O_DIRECT
+    ScratchDir dir("logfile_unittest");
+    testDirectAppendFile(false);
+    testDirectAppendFile(true);
+    testPreallocate(false);
+    testPreallocate(true);
+    testLogFile(LogFile::kStdio);
+    testLogFile(LogFile::kPwrite);
+    testLogFile(LogFile::kDirect);
+#ifdef HAVE_ZLIB
+    testGzip(LogFile::kStdio);
+    testGzip(LogFile::kDirect);
+#endif
+  }
+  printf("OK\n");
+}
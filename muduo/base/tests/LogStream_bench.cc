@@ -1,6 +1,9 @@
 #include "muduo/base/LogStream.h"
+#include "muduo/base/Logging.h"
 #include "muduo/base/Timestamp.h"
+#include "muduo/base/TimeZone.h"
 
+#include <algorithm>
 #include <sstream>
 #include <stdio.h>
 #define __STDC_FORMAT_MACROS
@@ -40,6 +43,41 @@ void benchStringStream()
   printf("benchStringStream %f\n", timeDifference(end, start));
 }
 
+// The one digit a division loop LogStream used before.
+template<typename T>
+size_t convertOneDigit(char buf[], T value)
+{
+  static const char digits[] = "9876543210123456789";
+  static const char* zero = digits + 9;
+  T i = value;
+  char* p = buf;
+  do
+  {
+    int lsd = static_cast<int>(i % 10);
+    i /= 10;
+    *p++ = zero[lsd];
+  } while (i != 0);
+  if (value < 0)
+  {
+    *p++ = '-';
+  }
+  *p = '\0';
+  std::reverse(buf, p);
+  return p - buf;
+}
+
+template<typename T>
+void benchOneDigit()
+{
+  char buf[32];
+  Timestamp start(Timestamp::now());
+  for (size_t i = 0; i < N; ++i)
+    convertOneDigit(buf, (T)(i));
+  Timestamp end(Timestamp::now());
+
+  printf("benchOneDigit %f\n", timeDifference(end, start));
+}
+
 template<typename T>
 void benchLogStream()
 {
@@ -55,6 +93,24 @@ void benchLogStream()
   printf("benchLogStream %f\n", timeDifference(end, start));
 }
 
+void nullOutput(const char*, int)
+{
+}
+
+// whole lines, from the Logger constructor to the output function
+void benchLogLine(const char* name)
+{
+  Logger::setOutput(nullOutput);
+  Timestamp start(Timestamp::now());
+  for (size_t i = 0; i < N; ++i)
+  {
+    LOG_INFO << "Hello " << i;
+  }
+  Timestamp end(Timestamp::now());
+
+  printf("benchLogLine %-10s %.1f ns/line\n", name, timeDifference(end, start) * 1e9 / N);
+}
+
 int main()
 {
   benchPrintf<int>("%d");
@@ -62,16 +118,20 @@ int main()
   puts("int");
   benchPrintf<int>("%d");
   benchStringStream<int>();
+  benchOneDigit<int>();
   benchLogStream<int>();
 
   puts("double");
+  // the snprintf LogStream used before, and the digits to read back
   benchPrintf<double>("%.12g");
+  benchPrintf<double>("%.17g");
   benchStringStream<double>();
   benchLogStream<double>();
 
   puts("int64_t");
   benchPrintf<int64_t>("%" PRId64);
   benchStringStream<int64_t>();
+  benchOneDigit<int64_t>();
   benchLogStream<int64_t>();
 
   puts("void*");
@@ -79,4 +139,11 @@ int main()
   benchStringStream<void*>();
   benchLogStream<void*>();
 
+  puts("LOG_INFO");
+  benchLogLine("UTC");
+  Logger::setTimeZone(TimeZone(8*3600, "CST"));
+  benchLogLine("CST");
+  Logger::setTimeZone(TimeZone());
+  Logger::setMonotonicTime(true);
+  benchLogLine("monotonic");
 }
@@ -1,7 +1,11 @@
 #include "muduo/base/LogStream.h"
 
 #include <limits>
+#include <random>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 //#define BOOST_TEST_MODULE LogStreamTest
 #define BOOST_TEST_MAIN
@@ -150,8 +154,9 @@ BOOST_AUTO_TEST_CASE(testLogStreamFloats)
   BOOST_CHECK_EQUAL(buf.toString(), string("0.15"));
   os.resetBuffer();
 
+  // shortest digits that read back, not 12 significant digits
   os << a+b;
-  BOOST_CHECK_EQUAL(buf.toString(), string("0.15"));
+  BOOST_CHECK_EQUAL(buf.toString(), string("0.15000000000000002"));
   os.resetBuffer();
 
   BOOST_CHECK(a+b != c);
@@ -167,6 +172,205 @@ BOOST_AUTO_TEST_CASE(testLogStreamFloats)
   os << -123.456;
   BOOST_CHECK_EQUAL(buf.toString(), string("-123.456"));
   os.resetBuffer();
+
+  const struct
+  {
+    double value;
+    const char* text;
+  } cases[] =
+  {
+    { -0.0, "-0" },
+    { 1.0/3, "0.3333333333333333" },
+    { 2.0/3, "0.6666666666666666" },
+    { 100, "100" },
+    { 1e16, "10000000000000000" },
+    { 1e17, "1e+17" },
+    { 123456789012345680.0, "1.2345678901234568e+17" },
+    { 9007199254740993.0, "9007199254740992" },
+    { 0.0001, "0.0001" },
+    { 0.000123, "0.000123" },
+    { 0.00001, "1e-05" },
+    { 1.5e-7, "1.5e-07" },
+    { 1e100, "1e+100" },
+    { 5e-324, "5e-324" },
+    { 2.2250738585072014e-308, "2.2250738585072014e-308" },
+    { std::numeric_limits<double>::max(), "1.7976931348623157e+308" },
+    { std::numeric_limits<double>::infinity(), "inf" },
+    { -std::numeric_limits<double>::infinity(), "-inf" },
+    { std::numeric_limits<double>::quiet_NaN(), "nan" },
+  };
+  for (const auto& expected : cases)
+  {
+    os << expected.value;
+    BOOST_CHECK_EQUAL(buf.toString(), string(expected.text));
+    os.resetBuffer();
+  }
+
+  // digits of the float, not of the double it widens to
+  const struct
+  {
+    float value;
+    const char* text;
+  } floatCases[] =
+  {
+    { 1.5f, "1.5" },
+    { 0.1f, "0.1" },
+    { -0.0f, "-0" },
+    { 1.0f/3, "0.33333334" },
+    { 123456.79f, "123456.79" },
+    { 16777216.0f, "16777216" },
+    { 1e-45f, "1e-45" },
+    { 1.1754944e-38f, "1.1754944e-38" },
+    { std::numeric_limits<float>::max(), "3.4028235e+38" },
+    { std::numeric_limits<float>::infinity(), "inf" },
+  };
+  for (const auto& expected : floatCases)
+  {
+    os << expected.value;
+    BOOST_CHECK_EQUAL(buf.toString(), string(expected.text));
+    os.resetBuffer();
+  }
+}
+
+// Fewest significant digits with which %g reads back to v.
+int shortestDigits(double v)
+{
+  char buf[64];
+  for (int precision = 1; precision < 17; ++precision)
+  {
+    snprintf(buf, sizeof buf, "%.*g", precision, v);
+    if (strtod(buf, NULL) == v)
+      return precision;
+  }
+  return 17;
+}
+
+int shortestDigits(float v)
+{
+  char buf[64];
+  for (int precision = 1; precision < 9; ++precision)
+  {
+    snprintf(buf, sizeof buf, "%.*g", precision, v);
+    if (strtof(buf, NULL) == v)
+      return precision;
+  }
+  return 9;
+}
+
+int significantDigits(const string& text)
+{
+  int digits = 0;
+  bool leading = true;
+  for (char c : text)
+  {
+    if (c == 'e')
+      break;
+    if (c >= '1' && c <= '9')
+      leading = false;
+    if (isdigit(c) && !leading)
+      ++digits;
+  }
+  // trailing zeros of an integer are not significant
+  if (text.find_first_of(".e") == string::npos)
+  {
+    for (size_t i = text.size(); i > 0 && text[i - 1] == '0'; --i)
+      --digits;
+  }
+  return digits;
+}
+
+BOOST_AUTO_TEST_CASE(testLogStreamFloatsRoundTrip)
+{
+  muduo::LogStream os;
+  const muduo::LogStream::Buffer& buf = os.buffer();
+  std::mt19937_64 gen(42);
+  int longer = 0;
+  const int kN = 200000;
+  for (int i = 0; i < kN; ++i)
+  {
+    // random bits cover all exponents, scaled ones the common values
+    uint64_t bits = gen();
+    double v;
+    memcpy(&v, &bits, sizeof v);
+    if (i % 2)
+      v = static_cast<double>(bits % 1000000) / 1000;
+    if (v != v || v - v != 0)  // nan or inf
+      continue;
+    os << v;
+    string text = buf.toString();
+    os.resetBuffer();
+    BOOST_REQUIRE_EQUAL(strtod(text.c_str(), NULL), v);
+    // Grisu2 leaves out the halfway points which round to even
+    if (significantDigits(text) > shortestDigits(v))
+      ++longer;
+  }
+  printf("%d of %d doubles have more digits than the shortest\n", longer, kN);
+  BOOST_CHECK(longer < kN / 1000);
+}
+
+BOOST_AUTO_TEST_CASE(testLogStreamFloatRoundTrip)
+{
+  muduo::LogStream os;
+  const muduo::LogStream::Buffer& buf = os.buffer();
+  std::mt19937 gen(42);
+  int longer = 0;
+  const int kN = 200000;
+  for (int i = 0; i < kN; ++i)
+  {
+    uint32_t bits = static_cast<uint32_t>(gen());
+    float v;
+    memcpy(&v, &bits, sizeof v);
+    if (i % 2)
+      v = static_cast<float>(bits % 1000000) / 1000;
+    if (v != v || v - v != 0)  // nan or inf
+      continue;
+    os << v;
+    string text = buf.toString();
+    os.resetBuffer();
+    BOOST_REQUIRE_EQUAL(strtof(text.c_str(), NULL), v);
+    // large floats are integers, the shorter ones are often halfway points
+    if (significantDigits(text) > shortestDigits(v))
+      ++longer;
+  }
+  printf("%d of %d floats have more digits than the shortest\n", longer, kN);
+  BOOST_CHECK(longer < kN / 200);
+}
+
+template<typename T>
+void checkIntegers(muduo::LogStream& os, const char* fmt, T first, T last)
+{
+  const muduo::LogStream::Buffer& buf = os.buffer();
+  char expected[64];
+  for (T i = first; ; ++i)
+  {
+    os << i;
+    snprintf(expected, sizeof expected, fmt, i);
+    BOOST_REQUIRE_EQUAL(buf.toString(), string(expected));
+    os.resetBuffer();
+    if (i == last)
+      break;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testLogStreamIntegerDigits)
+{
+  muduo::LogStream os;
+  checkIntegers<int>(os, "%d", -100100, 100100);
+  checkIntegers<int>(os, "%d", std::numeric_limits<int>::min(), std::numeric_limits<int>::min() + 1000);
+  checkIntegers<int>(os, "%d", std::numeric_limits<int>::max() - 1000, std::numeric_limits<int>::max());
+  checkIntegers<unsigned>(os, "%u", std::numeric_limits<unsigned>::max() - 1000,
+                          std::numeric_limits<unsigned>::max());
+  checkIntegers<long long>(os, "%lld", std::numeric_limits<long long>::min(),
+                           std::numeric_limits<long long>::min() + 1000);
+  checkIntegers<unsigned long long>(os, "%llu", std::numeric_limits<unsigned long long>::max() - 1000,
+                                    std::numeric_limits<unsigned long long>::max());
+  // every length
+  long long v = 1;
+  for (int i = 0; i < 18; ++i, v *= 10)
+  {
+    checkIntegers<long long>(os, "%lld", v - 2, v + 1);
+    checkIntegers<long long>(os, "%lld", -v - 1, -v + 2);
+  }
 }
 
 BOOST_AUTO_TEST_CASE(testLogStreamVoid)
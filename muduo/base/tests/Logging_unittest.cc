@@ -0,0 +1,154 @@
+// Compile time minimum level and per module levels.
+
+// TRACE statements are compiled out of this file.
+#define MUDUO_MIN_LOG_LEVEL 1
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/TimeZone.h"
+
+#include <stdio.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+using namespace muduo;
+
+int g_lines = 0;
+string g_line;
+
+void countLine(const char* msg, int len)
+{
+  ++g_lines;
+  g_line.assign(msg, len);
+}
+
+int evaluated(int* n)
+{
+  return ++*n;
+}
+
+void testMinLevel()
+{
+  Logger::setLogLevel(Logger::TRACE);
+  int n = 0;
+  LOG_TRACE << evaluated(&n);
+  assert(n == 0);
+  LOG_DEBUG << evaluated(&n);
+  assert(n == 1);
+  assert(!MUDUO_LOG_ENABLED(Logger::TRACE));
+  assert(MUDUO_LOG_ENABLED(Logger::DEBUG));
+
+  // an else goes with its own if
+  bool good = false;
+  if (good)
+    LOG_WARN << "good";
+  else
+    ++n;
+  assert(n == 2);
+  Logger::setLogLevel(Logger::INFO);
+}
+
+void testModuleLevel()
+{
+  assert(muduo::detail::muduoLogModule.name() == "Logging_unittest");
+  int before = g_lines;
+  LOG_DEBUG << "off";
+  assert(g_lines == before);
+
+  Logger::setModuleLevel("Logging_unittest", Logger::DEBUG);
+  LOG_DEBUG << "on";
+  assert(g_lines == before + 1);
+  // the global level doesn't change a module that was set
+  Logger::setLogLevel(Logger::ERROR);
+  LOG_DEBUG << "still on";
+  assert(g_lines == before + 2);
+  assert(Logger::logLevel() == Logger::ERROR);
+
+  Logger::resetModuleLevel("Logging_unittest");
+  LOG_INFO << "off";
+  assert(g_lines == before + 2);
+  Logger::setLogLevel(Logger::INFO);
+  LOG_INFO << "on";
+  assert(g_lines == before + 3);
+}
+
+void testSetLevels()
+{
+  assert(Logger::setLevels("WARN,Logging_unittest=DEBUG,EPollPoller=TRACE"));
+  assert(Logger::logLevel() == Logger::WARN);
+  assert(muduo::detail::muduoLogModule.level() == Logger::DEBUG);
+  string levels = Logger::levels();
+  printf("%s", levels.c_str());
+  assert(levels.find("* WARN  \n") == 0);
+  assert(levels.find("* DEBUG Logging_unittest\n") != string::npos);
+  // modules of other files
+  assert(levels.find("  WARN  Logging\n") != string::npos);
+
+  assert(!Logger::setLevels("Logging_unittest=,LOUD,=INFO"));
+  assert(muduo::detail::muduoLogModule.level() == Logger::WARN);
+  assert(Logger::setLevels("INFO"));
+  assert(muduo::detail::muduoLogModule.level() == Logger::INFO);
+}
+
+// The time of the line is the time of now or of the second before.
+void checkTime(Timestamp now, const TimeZone& tz)
+{
+  bool found = false;
+  for (int back = 0; back < 2 && !found; ++back)
+  {
+    time_t seconds = static_cast<time_t>(now.secondsSinceEpoch() - back);
+    struct tm tm_time = tz.valid() ? tz.toLocalTime(seconds) : TimeZone::toUtcTime(seconds);
+    char expected[64];
+    snprintf(expected, sizeof expected, "%4d%02d%02d %02d:%02d:%02d.",
+             tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+             tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+    found = g_line.compare(0, 18, expected) == 0;
+  }
+  assert(found);
+  // microseconds
+  for (int i = 18; i < 24; ++i)
+  {
+    assert(isdigit(g_line[i]));
+  }
+  if (tz.valid())
+    assert(g_line[24] == ' ');
+  else
+    assert(g_line.compare(24, 2, "Z ") == 0);
+}
+
+void testTime()
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    LOG_INFO << "time";
+    checkTime(Timestamp::now(), TimeZone());
+    printf("%s", g_line.c_str());
+  }
+  // an offset that is not whole minutes
+  TimeZone tz(-(3*3600 + 30*60 + 17), "LMT");
+  Logger::setTimeZone(tz);
+  for (int i = 0; i < 3; ++i)
+  {
+    LOG_INFO << "time";
+    checkTime(Timestamp::now(), tz);
+    printf("%s", g_line.c_str());
+  }
+  Logger::setTimeZone(TimeZone());
+
+  Logger::setMonotonicTime(true);
+  LOG_INFO << "monotonic";
+  printf("%s", g_line.c_str());
+  assert(g_line.compare(0, 3, "+0.") == 0);
+  assert(g_line[9] == ' ');
+  Logger::setMonotonicTime(false);
+}
+
+int main()
+{
+  Logger::setOutput(countLine);
+  testMinLevel();
+  testModuleLevel();
+  testSetLevels();
+  testTime();
+  printf("OK\n");
+}
@@ -0,0 +1,28 @@
+// Prints the lines in the ring of a MmapLog file, oldest first,
+// also after the process that wrote it crashed.
+//
+// Usage: mmaplogdump file
+
+#include "muduo/base/MmapLog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+
+int main(int argc, char* argv[])
+{
+  if (argc != 2)
+  {
+    printf("Usage: %s file\n", argv[0]);
+    return 1;
+  }
+  string lines;
+  int err = MmapLog::read(argv[1], &lines);
+  if (err != 0)
+  {
+    fprintf(stderr, "%s: %s\n", argv[1], strerror(err));
+    return 1;
+  }
+  fwrite(lines.data(), 1, lines.size(), stdout);
+}
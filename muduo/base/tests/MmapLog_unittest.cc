@@ -0,0 +1,157 @@
+// MmapLog keeps the last lines, also after abort().
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/MmapLog.h"
+#include "muduo/base/Thread.h"
+#include "muduo/base/tests/ScratchDir.h"
+
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+using namespace muduo;
+
+MmapLog* g_mmapLog = NULL;
+
+void mmapOutput(const char* msg, int len)
+{
+  g_mmapLog->append(msg, len);
+}
+
+void mmapFlush()
+{
+  g_mmapLog->flush();
+}
+
+int countLines(const string& lines)
+{
+  int n = 0;
+  for (char c : lines)
+  {
+    if (c == '\n')
+      ++n;
+  }
+  return n;
+}
+
+void testAppend()
+{
+  const char* name = "append.ring";
+  {
+    MmapLog log(name, 100);
+    assert(log.capacity() == 4096);
+    log.append("first\n", 6);
+    log.append("second\n", 7);
+  }
+  string lines;
+  assert(MmapLog::read(name, &lines) == 0);
+  assert(lines == "first\nsecond\n");
+
+  // continues the same file
+  {
+    MmapLog log(name, 4096);
+    log.append("third\n", 6);
+    assert(log.writtenBytes() == 19);
+  }
+  lines.clear();
+  assert(MmapLog::read(name, &lines) == 0);
+  assert(lines == "first\nsecond\nthird\n");
+
+  // a different capacity starts over
+  {
+    MmapLog log(name, 8192);
+    assert(log.writtenBytes() == 0);
+  }
+  ::unlink(name);
+}
+
+void testWrap()
+{
+  const char* name = "wrap.ring";
+  const int kThreads = 4;
+  const int kLines = 10000;
+  {
+    MmapLog log(name, 64*1024);
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+      threads.emplace_back(new Thread([&log, t] {
+        char line[64];
+        for (int i = 0; i < kLines; ++i)
+        {
+          int len = snprintf(line, sizeof line, "thread %d line %05d\n", t, i);
+          log.append(line, len);
+        }
+      }));
+      threads.back()->start();
+    }
+    for (auto& thr : threads)
+    {
+      thr->join();
+    }
+    assert(log.writtenBytes() == static_cast<uint64_t>(kThreads * kLines * 20));
+  }
+  string lines;
+  assert(MmapLog::read(name, &lines) == 0);
+  // the ring holds the last 64KB, starting at a whole line
+  assert(lines.size() > 64*1024 - 20 && lines.size() <= 64*1024);
+  assert(lines.compare(0, 7, "thread ") == 0);
+  assert(countLines(lines) == static_cast<int>(lines.size() / 20));
+  // threads may have finished long before the last one
+  bool found = false;
+  for (int t = 0; t < kThreads; ++t)
+  {
+    char last[64];
+    snprintf(last, sizeof last, "thread %d line %05d\n", t, kLines - 1);
+    found = found || lines.find(last) != string::npos;
+  }
+  assert(found);
+  ::unlink(name);
+}
+
+void testCrash()
+{
+  const char* name = "crash.ring";
+  pid_t pid = ::fork();
+  assert(pid >= 0);
+  if (pid == 0)
+  {
+    MmapLog log(name, 1024*1024);
+    g_mmapLog = &log;
+    Logger::setOutput(mmapOutput);
+    Logger::setFlush(mmapFlush);
+    for (int i = 0; i < 100000; ++i)
+    {
+      LOG_INFO << "before the crash " << i;
+    }
+    LOG_FATAL << "the last words";
+  }
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+  assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+
+  string lines;
+  assert(MmapLog::read(name, &lines) == 0);
+  size_t last = lines.rfind("before the crash 99999 ");
+  assert(last != string::npos);
+  assert(lines.find("FATAL the last words", last) != string::npos);
+  printf("%d lines after the crash, %zd bytes\n", countLines(lines), lines.size());
+  ::unlink(name);
+}
+
+int main()
+{
+  {
+    ScratchDir dir("/tmp/mmaplog_unittest");
+    testAppend();
+    testWrap();
+    testCrash();
+  }
+  printf("OK\n");
+}
@@ -1,15 +1,19 @@
+#include "muduo/base/AdaptiveCondition.h"
+#include "muduo/base/AdaptiveMutex.h"
 #include "muduo/base/CountDownLatch.h"
 #include "muduo/base/Mutex.h"
 #include "muduo/base/Thread.h"
 #include "muduo/base/Timestamp.h"
 
 #include <vector>
+#include <inttypes.h>
 #include <stdio.h>
 
 using namespace muduo;
 using namespace std;
 
 MutexLock g_mutex;
+AdaptiveMutexLock g_adaptiveMutex;
 vector<int> g_vec;
 const int kCount = 10*1000*1000;
 
@@ -22,6 +26,114 @@ void threadFunc()
   }
 }
 
+void adaptiveThreadFunc()
+{
+  for (int i = 0; i < kCount; ++i)
+  {
+    AdaptiveMutexLockGuard lock(g_adaptiveMutex);
+    g_vec.push_back(i);
+  }
+}
+
+// cost of an uncontended lock/unlock, plain, named and profiled
+void testLockProfiler()
+{
+  const int kLoops = 10*1000*1000;
+  MutexLock plain;
+  MutexLock named(MUDUO_LOCK_SITE);
+  MutexLock other("Mutex_test::other");
+
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kLoops; ++i)
+  {
+    MutexLockGuard lock(plain);
+  }
+  double plainNs = timeDifference(Timestamp::now(), start) * 1e9 / kLoops;
+
+  LockProfiler::setEnabled(false);
+  start = Timestamp::now();
+  for (int i = 0; i < kLoops; ++i)
+  {
+    MutexLockGuard lock(named);
+  }
+  double disabledNs = timeDifference(Timestamp::now(), start) * 1e9 / kLoops;
+
+  LockProfiler::setEnabled(true);
+  start = Timestamp::now();
+  for (int i = 0; i < kLoops; ++i)
+  {
+    MutexLockGuard lock(named);
+  }
+  double enabledNs = timeDifference(Timestamp::now(), start) * 1e9 / kLoops;
+  printf("uncontended lock/unlock: plain %.1fns, profiler off %.1fns, profiler on %.1fns\n",
+         plainNs, disabledNs, enabledNs);
+
+  // some contention on the other lock
+  int64_t sum = 0;
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < 4; ++i)
+  {
+    threads.emplace_back(new Thread([&other, &sum]
+    {
+      for (int n = 0; n < 100000; ++n)
+      {
+        MutexLockGuard lock(other);
+        sum += n % 7;
+      }
+    }));
+    threads.back()->start();
+  }
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+  printf("%s", LockProfiler::report().c_str());
+  LockProfiler::setEnabled(false);
+}
+
+void testAdaptiveCondition()
+{
+  AdaptiveMutexLock mutex;
+  AdaptiveCondition cond(mutex);
+  int turn = 0;
+  const int kRounds = 100000;
+  // ping-pong between two threads
+  Thread thread([&]
+  {
+    for (int i = 0; i < kRounds; ++i)
+    {
+      AdaptiveMutexLockGuard lock(mutex);
+      while (turn != 1)
+      {
+        cond.wait();
+      }
+      turn = 0;
+      cond.notify();
+    }
+  });
+  thread.start();
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kRounds; ++i)
+  {
+    AdaptiveMutexLockGuard lock(mutex);
+    while (turn != 0)
+    {
+      cond.wait();
+    }
+    turn = 1;
+    cond.notify();
+  }
+  thread.join();
+  printf("adaptive condition ping-pong %f\n", timeDifference(Timestamp::now(), start));
+
+  AdaptiveMutexLockGuard lock(mutex);
+  if (!cond.waitForSeconds(0.01))
+  {
+    printf("FAIL: waitForSeconds should time out\n");
+    abort();
+  }
+}
+
 int foo() __attribute__ ((noinline));
 
 int g_count = 0;
@@ -44,6 +156,8 @@ int main()
   printf("sizeof Mutex: %zd\n", sizeof(MutexLock));
   printf("sizeof pthread_cond_t: %zd\n", sizeof(pthread_cond_t));
   printf("sizeof Condition: %zd\n", sizeof(Condition));
+  printf("sizeof AdaptiveMutexLock: %zd\n", sizeof(AdaptiveMutexLock));
+  printf("sizeof AdaptiveCondition: %zd\n", sizeof(AdaptiveCondition));
   MCHECK(foo());
   if (g_count != 1)
   {
@@ -86,5 +200,30 @@ int main()
     //输出时间，发现加锁效率低，时间高
     printf("%d thread(s) with lock %f\n", nthreads, timeDifference(Timestamp::now(), start));
   }
+
+  for (int nthreads = 1; nthreads < kMaxThreads; ++nthreads)
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    g_vec.clear();
+    g_adaptiveMutex.resetStats();
+    start = Timestamp::now();
+    for (int i = 0; i < nthreads; ++i)
+    {
+      threads.emplace_back(new Thread(&adaptiveThreadFunc));
+      threads.back()->start();
+    }
+    for (int i = 0; i < nthreads; ++i)
+    {
+      threads[i]->join();
+    }
+    AdaptiveMutexLock::Stats stats = g_adaptiveMutex.stats();
+    printf("%d thread(s) with adaptive lock %f, contended %" PRId64 " slept %" PRId64
+           " wait %" PRId64 "us\n",
+           nthreads, timeDifference(Timestamp::now(), start),
+           stats.contendedCount, stats.sleepCount, stats.totalWaitNs / 1000);
+  }
+
+  testAdaptiveCondition();
+  testLockProfiler();
 }
 
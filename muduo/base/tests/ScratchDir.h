@@ -0,0 +1,66 @@
+// A new directory made the current directory of a test, for LogFile and
+// others writing to the current directory. Tests remove what they create,
+// the directory must be empty at the end.
+
+#ifndef MUDUO_BASE_TESTS_SCRATCHDIR_H
+#define MUDUO_BASE_TESTS_SCRATCHDIR_H
+
+#include "muduo/base/Types.h"
+#include "muduo/base/noncopyable.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+class ScratchDir : muduo::noncopyable
+{
+ public:
+  /// prefix.XXXXXX, relative to the current directory unless it starts with /
+  explicit ScratchDir(const char* prefix)
+    : path_(muduo::string(prefix) + ".XXXXXX")
+  {
+    char cwd[4096];
+    check(::getcwd(cwd, sizeof cwd) != NULL, "getcwd");
+    cwd_ = cwd;
+    check(::mkdtemp(&path_[0]) != NULL, "mkdtemp");
+    check(::chdir(path_.c_str()) == 0, "chdir");
+  }
+
+  ~ScratchDir()
+  {
+    DIR* dir = ::opendir(".");
+    check(dir != NULL, "opendir");
+    int left = 0;
+    while (struct dirent* entry = ::readdir(dir))
+    {
+      if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+      {
+        fprintf(stderr, "%s/%s is left behind\n", path_.c_str(), entry->d_name);
+        ++left;
+      }
+    }
+    ::closedir(dir);
+    check(::chdir(cwd_.c_str()) == 0, "chdir");
+    check(left == 0 && ::rmdir(path_.c_str()) == 0, "rmdir");
+  }
+
+  const muduo::string& path() const { return path_; }
+
+ private:
+  // not assert(), which NDEBUG turns off
+  static void check(bool ok, const char* what)
+  {
+    if (!ok)
+    {
+      perror(what);
+      abort();
+    }
+  }
+
+  muduo::string path_;
+  muduo::string cwd_;
+};
+
+#endif  // MUDUO_BASE_TESTS_SCRATCHDIR_H
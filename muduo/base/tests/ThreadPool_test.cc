@@ -3,9 +3,15 @@
 #include "muduo/base/CurrentThread.h"
 #include "muduo/base/Logging.h"
 
+#include <vector>
+
+#include <inttypes.h>
 #include <stdio.h>
 #include <unistd.h>  // usleep
 
+#undef NDEBUG
+#include <assert.h>
+
 void print()
 {
   printf("tid=%d\n", muduo::CurrentThread::tid());
@@ -89,6 +95,85 @@ void test2()
   LOG_WARN << "test2 Done";
 }
 
+void expired(muduo::ThreadPool::Priority priority, const muduo::ThreadPool::Task&)
+{
+  LOG_INFO << "expired task, priority " << priority;
+}
+
+std::vector<std::string> g_order;  // appended by the only thread of the pool
+
+void record(const std::string& str)
+{
+  g_order.push_back(str);
+  LOG_INFO << str;
+}
+
+void block(muduo::CountDownLatch* started)
+{
+  started->countDown();
+  longTask(-1);
+}
+
+void test3()
+{
+  LOG_WARN << "Test ThreadPool with priorities and deadlines.";
+  muduo::ThreadPool pool("PriorityPool");
+  pool.setExpiredTaskCallback(expired);
+  pool.setPriorityWeight(muduo::ThreadPool::kHigh, 4);
+  pool.start(1);
+
+  // keep the only thread busy, so that everything below is queued
+  muduo::CountDownLatch started(1);
+  pool.run(std::bind(block, &started));
+  started.wait();
+  for (int i = 0; i < 10; ++i)
+  {
+    pool.run(std::bind(record, "low " + std::to_string(i)),
+             muduo::ThreadPool::kLow);
+  }
+  for (int i = 0; i < 10; ++i)
+  {
+    pool.run(std::bind(record, "high " + std::to_string(i)),
+             muduo::ThreadPool::kHigh);
+  }
+  // expires while longTask runs
+  pool.run(std::bind(record, std::string("never")),
+           muduo::ThreadPool::kHigh,
+           muduo::addTime(muduo::Timestamp::now(), 1.0));
+
+  muduo::CountDownLatch latch(1);
+  pool.run(std::bind(&muduo::CountDownLatch::countDown, &latch),
+           muduo::ThreadPool::kLow);
+  latch.wait();
+
+  // 4 high, then 1 low, from the first round on
+  const char* expected[] = { "high 0", "high 1", "high 2", "high 3", "low 0",
+                             "high 4", "high 5", "high 6", "high 7", "low 1",
+                             "high 8", "high 9", "low 2" };
+  assert(g_order.size() == 20);
+  for (size_t i = 0; i < sizeof expected / sizeof expected[0]; ++i)
+  {
+    assert(g_order[i] == expected[i]);
+  }
+  assert(g_order.back() == "low 9");
+  assert(pool.stats(muduo::ThreadPool::kHigh).expired == 1);
+
+  for (int i = 0; i < muduo::ThreadPool::kNumPriorities; ++i)
+  {
+    muduo::ThreadPool::Stats stats =
+      pool.stats(static_cast<muduo::ThreadPool::Priority>(i));
+    printf("priority %d: depth %zd enqueued %" PRId64 " executed %" PRId64
+           " expired %" PRId64 " "
+           "avg wait %.3fms max wait %.3fms\n",
+           i, stats.queueDepth, stats.enqueued, stats.executed, stats.expired,
+           stats.executed + stats.expired > 0
+             ? static_cast<double>(stats.totalWaitUs) / 1000.0
+               / static_cast<double>(stats.executed + stats.expired) : 0.0,
+           static_cast<double>(stats.maxWaitUs) / 1000.0);
+  }
+  pool.stop();
+}
+
 int main()
 {
   test(0);
@@ -97,4 +182,5 @@ int main()
   test(10);
   test(50);
   test2();
+  test3();
 }
@@ -27,6 +27,7 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
     acceptSocket_(sockets::createNonblockingOrDie(listenAddr.family())),
     acceptChannel_(loop, acceptSocket_.fd()),
     listening_(false),
+    holdingOff_(false),
     idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
   assert(idleFd_ >= 0);
@@ -42,6 +43,10 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
 
 Acceptor::~Acceptor()
 {
+  if (holdingOff_)
+  {
+    loop_->cancel(holdOffTimer_);
+  }
   acceptChannel_.disableAll();
   acceptChannel_.remove();
   ::close(idleFd_);
@@ -62,6 +67,18 @@ void Acceptor::listen()
 void Acceptor::handleRead()
 {
   loop_->assertInLoopThread();
+  if (holdOffCallback_)
+  {
+    double seconds = holdOffCallback_();
+    if (seconds > 0)
+    {
+      //暂时不再关注可读事件，连接留在 backlog 中
+      holdingOff_ = true;
+      acceptChannel_.disableReading();
+      holdOffTimer_ = loop_->runAfter(seconds, std::bind(&Acceptor::resume, this));
+      return;
+    }
+  }
   //准备一个对等方地址
   InetAddress peerAddr;
   //FIXME loop until no more
@@ -99,3 +116,9 @@ void Acceptor::handleRead()
   }
 }
 
+void Acceptor::resume()
+{
+  loop_->assertInLoopThread();
+  holdingOff_ = false;
+  acceptChannel_.enableReading();
+}
@@ -15,6 +15,7 @@
 
 #include "muduo/net/Channel.h"
 #include "muduo/net/Socket.h"
+#include "muduo/net/TimerId.h"
 
 namespace muduo
 {
@@ -31,6 +32,8 @@ class Acceptor : noncopyable
 {
  public:
   typedef std::function<void (int sockfd, const InetAddress&)> NewConnectionCallback;
+  /// Seconds to stop accepting for, 0 to accept now.
+  typedef std::function<double ()> HoldOffCallback;
 
   Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport);
   ~Acceptor();
@@ -38,6 +41,10 @@ class Acceptor : noncopyable
   void setNewConnectionCallback(const NewConnectionCallback& cb)
   { newConnectionCallback_ = cb; }
 
+  /// Asked before each accept, connections wait in the backlog meanwhile.
+  void setHoldOffCallback(const HoldOffCallback& cb)
+  { holdOffCallback_ = cb; }
+
   void listen();
 
   bool listening() const { return listening_; }
@@ -49,12 +56,16 @@ class Acceptor : noncopyable
  private:
   //服务器读处理函数
   void handleRead();
+  void resume();
 
   EventLoop* loop_;           //所属的 EvenLoop
   Socket acceptSocket_;       //listen socket
   Channel acceptChannel_;     //观察 acceptSocket_ 的可读事件
   NewConnectionCallback newConnectionCallback_;   //客户端的回调函数   
+  HoldOffCallback holdOffCallback_;
   bool listening_;
+  bool holdingOff_;           //暂停 accept，等 holdOffTimer_ 到期
+  TimerId holdOffTimer_;
   int idleFd_;
 };
 
@@ -0,0 +1,169 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/AdmissionControl.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TimerId.h"
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+struct AdmissionControl::LagProbe
+{
+  EventLoop* loop;
+  int64_t intervalUs;
+  std::atomic<int64_t> lastFireUs;
+  std::atomic<int64_t> lateUs;     // how late the last firing was
+  TimerId timer;
+
+  // in the probed loop
+  void fire()
+  {
+    int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    int64_t late = now - lastFireUs.load(std::memory_order_relaxed) - intervalUs;
+    lateUs.store(std::max<int64_t>(late, 0), std::memory_order_relaxed);
+    lastFireUs.store(now, std::memory_order_relaxed);
+  }
+
+  // in any thread, grows while the loop is stuck
+  int64_t lag(Timestamp now) const
+  {
+    int64_t sinceDue = now.microSecondsSinceEpoch()
+                       - lastFireUs.load(std::memory_order_relaxed) - intervalUs;
+    return std::max(lateUs.load(std::memory_order_relaxed), sinceDue);
+  }
+};
+
+AdmissionControl::AdmissionControl(EventLoop* loop)
+  : loop_(loop),
+    maxConnections_(0),
+    ratePerSecond_(0.0),
+    burst_(0.0),
+    tokens_(0.0),
+    maxQueueDepth_(0),
+    maxLagUs_(0),
+    overloaded_(false),
+    rejected_(0),
+    deferred_(0)
+{
+}
+
+AdmissionControl::~AdmissionControl()
+{
+  assert(probes_.empty());
+}
+
+void AdmissionControl::setAcceptRate(double perSecond, int burst)
+{
+  ratePerSecond_ = perSecond;
+  burst_ = std::max(burst, 1);
+  tokens_ = burst_;
+}
+
+void AdmissionControl::setOverloadThreshold(size_t queueDepth, double lagSeconds)
+{
+  maxQueueDepth_ = queueDepth;
+  maxLagUs_ = static_cast<int64_t>(lagSeconds * Timestamp::kMicroSecondsPerSecond);
+}
+
+void AdmissionControl::start(const std::vector<EventLoop*>& ioLoops)
+{
+  loop_->assertInLoopThread();
+  lastRefill_ = Timestamp::now();
+  if (maxQueueDepth_ == 0 && maxLagUs_ == 0)
+    return;
+
+  // often enough to notice the lag threshold being crossed
+  double interval = static_cast<double>(maxLagUs_) / 2 / Timestamp::kMicroSecondsPerSecond;
+  interval = std::min(std::max(interval, 0.005), 0.1);
+  for (EventLoop* ioLoop : ioLoops)
+  {
+    std::shared_ptr<LagProbe> probe(new LagProbe);
+    probe->loop = ioLoop;
+    probe->intervalUs = static_cast<int64_t>(interval * Timestamp::kMicroSecondsPerSecond);
+    probe->lastFireUs = lastRefill_.microSecondsSinceEpoch();
+    probe->lateUs = 0;
+    if (maxLagUs_ > 0)
+    {
+      probe->timer = ioLoop->runEvery(interval, std::bind(&LagProbe::fire, probe));
+    }
+    probes_.push_back(probe);
+  }
+}
+
+void AdmissionControl::stop()
+{
+  loop_->assertInLoopThread();
+  for (const auto& probe : probes_)
+  {
+    if (maxLagUs_ > 0)
+      probe->loop->cancel(probe->timer);
+  }
+  probes_.clear();
+}
+
+double AdmissionControl::holdOff()
+{
+  loop_->assertInLoopThread();
+  Timestamp now(Timestamp::now());
+  if (overloaded(now))
+  {
+    deferred_.fetch_add(1, std::memory_order_relaxed);
+    // check again a little later, the backlog holds the connection
+    return 0.01;
+  }
+
+  if (ratePerSecond_ > 0)
+  {
+    tokens_ = std::min(burst_, tokens_ + timeDifference(now, lastRefill_) * ratePerSecond_);
+    lastRefill_ = now;
+    if (tokens_ < 1.0)
+    {
+      deferred_.fetch_add(1, std::memory_order_relaxed);
+      return (1.0 - tokens_) / ratePerSecond_;
+    }
+    tokens_ -= 1.0;
+  }
+  return 0.0;
+}
+
+bool AdmissionControl::admit(size_t numConnections)
+{
+  if (maxConnections_ > 0 && numConnections >= static_cast<size_t>(maxConnections_))
+  {
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    LOG_DEBUG << "AdmissionControl::admit - " << numConnections
+              << " connections, rejected";
+    return false;
+  }
+  return true;
+}
+
+bool AdmissionControl::overloaded(Timestamp now)
+{
+  bool overloaded = false;
+  for (const auto& probe : probes_)
+  {
+    if ((maxQueueDepth_ > 0 && probe->loop->queueSize() >= maxQueueDepth_)
+        || (maxLagUs_ > 0 && probe->lag(now) >= maxLagUs_))
+    {
+      overloaded = true;
+      break;
+    }
+  }
+  if (overloaded != overloaded_)
+  {
+    overloaded_ = overloaded;
+    if (overloaded)
+      LOG_WARN << "AdmissionControl - IO loops overloaded, stop accepting";
+    else
+      LOG_WARN << "AdmissionControl - IO loops recovered, accepting again";
+  }
+  return overloaded;
+}
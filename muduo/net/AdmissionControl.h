@@ -0,0 +1,81 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_ADMISSIONCONTROL_H
+#define MUDUO_NET_ADMISSIONCONTROL_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Timestamp.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+
+///
+/// Decides whether TcpServer takes a new connection now, later or never.
+///
+/// - Over the connection limit, a connection is accepted and closed
+///   at once (rejected).
+/// - Out of accept-rate tokens, or while an IO loop is overloaded,
+///   accepting stops for a while and connections wait in the listen
+///   backlog (deferred).
+///
+/// An IO loop is overloaded when its pending functors pile up, or when a
+/// probe timer in it runs late, which also catches a loop that is stuck.
+class AdmissionControl : noncopyable
+{
+ public:
+  explicit AdmissionControl(EventLoop* loop);
+  ~AdmissionControl();
+
+  // Before start().
+  void setMaxConnections(int maxConnections) { maxConnections_ = maxConnections; }
+  void setAcceptRate(double perSecond, int burst);
+  void setOverloadThreshold(size_t queueDepth, double lagSeconds);
+
+  // The following must be called in loop thread.
+  void start(const std::vector<EventLoop*>& ioLoops);
+  void stop();
+  /// Seconds to stop accepting for, 0 to accept a connection now.
+  double holdOff();
+  /// Whether one more connection may join numConnections existing ones.
+  bool admit(size_t numConnections);
+
+  /// Thread safe.
+  int64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+  int64_t deferred() const { return deferred_.load(std::memory_order_relaxed); }
+
+ private:
+  struct LagProbe;
+
+  bool overloaded(Timestamp now);
+
+  EventLoop* loop_;
+  int maxConnections_;
+  double ratePerSecond_;
+  double burst_;
+  double tokens_;               //令牌桶
+  Timestamp lastRefill_;
+  size_t maxQueueDepth_;
+  int64_t maxLagUs_;
+  bool overloaded_;
+  std::vector<std::shared_ptr<LagProbe>> probes_;   // one per IO loop
+  std::atomic<int64_t> rejected_;
+  std::atomic<int64_t> deferred_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_ADMISSIONCONTROL_H
@@ -0,0 +1,68 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/ConnectionPool.h"
+
+#include <new>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t ConnectionPool::kDefaultMaxFree;
+
+ConnectionPool::ConnectionPool(size_t maxFree)
+  : mutex_("ConnectionPool::free_"),
+    maxFree_(maxFree),
+    blockSize_(0)
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+  for (void* p : free_)
+  {
+    ::operator delete(p);
+  }
+}
+
+void* ConnectionPool::allocate(size_t size)
+{
+  {
+    MutexLockGuard lock(mutex_);
+    if (blockSize_ == 0)
+    {
+      blockSize_ = size;
+    }
+    assert(size == blockSize_);
+    if (!free_.empty())
+    {
+      void* p = free_.back();
+      free_.pop_back();
+      return p;
+    }
+  }
+  return ::operator new(size);
+}
+
+void ConnectionPool::deallocate(void* p, size_t size)
+{
+  {
+    MutexLockGuard lock(mutex_);
+    assert(size == blockSize_);
+    (void)size;
+    if (free_.size() < maxFree_)
+    {
+      free_.push_back(p);
+      return;
+    }
+  }
+  ::operator delete(p);
+}
+
+size_t ConnectionPool::numFree() const
+{
+  MutexLockGuard lock(mutex_);
+  return free_.size();
+}
@@ -0,0 +1,91 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_CONNECTIONPOOL_H
+#define MUDUO_NET_CONNECTIONPOOL_H
+
+#include "muduo/base/Mutex.h"
+#include "muduo/base/noncopyable.h"
+
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Recycles the memory of connections of one loop.
+///
+/// Hands out blocks of one size, that of the first request, for
+/// std::allocate_shared, which puts the TcpConnection and its reference
+/// counts in one block. Up to maxFree freed blocks are kept for reuse
+/// until the pool and all the connections allocated from it are gone,
+/// the rest go back to the heap after a burst of connections. Blocks are
+/// usually taken in the acceptor thread and given back in an IO thread,
+/// hence the lock.
+class ConnectionPool : noncopyable
+{
+ public:
+  static const size_t kDefaultMaxFree = 256;
+
+  explicit ConnectionPool(size_t maxFree = kDefaultMaxFree);
+  ~ConnectionPool();
+
+  void* allocate(size_t size);
+  void deallocate(void* p, size_t size);
+
+  size_t numFree() const;
+
+ private:
+  mutable MutexLock mutex_;
+  const size_t maxFree_;
+  size_t blockSize_ GUARDED_BY(mutex_);
+  std::vector<void*> free_ GUARDED_BY(mutex_);
+};
+
+/// Allocator for std::allocate_shared, every copy keeps the pool alive.
+template<typename T>
+class ConnectionAllocator
+{
+ public:
+  typedef T value_type;
+
+  explicit ConnectionAllocator(const std::shared_ptr<ConnectionPool>& pool)
+    : pool_(pool)
+  { }
+
+  template<typename U>
+  ConnectionAllocator(const ConnectionAllocator<U>& rhs)
+    : pool_(rhs.pool())
+  { }
+
+  T* allocate(size_t n)
+  { return static_cast<T*>(pool_->allocate(n * sizeof(T))); }
+
+  void deallocate(T* p, size_t n)
+  { pool_->deallocate(p, n * sizeof(T)); }
+
+  const std::shared_ptr<ConnectionPool>& pool() const { return pool_; }
+
+ private:
+  std::shared_ptr<ConnectionPool> pool_;
+};
+
+template<typename T, typename U>
+bool operator==(const ConnectionAllocator<T>& lhs, const ConnectionAllocator<U>& rhs)
+{ return lhs.pool() == rhs.pool(); }
+
+template<typename T, typename U>
+bool operator!=(const ConnectionAllocator<T>& lhs, const ConnectionAllocator<U>& rhs)
+{ return lhs.pool() != rhs.pool(); }
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CONNECTIONPOOL_H
@@ -0,0 +1,161 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/ConnectionReaper.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpConnection.h"
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+ConnectionReaper::ConnectionReaper(EventLoop* loop, double idle, double read, double write)
+  : loop_(loop)
+{
+  static_assert(kNumTimeouts == TcpConnection::kNumReaperLists,
+                "one hook per timeout kind");
+  const double seconds[kNumTimeouts] = { idle, read, write };
+  for (int k = 0; k < kNumTimeouts; ++k)
+  {
+    timeoutUs_[k] = static_cast<int64_t>(seconds[k] * Timestamp::kMicroSecondsPerSecond);
+    head_[k] = NULL;
+    tail_[k] = NULL;
+    reaped_[k] = 0;
+  }
+}
+
+ConnectionReaper::~ConnectionReaper()
+{
+  for (int k = 0; k < kNumTimeouts; ++k)
+  {
+    assert(head_[k] == NULL);
+  }
+}
+
+void ConnectionReaper::start()
+{
+  int64_t shortest = 0;
+  for (int k = 0; k < kNumTimeouts; ++k)
+  {
+    if (enabled(k) && (shortest == 0 || timeoutUs_[k] < shortest))
+      shortest = timeoutUs_[k];
+  }
+  assert(shortest > 0);
+  // a connection lives at most 1/8 longer than its timeout
+  double tick = std::min(std::max(static_cast<double>(shortest) / 8 / 1e6, 0.01), 1.0);
+  timer_ = loop_->runEvery(tick, std::bind(&ConnectionReaper::sweep, shared_from_this()));
+}
+
+void ConnectionReaper::stop()
+{
+  loop_->assertInLoopThread();
+  loop_->cancel(timer_);
+}
+
+void ConnectionReaper::add(TcpConnection* conn, Timestamp now)
+{
+  loop_->assertInLoopThread();
+  assert(conn->reaper_ == NULL);
+  conn->reaper_ = this;
+  if (enabled(kIdle))
+    pushBack(conn, kIdle, now);
+  if (enabled(kRead))
+    pushBack(conn, kRead, now);
+}
+
+void ConnectionReaper::remove(TcpConnection* conn)
+{
+  assert(conn->reaper_ == this);
+  for (int k = 0; k < kNumTimeouts; ++k)
+  {
+    unlink(conn, k);
+  }
+  conn->reaper_ = NULL;
+}
+
+void ConnectionReaper::touchRead(TcpConnection* conn, Timestamp now)
+{
+  if (enabled(kIdle))
+    pushBack(conn, kIdle, now);
+  if (enabled(kRead))
+    pushBack(conn, kRead, now);
+}
+
+void ConnectionReaper::touchWrite(TcpConnection* conn, Timestamp now, bool pending)
+{
+  if (enabled(kIdle))
+    pushBack(conn, kIdle, now);
+  if (pending && enabled(kWrite))
+    pushBack(conn, kWrite, now);
+  else
+    unlink(conn, kWrite);
+}
+
+void ConnectionReaper::writePending(TcpConnection* conn, Timestamp now)
+{
+  if (enabled(kWrite) && !conn->reaperHooks_[kWrite].linked)
+    pushBack(conn, kWrite, now);
+}
+
+void ConnectionReaper::pushBack(TcpConnection* conn, int kind, Timestamp now)
+{
+  TcpConnection::ReaperHook& hook = conn->reaperHooks_[kind];
+  hook.touched = now;
+  if (hook.linked && tail_[kind] == conn)
+    return;
+  unlink(conn, kind);
+  hook.prev = tail_[kind];
+  hook.next = NULL;
+  if (tail_[kind])
+    tail_[kind]->reaperHooks_[kind].next = conn;
+  else
+    head_[kind] = conn;
+  tail_[kind] = conn;
+  hook.linked = true;
+}
+
+void ConnectionReaper::unlink(TcpConnection* conn, int kind)
+{
+  TcpConnection::ReaperHook& hook = conn->reaperHooks_[kind];
+  if (!hook.linked)
+    return;
+  if (hook.prev)
+    hook.prev->reaperHooks_[kind].next = hook.next;
+  else
+    head_[kind] = hook.next;
+  if (hook.next)
+    hook.next->reaperHooks_[kind].prev = hook.prev;
+  else
+    tail_[kind] = hook.prev;
+  hook.prev = NULL;
+  hook.next = NULL;
+  hook.linked = false;
+}
+
+void ConnectionReaper::sweep()
+{
+  loop_->assertInLoopThread();
+  static const char* const kNames[kNumTimeouts] = { "idle", "read", "write" };
+  Timestamp now(Timestamp::now());
+  for (int k = 0; k < kNumTimeouts; ++k)
+  {
+    if (!enabled(k))
+      continue;
+    int64_t deadline = now.microSecondsSinceEpoch() - timeoutUs_[k];
+    TcpConnection* conn;
+    while ((conn = head_[k]) != NULL
+           && conn->reaperHooks_[k].touched.microSecondsSinceEpoch() <= deadline)
+    {
+      LOG_INFO << "ConnectionReaper - " << conn->name() << " " << kNames[k]
+               << " timeout, closing";
+      ++reaped_[k];
+      remove(conn);
+      conn->forceClose();
+    }
+  }
+}
@@ -0,0 +1,74 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_CONNECTIONREAPER_H
+#define MUDUO_NET_CONNECTIONREAPER_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/TimerId.h"
+
+#include <memory>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+class TcpConnection;
+
+///
+/// Closes connections of one loop that stay quiet for too long.
+///
+/// Every connection of the loop sits in up to three lists, ordered by
+/// the last time it was touched: any traffic (idle), received data (read),
+/// progress of a pending write (write). Touching moves a connection to the
+/// tail through pointers embedded in TcpConnection, so it costs no
+/// allocation; a periodic sweep closes expired connections from the heads.
+class ConnectionReaper : noncopyable,
+                         public std::enable_shared_from_this<ConnectionReaper>
+{
+ public:
+  enum Timeout { kIdle, kRead, kWrite, kNumTimeouts };
+
+  /// A timeout of 0 disables that kind.
+  ConnectionReaper(EventLoop* loop, double idle, double read, double write);
+  ~ConnectionReaper();
+
+  void start();  // can be called in any thread
+  void stop();   // must be called in loop thread
+
+  // The following must be called in loop thread.
+  void add(TcpConnection* conn, Timestamp now);
+  void remove(TcpConnection* conn);
+  void touchRead(TcpConnection* conn, Timestamp now);
+  // data was written, pending tells whether some is left in output buffer
+  void touchWrite(TcpConnection* conn, Timestamp now, bool pending);
+  // output buffer went from empty to non-empty
+  void writePending(TcpConnection* conn, Timestamp now);
+
+  int64_t reaped(Timeout kind) const { return reaped_[kind]; }
+
+ private:
+  bool enabled(int kind) const { return timeoutUs_[kind] > 0; }
+  void pushBack(TcpConnection* conn, int kind, Timestamp now);
+  void unlink(TcpConnection* conn, int kind);
+  void sweep();
+
+  EventLoop* loop_;
+  int64_t timeoutUs_[kNumTimeouts];
+  TcpConnection* head_[kNumTimeouts];   //最久没有动静的连接
+  TcpConnection* tail_[kNumTimeouts];
+  int64_t reaped_[kNumTimeouts];
+  TimerId timer_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CONNECTIONREAPER_H
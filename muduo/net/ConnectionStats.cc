@@ -0,0 +1,78 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/ConnectionStats.h"
+
+#include <algorithm>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const char* const kNames[ConnectionStats::kNumCounters] =
+{
+  "bytes_received",
+  "bytes_sent",
+  "messages",
+  "read_calls",
+  "write_calls",
+  "high_water_mark_us",
+  "max_output_backlog",
+  "connections",
+  "above_high_water_mark",
+};
+
+}  // namespace
+
+ConnectionStats::ConnectionStats()
+{
+  for (std::atomic<int64_t>& counter : counters_)
+  {
+    counter.store(0, std::memory_order_relaxed);
+  }
+}
+
+ConnectionStats::Snapshot ConnectionStats::snapshot() const
+{
+  Snapshot result;
+  for (int i = 0; i < kNumCounters; ++i)
+  {
+    result[i] = get(static_cast<Counter>(i));
+  }
+  return result;
+}
+
+void ConnectionStats::merge(Snapshot* into, const Snapshot& from)
+{
+  for (int i = 0; i < kNumCounters; ++i)
+  {
+    if (i == kMaxOutputBacklog)
+      (*into)[i] = std::max((*into)[i], from[i]);
+    else
+      (*into)[i] += from[i];
+  }
+}
+
+const char* ConnectionStats::name(Counter c)
+{
+  return kNames[c];
+}
+
+string ConnectionStats::toString(const Snapshot& snapshot)
+{
+  string result;
+  char buf[64];
+  for (int i = 0; i < kNumCounters; ++i)
+  {
+    snprintf(buf, sizeof buf, "%s%s %lld", i == 0 ? "" : " ",
+             kNames[i], static_cast<long long>(snapshot[i]));
+    result += buf;
+  }
+  return result;
+}
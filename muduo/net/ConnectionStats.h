@@ -0,0 +1,77 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_CONNECTIONSTATS_H
+#define MUDUO_NET_CONNECTIONSTATS_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Types.h"
+
+#include <array>
+#include <atomic>
+#include <stdint.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Traffic counters of a TcpConnection, or the sum of many.
+///
+/// Written by the loop thread of the connections only, so updating is a
+/// relaxed load and store. Readable from any thread without locking.
+class ConnectionStats : noncopyable
+{
+ public:
+  enum Counter
+  {
+    kBytesReceived,
+    kBytesSent,
+    kMessages,            // message callbacks
+    kReadCalls,           // reads of the socket
+    kWriteCalls,          // writes to the socket
+    kHighWaterMarkUs,     // time output buffer stayed above the high water mark,
+                          // periods that ended
+    kMaxOutputBacklog,    // largest output buffer, a maximum rather than a sum
+    kConnections,         // established and not yet destroyed
+    kAboveHighWaterMark,  // connections whose output buffer is above it now
+    kNumCounters,
+  };
+  typedef std::array<int64_t, kNumCounters> Snapshot;
+
+  ConnectionStats();
+
+  int64_t get(Counter c) const
+  { return counters_[c].load(std::memory_order_relaxed); }
+
+  // Loop thread only.
+  void add(Counter c, int64_t delta)
+  { counters_[c].store(get(c) + delta, std::memory_order_relaxed); }
+
+  void raise(Counter c, int64_t value)
+  {
+    if (value > get(c))
+      counters_[c].store(value, std::memory_order_relaxed);
+  }
+
+  Snapshot snapshot() const;
+
+  /// Sums counters, except maximums.
+  static void merge(Snapshot* into, const Snapshot& from);
+  static const char* name(Counter c);
+  /// "bytes_received 10 bytes_sent 20 ..."
+  static string toString(const Snapshot& snapshot);
+
+ private:
+  std::atomic<int64_t> counters_[kNumCounters];
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CONNECTIONSTATS_H
@@ -14,27 +14,129 @@
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/SocketsOps.h"
 
+#include <atomic>
+
 #include <errno.h>
+#include <stdlib.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+// Process-wide reconnect budget, a token bucket in GCRA form:
+// the theoretical arrival time of the next connect is the only state,
+// so it fits in one atomic word.
+std::atomic<int64_t> g_reconnectIntervalUs(0);  // 0 means unlimited
+std::atomic<int64_t> g_reconnectToleranceUs(0);
+std::atomic<int64_t> g_nextReconnectUs(0);
+std::atomic<int64_t> g_reconnectsDeferred(0);
+
+// Returns 0 if a reconnect may go now, otherwise how long to wait.
+int64_t takeReconnectToken()
+{
+  int64_t interval = g_reconnectIntervalUs.load(std::memory_order_relaxed);
+  if (interval == 0)
+    return 0;
+  int64_t tolerance = g_reconnectToleranceUs.load(std::memory_order_relaxed);
+  int64_t now = Timestamp::now().microSecondsSinceEpoch();
+  int64_t tat = g_nextReconnectUs.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    int64_t newTat = std::max(tat, now) + interval;
+    if (newTat - now > tolerance)
+    {
+      return newTat - now - tolerance;
+    }
+    if (g_nextReconnectUs.compare_exchange_weak(tat, newTat, std::memory_order_relaxed))
+      return 0;
+  }
+}
+
+// RFC 8305 section 4: alternate address families,
+// starting with the family of the first address.
+std::vector<InetAddress> interleaveFamilies(const std::vector<InetAddress>& addrs)
+{
+  std::vector<InetAddress> first, second;
+  for (const InetAddress& addr : addrs)
+  {
+    (addr.family() == addrs.front().family() ? first : second).push_back(addr);
+  }
+  std::vector<InetAddress> result;
+  for (size_t i = 0; i < std::max(first.size(), second.size()); ++i)
+  {
+    if (i < first.size())
+      result.push_back(first[i]);
+    if (i < second.size())
+      result.push_back(second[i]);
+  }
+  return result;
+}
+
+typedef std::vector<std::unique_ptr<Channel>> ChannelList;
+
+// Keeps a removed channel alive till the end of Channel::handleEvent.
+void deleteChannel(const std::shared_ptr<Channel>&)
+{
+}
+
+void closeChannels(const std::shared_ptr<ChannelList>& channels)
+{
+  for (const auto& channel : *channels)
+  {
+    channel->disableAll();
+    channel->remove();
+    sockets::close(channel->fd());
+  }
+}
+
+}  // namespace
+
 const int Connector::kMaxRetryDelayMs;
+const int Connector::kInitRetryDelayMs;
+const int Connector::kDefaultConnectTimeoutMs;
+const int Connector::kDefaultAttemptDelayMs;
+
+void Connector::setReconnectBudget(double connectsPerSecond, int burst)
+{
+  int64_t interval = connectsPerSecond > 0
+      ? static_cast<int64_t>(1000000 / connectsPerSecond) : 0;
+  g_reconnectToleranceUs.store(interval * std::max(burst, 1), std::memory_order_relaxed);
+  g_reconnectIntervalUs.store(interval, std::memory_order_relaxed);
+}
+
+int64_t Connector::reconnectsDeferred()
+{
+  return g_reconnectsDeferred.load(std::memory_order_relaxed);
+}
 
 Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
+  : Connector(loop, std::vector<InetAddress>(1, serverAddr))
+{
+}
+
+Connector::Connector(EventLoop* loop, const std::vector<InetAddress>& serverAddrs)
   : loop_(loop),
-    serverAddr_(serverAddr),
+    serverAddrs_(interleaveFamilies(serverAddrs)),
     connect_(false),
     state_(kDisconnected),
-    retryDelayMs_(kInitRetryDelayMs)
+    nextAddr_(0),
+    retryable_(false),
+    retryDelayMs_(kInitRetryDelayMs),
+    connectTimeoutMs_(kDefaultConnectTimeoutMs),
+    attemptDelayMs_(kDefaultAttemptDelayMs),
+    seed_(static_cast<unsigned int>(reinterpret_cast<uintptr_t>(this)
+                                    ^ Timestamp::now().microSecondsSinceEpoch()))
 {
+  assert(!serverAddrs_.empty());
   LOG_DEBUG << "ctor[" << this << "]";
 }
 
 Connector::~Connector()
 {
   LOG_DEBUG << "dtor[" << this << "]";
-  assert(!channel_);
+  assert(channels_.empty());
 }
 
 void Connector::start()
@@ -61,25 +163,63 @@ void Connector::stop()
 {
   connect_ = false;
   loop_->queueInLoop(std::bind(&Connector::stopInLoop, this)); // FIXME: unsafe
-  // FIXME: cancel timer
 }
 
 void Connector::stopInLoop()
 {
   loop_->assertInLoopThread();
+  loop_->cancel(retryTimer_);
   if (state_ == kConnecting)
   {
     setState(kDisconnected);
-    int sockfd = removeAndResetChannel();   //将通道从 poller 中移除关注，并将 channel 置空
-    retry(sockfd);        //这里并非要重连，只是调用 sockets::close(sockfd)
+    cancelTimers();
+    abortAttempts();      //关闭所有正在进行的连接尝试
   }
 }
 
+//开始一轮连接，依次尝试每个地址
 void Connector::connect()
+{
+  setState(kConnecting);
+  nextAddr_ = 0;
+  retryable_ = false;
+  //非阻塞 connect 可能一直停在 kConnecting，超时后放弃重连
+  if (connectTimeoutMs_ > 0)
+  {
+    timeoutTimer_ = loop_->runAfter(connectTimeoutMs_/1000.0,
+                                    std::bind(&Connector::handleConnectTimeout, shared_from_this()));
+  }
+  connectNext();
+}
+
+void Connector::connectNext()
+{
+  if (state_ != kConnecting)
+    return;
+  while (nextAddr_ < serverAddrs_.size())
+  {
+    if (startAttempt(serverAddrs_[nextAddr_++]))
+    {
+      if (nextAddr_ < serverAddrs_.size())
+      {
+        // give this one a head start, then race the next address against it
+        attemptTimer_ = loop_->runAfter(attemptDelayMs_/1000.0,
+                                        std::bind(&Connector::connectNext, shared_from_this()));
+      }
+      return;
+    }
+  }
+  if (channels_.empty())
+  {
+    roundFailed();
+  }
+}
+
+bool Connector::startAttempt(const InetAddress& serverAddr)
 {
   //创建非阻塞套接字
-  int sockfd = sockets::createNonblockingOrDie(serverAddr_.family());
-  int ret = sockets::connect(sockfd, serverAddr_.getSockAddr());
+  int sockfd = sockets::createNonblockingOrDie(serverAddr.family());
+  int ret = sockets::connect(sockfd, serverAddr.getSockAddr());
   int savedErrno = (ret == 0) ? 0 : errno;
   switch (savedErrno)
   {
@@ -88,15 +228,16 @@ void Connector::connect()
     case EINTR:
     case EISCONN:           //连接成功
       connecting(sockfd);
-      break;
+      return true;
 
     case EAGAIN:
     case EADDRINUSE:
     case EADDRNOTAVAIL:
     case ECONNREFUSED:
     case ENETUNREACH:
-      retry(sockfd);      //重连
-      break;
+      retryable_ = true;      //稍后重连
+      sockets::close(sockfd);
+      return false;
 
     case EACCES:
     case EPERM:
@@ -107,13 +248,13 @@ void Connector::connect()
     case ENOTSOCK:
       LOG_SYSERR << "connect error in Connector::startInLoop " << savedErrno;
       sockets::close(sockfd);
-      break;
+      return false;
 
     default:
       LOG_SYSERR << "Unexpected error in Connector::startInLoop " << savedErrno;
       sockets::close(sockfd);
       // connectErrorCallback_();
-      break;
+      return false;
   }
 }
 
@@ -124,115 +265,216 @@ void Connector::restart()
   setState(kDisconnected);
   retryDelayMs_ = kInitRetryDelayMs;
   connect_ = true;
+  // a lost connection is a reconnect too, it is what storms after a backend restarts
+  reconnect();
+}
+
+//重连前先向全局预算申请，超出预算则推迟
+void Connector::reconnect()
+{
+  loop_->assertInLoopThread();
+  int64_t waitUs = takeReconnectToken();
+  if (waitUs > 0)
+  {
+    g_reconnectsDeferred.fetch_add(1, std::memory_order_relaxed);
+    // spread the postponed ones too, or they come back in step
+    int jitterMs = rand_r(&seed_) % kInitRetryDelayMs;
+    LOG_DEBUG << "Connector::reconnect - over budget, postponed "
+              << waitUs / 1000 + jitterMs << " milliseconds";
+    retryTimer_ = loop_->runAfter(static_cast<double>(waitUs) / 1e6 + jitterMs / 1000.0,
+                                  std::bind(&Connector::reconnect, shared_from_this()));
+    return;
+  }
   startInLoop();
 }
 
 
 void Connector::connecting(int sockfd)
 {
-  setState(kConnecting);
-  assert(!channel_);
-  channel_.reset(new Channel(loop_, sockfd));
+  assert(state_ == kConnecting);
+  Channel* channel = new Channel(loop_, sockfd);
+  channels_.emplace_back(channel);
   //设置可写回调函数，sockfd 处于可写状态
-  channel_->setWriteCallback(
-      std::bind(&Connector::handleWrite, this)); // FIXME: unsafe
-  channel_->setErrorCallback(
-      std::bind(&Connector::handleError, this)); // FIXME: unsafe
+  // An attempt is known by its channel, not by sockfd: a failed attempt
+  // closes sockfd and the next one may reuse the number while the old
+  // channel is still handling the same event.
+  channel->setWriteCallback(
+      std::bind(&Connector::handleWrite, this, channel)); // FIXME: unsafe
+  channel->setErrorCallback(
+      std::bind(&Connector::handleError, this, channel)); // FIXME: unsafe
 
   // channel_->tie(shared_from_this()); is not working,
   // as channel_ is not managed by shared_ptr
   //关注可写事件
-  channel_->enableWriting();
+  channel->enableWriting();
 }
 
-int Connector::removeAndResetChannel()
+// A removed channel lives till the end of its Channel::handleEvent,
+// so no new attempt gets its address meanwhile.
+bool Connector::hasAttempt(const Channel* channel) const
 {
-  channel_->disableAll();
-  channel_->remove();
-  int sockfd = channel_->fd();
-  // Can't reset channel_ here, because we are inside Channel::handleEvent
-  // 不能在这里重置 channel_，因为现在正在调用 channel::handleEvent
-  loop_->queueInLoop(std::bind(&Connector::resetChannel, this)); // FIXME: unsafe
-  return sockfd;
+  for (const auto& attempt : channels_)
+  {
+    if (attempt.get() == channel)
+      return true;
+  }
+  return false;
+}
+
+// Takes the channel out of poller, it must be the active one,
+// or the loop is not handling events.
+std::unique_ptr<Channel> Connector::removeChannel(Channel* channel)
+{
+  std::unique_ptr<Channel> removed;
+  for (auto it = channels_.begin(); it != channels_.end(); ++it)
+  {
+    if (it->get() == channel)
+    {
+      removed = std::move(*it);
+      channels_.erase(it);
+      removed->disableAll();
+      removed->remove();
+      break;
+    }
+  }
+  return removed;
 }
 
-//将 channel 置空
-void Connector::resetChannel()
+// Other attempts may have events pending in this very iteration,
+// EventLoop does not allow removing them now, so do it afterwards.
+// Their handlers find no channel and do nothing meanwhile.
+void Connector::abortAttempts()
 {
-  channel_.reset();
+  std::shared_ptr<ChannelList> doomed(new ChannelList);
+  doomed->swap(channels_);
+  loop_->queueInLoop(std::bind(&closeChannels, doomed));
 }
 
+void Connector::cancelTimers()
+{
+  loop_->cancel(timeoutTimer_);
+  loop_->cancel(attemptTimer_);
+}
 
 //可写事件处理
-void Connector::handleWrite()
+void Connector::handleWrite(Channel* channel)
 {
   LOG_TRACE << "Connector::handleWrite " << state_;
 
-  if (state_ == kConnecting)
+  if (state_ != kConnecting || !hasAttempt(channel))
+  {
+    // lost the race, being aborted, or failed in handleError just now
+    return;
+  }
+
+  int sockfd = channel->fd();
+  // socket 可写并不意味着连接一定建立成功
+  // 还需要用 getsockopt(sockfd, SOL_SOCKET, SO_ERROR,...) 再次确定一下
+  int err = sockets::getSocketError(sockfd);
+  if (err)
+  {
+    LOG_WARN << "Connector::handleWrite - SO_ERROR = "
+             << err << " " << strerror_tl(err);
+    attemptFailed(channel);
+  }
+  else if (sockets::isSelfConnect(sockfd))    //自连接
+  {
+    LOG_WARN << "Connector::handleWrite - Self connect";
+    attemptFailed(channel);
+  }
+  else    //连接成功
   {
     //从 Poller 中移除关注，并将 channel 置空
     //这里是为了防止 busyLoop
-    int sockfd = removeAndResetChannel();
-    // socket 可写并不意味着连接一定建立成功
-    // 还需要用 getsockopt(sockfd, SOL_SOCKET, SO_ERROR,...) 再次确定一下
-    int err = sockets::getSocketError(sockfd);
-    if (err)
-    {
-      LOG_WARN << "Connector::handleWrite - SO_ERROR = "
-               << err << " " << strerror_tl(err);
-      retry(sockfd);      //重连
-    }
-    else if (sockets::isSelfConnect(sockfd))    //自连接
+    // Can't reset channel here, because we are inside Channel::handleEvent
+    // 不能在这里重置 channel，因为现在正在调用 channel::handleEvent
+    std::shared_ptr<Channel> removed(removeChannel(channel));
+    loop_->queueInLoop(std::bind(&deleteChannel, removed));
+    setState(kConnected);
+    cancelTimers();
+    abortAttempts();    //其余的连接尝试都放弃
+    if (connect_)
     {
-      LOG_WARN << "Connector::handleWrite - Self connect";
-      retry(sockfd);
+      newConnectionCallback_(sockfd);
     }
-    else    //连接成功
+    else
     {
-      setState(kConnected);
-      if (connect_)
-      {
-        newConnectionCallback_(sockfd);
-      }
-      else
-      {
-        sockets::close(sockfd);
-      }
+      sockets::close(sockfd);
     }
   }
-  else
+}
+
+void Connector::handleError(Channel* channel)
+{
+  LOG_ERROR << "Connector::handleError state=" << state_;
+  if (state_ == kConnecting && hasAttempt(channel))
   {
-    // what happened?
-    assert(state_ == kDisconnected);
+    int err = sockets::getSocketError(channel->fd());
+    LOG_TRACE << "SO_ERROR = " << err << " " << strerror_tl(err);
+    attemptFailed(channel);
   }
 }
 
-void Connector::handleError()
+void Connector::attemptFailed(Channel* channel)
+{
+  std::shared_ptr<Channel> removed(removeChannel(channel));
+  loop_->queueInLoop(std::bind(&deleteChannel, removed));
+  sockets::close(removed->fd());
+  retryable_ = true;
+
+  if (nextAddr_ < serverAddrs_.size())
+  {
+    // don't wait for the head start to run out
+    loop_->cancel(attemptTimer_);
+    connectNext();
+  }
+  else if (channels_.empty())
+  {
+    roundFailed();
+  }
+}
+
+void Connector::handleConnectTimeout()
 {
-  LOG_ERROR << "Connector::handleError state=" << state_;
   if (state_ == kConnecting)
   {
-    int sockfd = removeAndResetChannel();
-    int err = sockets::getSocketError(sockfd);
-    LOG_TRACE << "SO_ERROR = " << err << " " << strerror_tl(err);
-    retry(sockfd);
+    LOG_WARN << "Connector::handleConnectTimeout - connecting to "
+             << serverAddress().toIpPort() << " timed out after "
+             << connectTimeoutMs_ << " milliseconds";
+    abortAttempts();
+    retry();
   }
 }
 
-//采用 back-off 策略重连，即重连事件逐渐延长，0.5s,1s,1.5s...直到 30s
-void Connector::retry(int sockfd)
+//每个地址都失败了
+void Connector::roundFailed()
+{
+  if (retryable_)
+  {
+    retry();
+  }
+  else
+  {
+    LOG_ERROR << "Connector::roundFailed - giving up " << serverAddress().toIpPort();
+    setState(kDisconnected);
+    cancelTimers();
+  }
+}
+
+//采用 back-off 策略重连，即重连事件逐渐延长，直到 30s
+void Connector::retry()
 {
-  sockets::close(sockfd);
   setState(kDisconnected);
+  cancelTimers();
   if (connect_)
   {
-    LOG_INFO << "Connector::retry - Retry connecting to " << serverAddr_.toIpPort()
-             << " in " << retryDelayMs_ << " milliseconds. ";
-    
+    int delayMs = nextRetryDelayMs();
+    LOG_INFO << "Connector::retry - Retry connecting to " << serverAddress().toIpPort()
+             << " in " << delayMs << " milliseconds. ";
+
     //注册一个定时器，重连
-    loop_->runAfter(retryDelayMs_/1000.0,
-                    std::bind(&Connector::startInLoop, shared_from_this()));
-    retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
+    retryTimer_ = loop_->runAfter(delayMs/1000.0,
+                                  std::bind(&Connector::reconnect, shared_from_this()));
   }
   else
   {
@@ -240,3 +482,13 @@ void Connector::retry(int sockfd)
   }
 }
 
+// "Decorrelated jitter": each delay is drawn from [initial, 3 * previous],
+// capped. Clients that failed together drift apart after a few rounds,
+// instead of retrying in synchronized waves as plain doubling does.
+int Connector::nextRetryDelayMs()
+{
+  int upper = std::min(retryDelayMs_ * 3, kMaxRetryDelayMs);
+  int range = upper - kInitRetryDelayMs + 1;
+  retryDelayMs_ = kInitRetryDelayMs + (range > 1 ? rand_r(&seed_) % range : 0);
+  return retryDelayMs_;
+}
@@ -13,9 +13,13 @@
 
 #include "muduo/base/noncopyable.h"
 #include "muduo/net/InetAddress.h"
+#include "muduo/net/TimerId.h"
 
 #include <functional>
 #include <memory>
+#include <vector>
+
+#include <stdint.h>
 
 namespace muduo
 {
@@ -34,40 +38,82 @@ class Connector : noncopyable,
   typedef std::function<void (int sockfd)> NewConnectionCallback;
 
   Connector(EventLoop* loop, const InetAddress& serverAddr);
+  // Happy Eyeballs (RFC 8305): tries the addresses one by one, alternating
+  // IPv6 and IPv4, starting the next attempt when the previous one fails or
+  // has not succeeded within the attempt delay. The first to connect wins,
+  // the others are closed.
+  Connector(EventLoop* loop, const std::vector<InetAddress>& serverAddrs);
   ~Connector();
 
   void setNewConnectionCallback(const NewConnectionCallback& cb)
   { newConnectionCallback_ = cb; }
 
+  // Gives up a connect attempt that is still pending after this long,
+  // and retries. 0 means wait for the kernel. Call before start().
+  void setConnectTimeout(double seconds)
+  { connectTimeoutMs_ = static_cast<int>(seconds * 1000); }
+
+  // Head start of each address over the next one, default 250ms.
+  // Call before start().
+  void setConnectionAttemptDelay(double seconds)
+  { attemptDelayMs_ = static_cast<int>(seconds * 1000); }
+
   void start();  // can be called in any thread
   void restart();  // must be called in loop thread
   void stop();  // can be called in any thread
 
-  const InetAddress& serverAddress() const { return serverAddr_; }
+  const InetAddress& serverAddress() const { return serverAddrs_.front(); }
+  const std::vector<InetAddress>& serverAddresses() const { return serverAddrs_; }
+
+  // Limits reconnects of all Connectors in this process to connectsPerSecond,
+  // with bursts of up to burst. Retries over budget are postponed, not lost.
+  // 0 (default) means unlimited. Thread safe.
+  static void setReconnectBudget(double connectsPerSecond, int burst);
+  // Number of reconnects postponed for lack of budget.
+  static int64_t reconnectsDeferred();
 
  private:
   enum States { kDisconnected, kConnecting, kConnected };
   static const int kMaxRetryDelayMs = 30*1000;        //30s，最大重连时间
   static const int kInitRetryDelayMs = 500;           //0.5s，初始状态，连接不上，0.5s 后重连
+  static const int kDefaultConnectTimeoutMs = 30*1000;
+  static const int kDefaultAttemptDelayMs = 250;      //RFC 8305 推荐的值
 
   void setState(States s) { state_ = s; }
   void startInLoop();
   void stopInLoop();
   void connect();
+  void connectNext();
+  bool startAttempt(const InetAddress& serverAddr);
   void connecting(int sockfd);
-  void handleWrite();
-  void handleError();
-  void retry(int sockfd);
-  int removeAndResetChannel();
-  void resetChannel();
+  void handleWrite(Channel* channel);
+  void handleError(Channel* channel);
+  void handleConnectTimeout();
+  void attemptFailed(Channel* channel);
+  void roundFailed();
+  void retry();
+  void reconnect();
+  int nextRetryDelayMs();
+  bool hasAttempt(const Channel* channel) const;
+  std::unique_ptr<Channel> removeChannel(Channel* channel);
+  void abortAttempts();
+  void cancelTimers();
 
   EventLoop* loop_;             //所属的 EvenLoop
-  InetAddress serverAddr_;      //服务器端地址
+  const std::vector<InetAddress> serverAddrs_;  //服务器端地址，IPv6/IPv4 交替排列
   bool connect_; // atomic
   States state_;  // FIXME: use atomic variable
-  std::unique_ptr<Channel> channel_;    //connector 对应的 Channel
+  std::vector<std::unique_ptr<Channel>> channels_;  //正在进行的连接尝试，每个对应一个 Channel
+  size_t nextAddr_;           //本轮下一个要尝试的地址
+  bool retryable_;            //本轮有可以重试的失败
   NewConnectionCallback newConnectionCallback_;   //连接成功回调函数
   int retryDelayMs_;          //重连延迟时间
+  int connectTimeoutMs_;      //连接超时时间
+  int attemptDelayMs_;        //相邻两次连接尝试的间隔
+  unsigned int seed_;         //重连延迟抖动的随机数种子
+  TimerId retryTimer_;
+  TimerId timeoutTimer_;
+  TimerId attemptTimer_;
 };
 
 }  // namespace net
@@ -43,6 +43,11 @@ int createEventfd()
   return evtfd;
 }
 
+int64_t elapsedUs(Timestamp high, Timestamp low)
+{
+  return high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+}
+
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 class IgnoreSigPipe
 {
@@ -70,6 +75,7 @@ EventLoop::EventLoop()
     callingPendingFunctors_(false),
     iteration_(0),
     threadId_(CurrentThread::tid()),
+    slowCallbackUs_(0),
     //指向默认的派生类对象，需要为派生类传入 EvenPoll 对象
     poller_(Poller::newDefaultPoller(this)),
     timerQueue_(new TimerQueue(this)),
@@ -113,31 +119,32 @@ void EventLoop::loop()
   quit_ = false;  // FIXME: what if someone calls quit() before loop() ?
   LOG_TRACE << "EventLoop " << this << " start looping";
 
+  Timestamp iterationEnd(Timestamp::now());
   while (!quit_)
   {
     activeChannels_.clear();
     pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
     ++iteration_;
-    if (Logger::logLevel() <= Logger::TRACE)
+    stats_.pollUs.add(elapsedUs(pollReturnTime_, iterationEnd));
+    stats_.activeChannels.add(static_cast<int64_t>(activeChannels_.size()));
+    if (MUDUO_LOG_ENABLED(Logger::TRACE))
     {
       printActiveChannels();
     }
     // TODO sort channel by priority
     //处理事件
     eventHandling_ = true;
-
-    //遍历所以事件，调用 handleEvent 的处理函数
-    for (Channel* channel : activeChannels_)
-    {
-      currentActiveChannel_ = channel;
-      currentActiveChannel_->handleEvent(pollReturnTime_);
-    }
+    handleActiveChannels();
     //事件处理结束，当前没有活跃事件
     currentActiveChannel_ = NULL;
     eventHandling_ = false;
+    Timestamp handled(Timestamp::now());
+    stats_.handlingUs.add(elapsedUs(handled, pollReturnTime_));
     //让 IO 线程也能执行一些计算任务
     //这时候引用计数为 1
     doPendingFunctors();
+    iterationEnd = Timestamp::now();
+    stats_.functorsUs.add(elapsedUs(iterationEnd, handled));
   }
 
   LOG_TRACE << "EventLoop " << this << " stop looping";
@@ -176,7 +183,7 @@ void EventLoop::runInLoop(Functor cb)
 void EventLoop::queueInLoop(Functor cb)
 {
   {
-  MutexLockGuard lock(mutex_);
+  AdaptiveMutexLockGuard lock(mutex_);
   pendingFunctors_.push_back(std::move(cb));
   }
 
@@ -191,7 +198,7 @@ void EventLoop::queueInLoop(Functor cb)
 
 size_t EventLoop::queueSize() const
 {
-  MutexLockGuard lock(mutex_);
+  AdaptiveMutexLockGuard lock(mutex_);
   return pendingFunctors_.size();
 }
 
@@ -287,18 +294,57 @@ void EventLoop::doPendingFunctors()
     也避免了死锁，functor 中也有可能调用 queueLoop()
   */
   {
-  MutexLockGuard lock(mutex_);
+  AdaptiveMutexLockGuard lock(mutex_);
   functors.swap(pendingFunctors_);
   }
   //此时 pendingFunctors_ 的任务都放到 functors 中
 
+  stats_.queueDepth.add(static_cast<int64_t>(functors.size()));
+
+  const int64_t slowUs = slowCallbackUs_.load(std::memory_order_relaxed);
   for (const Functor& functor : functors)
   {
+    if (slowUs <= 0)
+    {
+      functor();
+      continue;
+    }
+    Timestamp start(Timestamp::now());
     functor();
+    int64_t elapsed = elapsedUs(Timestamp::now(), start);
+    if (elapsed >= slowUs)
+    {
+      stats_.slowCallbacks.fetch_add(1, std::memory_order_relaxed);
+      LOG_WARN << "EventLoop::doPendingFunctors - slow functor took " << elapsed << " us";
+    }
   }
   callingPendingFunctors_ = false;
 }
 
+void EventLoop::handleActiveChannels()
+{
+  const int64_t slowUs = slowCallbackUs_.load(std::memory_order_relaxed);
+  //遍历所以事件，调用 handleEvent 的处理函数
+  for (Channel* channel : activeChannels_)
+  {
+    currentActiveChannel_ = channel;
+    if (slowUs <= 0)
+    {
+      currentActiveChannel_->handleEvent(pollReturnTime_);
+      continue;
+    }
+    Timestamp start(Timestamp::now());
+    currentActiveChannel_->handleEvent(pollReturnTime_);
+    int64_t elapsed = elapsedUs(Timestamp::now(), start);
+    if (elapsed >= slowUs)
+    {
+      stats_.slowCallbacks.fetch_add(1, std::memory_order_relaxed);
+      LOG_WARN << "EventLoop::loop - slow callback of channel {"
+               << channel->reventsToString() << "} took " << elapsed << " us";
+    }
+  }
+}
+
 void EventLoop::printActiveChannels() const
 {
   for (const Channel* channel : activeChannels_)
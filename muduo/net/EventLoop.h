@@ -17,10 +17,11 @@
 
 #include <boost/any.hpp>
 
-#include "muduo/base/Mutex.h"
+#include "muduo/base/AdaptiveMutex.h"
 #include "muduo/base/CurrentThread.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/net/Callbacks.h"
+#include "muduo/net/EventLoopStats.h"
 #include "muduo/net/TimerId.h"
 
 namespace muduo
@@ -66,6 +67,16 @@ class EventLoop : noncopyable
 
   int64_t iteration() const { return iteration_; }
 
+  /// Histograms of each iteration, readable from any thread.
+  const EventLoopStats& stats() const { return stats_; }
+  void resetStats() { stats_.reset(); }
+
+  /// Logs every channel handler or pending functor that runs longer,
+  /// 0 (default) turns it off. Timing each one costs a clock read.
+  /// Thread safe.
+  void setSlowCallbackThreshold(double seconds)
+  { slowCallbackUs_ = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond); }
+
   /// Runs callback immediately in the loop thread.
   /// It wakes up the loop, and run the cb.
   /// If in the same loop thread, cb is run within the function.
@@ -77,6 +88,8 @@ class EventLoop : noncopyable
   void queueInLoop(Functor cb);
 
   size_t queueSize() const;
+  AdaptiveMutexLock::Stats lockStats() const
+  { return mutex_.stats(); }
 
   // timers
 
@@ -138,6 +151,7 @@ class EventLoop : noncopyable
   void abortNotInLoopThread();
   void handleRead();  // waked up
   void doPendingFunctors();
+  void handleActiveChannels();
 
   void printActiveChannels() const; // DEBUG
 
@@ -150,6 +164,8 @@ class EventLoop : noncopyable
   int64_t iteration_;
   const pid_t threadId_;            //线程 ID，记录当前对象属于哪个线程
   Timestamp pollReturnTime_;        //调用 poll 函数返回的时间
+  EventLoopStats stats_;
+  std::atomic<int64_t> slowCallbackUs_;   //超过这个时间的回调会被记录，0 表示不检测
   std::unique_ptr<Poller> poller_;  //虚基类指针，指向派生类对象
   std::unique_ptr<TimerQueue> timerQueue_;
 
@@ -166,7 +182,7 @@ class EventLoop : noncopyable
   ChannelList activeChannels_;      //Poller 返回的活动通道
   Channel* currentActiveChannel_;   //当前正在处理的活动通道
 
-  mutable MutexLock mutex_;
+  mutable AdaptiveMutexLock mutex_;   //只保护 pendingFunctors_，临界区很短
   std::vector<Functor> pendingFunctors_ GUARDED_BY(mutex_);
 };
 
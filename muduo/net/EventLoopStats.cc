@@ -0,0 +1,78 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/EventLoopStats.h"
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int64_t LoopHistogram::quantile(double q) const
+{
+  int64_t total = count();
+  if (total == 0)
+    return 0;
+  int64_t rank = static_cast<int64_t>(q * static_cast<double>(total) + 0.5);
+  if (rank < 1)
+    rank = 1;
+  int64_t seen = 0;
+  for (int i = 0; i < kBuckets; ++i)
+  {
+    seen += bucketCount(i);
+    if (seen >= rank)
+      return upperBound(i);
+  }
+  return upperBound(kBuckets - 1);
+}
+
+void LoopHistogram::reset()
+{
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  for (std::atomic<int64_t>& b : buckets_)
+  {
+    b.store(0, std::memory_order_relaxed);
+  }
+}
+
+string LoopHistogram::toString() const
+{
+  int64_t n = count();
+  char buf[256];
+  snprintf(buf, sizeof buf, "count %lld mean %.1f p50 %lld p90 %lld p99 %lld max %lld",
+           static_cast<long long>(n),
+           n > 0 ? static_cast<double>(sum()) / static_cast<double>(n) : 0.0,
+           static_cast<long long>(quantile(0.5)),
+           static_cast<long long>(quantile(0.9)),
+           static_cast<long long>(quantile(0.99)),
+           static_cast<long long>(quantile(1.0)));
+  return buf;
+}
+
+void EventLoopStats::reset()
+{
+  pollUs.reset();
+  handlingUs.reset();
+  functorsUs.reset();
+  activeChannels.reset();
+  queueDepth.reset();
+  slowCallbacks.store(0, std::memory_order_relaxed);
+}
+
+string EventLoopStats::toString() const
+{
+  string result;
+  result += "poll_us         " + pollUs.toString() + "\n";
+  result += "handling_us     " + handlingUs.toString() + "\n";
+  result += "functors_us     " + functorsUs.toString() + "\n";
+  result += "active_channels " + activeChannels.toString() + "\n";
+  result += "queue_depth     " + queueDepth.toString() + "\n";
+  char buf[64];
+  snprintf(buf, sizeof buf, "slow_callbacks  %lld\n",
+           static_cast<long long>(slowCallbacks.load(std::memory_order_relaxed)));
+  result += buf;
+  return result;
+}
@@ -0,0 +1,96 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_EVENTLOOPSTATS_H
+#define MUDUO_NET_EVENTLOOPSTATS_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Types.h"
+
+#include <atomic>
+#include <stdint.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Counts of values in log2 buckets, bucket 0 holds 0 and
+/// bucket i holds [2^(i-1), 2^i).
+///
+/// Written by one thread, readable from any thread.
+class LoopHistogram : noncopyable
+{
+ public:
+  static const int kBuckets = 32;
+
+  LoopHistogram() { reset(); }
+
+  // Relaxed load and store rather than fetch_add, as there is one writer.
+  void add(int64_t value)
+  {
+    bump(&buckets_[bucket(value)], 1);
+    bump(&count_, 1);
+    bump(&sum_, value);
+  }
+
+  int64_t count() const { return count_.load(std::memory_order_relaxed); }
+  int64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+  int64_t bucketCount(int i) const { return buckets_[i].load(std::memory_order_relaxed); }
+  /// Upper bound of the bucket holding this quantile, 0 < q <= 1.
+  int64_t quantile(double q) const;
+
+  /// Approximate if racing with add().
+  void reset();
+  /// "count 10 mean 2.5 p50 4 p90 8 p99 16 max 16"
+  string toString() const;
+
+  static int bucket(int64_t value)
+  {
+    int b = value <= 0 ? 0 : 64 - __builtin_clzll(static_cast<uint64_t>(value));
+    return b < kBuckets ? b : kBuckets - 1;
+  }
+
+  static int64_t upperBound(int bucket)
+  { return bucket == 0 ? 0 : (static_cast<int64_t>(1) << bucket) - 1; }
+
+ private:
+  static void bump(std::atomic<int64_t>* counter, int64_t delta)
+  {
+    counter->store(counter->load(std::memory_order_relaxed) + delta,
+                   std::memory_order_relaxed);
+  }
+
+  std::atomic<int64_t> count_;
+  std::atomic<int64_t> sum_;
+  std::atomic<int64_t> buckets_[kBuckets];
+};
+
+///
+/// What an EventLoop spends its iterations on.
+///
+struct EventLoopStats : noncopyable
+{
+  EventLoopStats() : slowCallbacks(0) { }
+
+  LoopHistogram pollUs;           // blocked in poll
+  LoopHistogram handlingUs;       // handling active channels
+  LoopHistogram functorsUs;       // running pending functors
+  LoopHistogram activeChannels;   // per iteration
+  LoopHistogram queueDepth;       // pending functors per iteration
+  std::atomic<int64_t> slowCallbacks;
+
+  void reset();
+  /// One line per histogram.
+  string toString() const;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_EVENTLOOPSTATS_H
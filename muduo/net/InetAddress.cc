@@ -140,6 +140,39 @@ bool InetAddress::resolve(StringArg hostname, InetAddress* out)
   }
 }
 
+std::vector<InetAddress> InetAddress::resolveAll(StringArg hostname, uint16_t port)
+{
+  std::vector<InetAddress> result;
+  struct addrinfo hints;
+  memZero(&hints, sizeof hints);
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;  // one entry per address, not per protocol
+  struct addrinfo* res = NULL;
+  int ret = getaddrinfo(hostname.c_str(), NULL, &hints, &res);
+  if (ret != 0)
+  {
+    LOG_ERROR << "InetAddress::resolveAll " << hostname.c_str() << ": " << gai_strerror(ret);
+    return result;
+  }
+  for (struct addrinfo* ai = res; ai != NULL; ai = ai->ai_next)
+  {
+    if (ai->ai_family == AF_INET)
+    {
+      struct sockaddr_in addr = *sockets::sockaddr_in_cast(ai->ai_addr);
+      addr.sin_port = sockets::hostToNetwork16(port);
+      result.push_back(InetAddress(addr));
+    }
+    else if (ai->ai_family == AF_INET6)
+    {
+      struct sockaddr_in6 addr = *sockets::sockaddr_in6_cast(ai->ai_addr);
+      addr.sin6_port = sockets::hostToNetwork16(port);
+      result.push_back(InetAddress(addr));
+    }
+  }
+  freeaddrinfo(res);
+  return result;
+}
+
 void InetAddress::setScopeId(uint32_t scope_id)
 {
   if (family() == AF_INET6)
@@ -14,6 +14,8 @@
 #include "muduo/base/copyable.h"
 #include "muduo/base/StringPiece.h"
 
+#include <vector>
+
 #include <netinet/in.h>
 
 namespace muduo
@@ -69,7 +71,10 @@ class InetAddress : public muduo::copyable
   // return true on success.
   // thread safe
   static bool resolve(StringArg hostname, InetAddress* result);
-  // static std::vector<InetAddress> resolveAll(const char* hostname, uint16_t port = 0);
+  // resolve hostname to all its IPv4 and IPv6 addresses, with given port.
+  // returns empty vector on failure.
+  // blocking, thread safe. Use Resolver in an IO loop.
+  static std::vector<InetAddress> resolveAll(StringArg hostname, uint16_t port = 0);
 
   // set IPv6 ScopeID
   void setScopeId(uint32_t scope_id);
@@ -0,0 +1,609 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/Resolver.h"
+
+#include "muduo/base/FileUtil.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/Endian.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <algorithm>
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const uint16_t kTypeA = 1;
+const uint16_t kTypeAAAA = 28;
+const uint16_t kClassIN = 1;
+const int kHeaderSize = 12;
+const int kRcodeNxDomain = 3;
+const uint32_t kMaxTtl = 24 * 3600;
+const uint32_t kNegativeTtl = 30;
+const size_t kMaxCacheSize = 10000;
+const int kMaxMessageSize = 4096;  // we don't ask for more than 512 anyway
+
+void append16(string* out, uint16_t x)
+{
+  out->push_back(static_cast<char>(x >> 8));
+  out->push_back(static_cast<char>(x & 0xFF));
+}
+
+uint16_t read16(const unsigned char* p)
+{
+  return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t read32(const unsigned char* p)
+{
+  return (static_cast<uint32_t>(read16(p)) << 16) | read16(p + 2);
+}
+
+// The question section: name in labels, type, class.
+bool encodeQuestion(const string& name, uint16_t qtype, string* out)
+{
+  size_t start = 0;
+  while (start < name.size())
+  {
+    size_t dot = name.find('.', start);
+    if (dot == string::npos)
+      dot = name.size();
+    size_t len = dot - start;
+    if (len == 0 || len > 63)
+      return false;
+    out->push_back(static_cast<char>(len));
+    out->append(name, start, len);
+    start = dot + 1;
+  }
+  if (out->size() > 254)
+    return false;
+  out->push_back('\0');
+  append16(out, qtype);
+  append16(out, kClassIN);
+  return true;
+}
+
+string encodeHeader(uint16_t id)
+{
+  string header;
+  append16(&header, id);
+  append16(&header, 0x0100);  // standard query, recursion desired
+  append16(&header, 1);       // QDCOUNT
+  append16(&header, 0);
+  append16(&header, 0);
+  append16(&header, 0);
+  return header;
+}
+
+bool skipName(const unsigned char* msg, size_t len, size_t* offset)
+{
+  size_t off = *offset;
+  while (off < len)
+  {
+    unsigned char c = msg[off];
+    if (c == 0)
+    {
+      *offset = off + 1;
+      return true;
+    }
+    else if ((c & 0xC0) == 0xC0)
+    {
+      // a compression pointer ends the name
+      *offset = off + 2;
+      return *offset <= len;
+    }
+    else if (c & 0xC0)
+    {
+      return false;
+    }
+    off += 1 + c;
+  }
+  return false;
+}
+
+string normalize(StringArg hostname)
+{
+  string name(hostname.c_str());
+  if (!name.empty() && name.back() == '.')
+    name.pop_back();
+  std::transform(name.begin(), name.end(), name.begin(),
+                 [](char c) { return static_cast<char>(tolower(c)); });
+  return name;
+}
+
+bool parseIp(const string& ip, InetAddress* out)
+{
+  struct in_addr addr4;
+  struct in6_addr addr6;
+  if (::inet_pton(AF_INET, ip.c_str(), &addr4) == 1)
+  {
+    struct sockaddr_in sa;
+    memZero(&sa, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_addr = addr4;
+    *out = InetAddress(sa);
+    return true;
+  }
+  else if (::inet_pton(AF_INET6, ip.c_str(), &addr6) == 1)
+  {
+    struct sockaddr_in6 sa;
+    memZero(&sa, sizeof sa);
+    sa.sin6_family = AF_INET6;
+    sa.sin6_addr = addr6;
+    *out = InetAddress(sa);
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+struct Resolver::Lookup
+{
+  static const int kMaxQueries = 2;  // A and AAAA
+
+  string name;
+  std::vector<std::pair<uint16_t, Callback>> waiters;  // port, callback
+  int numQueries;
+  uint16_t ids[kMaxQueries];
+  string questions[kMaxQueries];
+  bool answered[kMaxQueries];
+  std::vector<InetAddress> addresses[kMaxQueries];
+  uint32_t ttl;
+  bool failed;       // SERVFAIL and friends, don't cache
+  int attempt;
+  TimerId timer;
+};
+
+Resolver::Resolver(EventLoop* loop)
+  : loop_(CHECK_NOTNULL(loop)),
+    timeoutMs_(5000),
+    attempts_(2),
+    ipv6_(true),
+    seed_(static_cast<unsigned int>(Timestamp::now().microSecondsSinceEpoch() ^ ::getpid()))
+{
+  std::vector<InetAddress> nameservers;
+  loadResolvConf("/etc/resolv.conf", &nameservers);
+  init(nameservers, "/etc/hosts");
+}
+
+Resolver::Resolver(EventLoop* loop,
+                   const std::vector<InetAddress>& nameservers,
+                   const string& hostsFile)
+  : loop_(CHECK_NOTNULL(loop)),
+    timeoutMs_(5000),
+    attempts_(2),
+    ipv6_(true),
+    seed_(static_cast<unsigned int>(Timestamp::now().microSecondsSinceEpoch() ^ ::getpid()))
+{
+  init(nameservers, hostsFile);
+}
+
+Resolver::~Resolver()
+{
+  for (const auto& item : lookups_)
+  {
+    loop_->cancel(item.second->timer);
+  }
+  for (size_t i = 0; i < channels_.size(); ++i)
+  {
+    channels_[i]->disableAll();
+    channels_[i]->remove();
+    sockets::close(sockets_[i]);
+  }
+}
+
+void Resolver::init(const std::vector<InetAddress>& nameservers, const string& hostsFile)
+{
+  nameservers_ = nameservers;
+  if (nameservers_.empty())
+  {
+    nameservers_.push_back(InetAddress("127.0.0.1", 53));
+  }
+  loadHosts(hostsFile);
+
+  for (size_t i = 0; i < nameservers_.size(); ++i)
+  {
+    int sockfd = ::socket(nameservers_[i].family(),
+                          SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (sockfd < 0)
+    {
+      LOG_SYSFATAL << "Resolver::init socket";
+    }
+    // connected, so the kernel drops datagrams from anybody else
+    if (sockets::connect(sockfd, nameservers_[i].getSockAddr()) < 0)
+    {
+      LOG_SYSERR << "Resolver::init connect " << nameservers_[i].toIpPort();
+    }
+    sockets_.push_back(sockfd);
+    channels_.emplace_back(new Channel(loop_, sockfd));
+    channels_.back()->setReadCallback(std::bind(&Resolver::handleRead, this, i));
+    channels_.back()->enableReading();
+  }
+}
+
+void Resolver::loadResolvConf(const string& path, std::vector<InetAddress>* nameservers)
+{
+  string content;
+  int err = FileUtil::readFile(path, 64*1024, &content);
+  if (err)
+  {
+    LOG_WARN << "Resolver can't read " << path << ": " << strerror_tl(err);
+    return;
+  }
+
+  size_t start = 0;
+  while (start < content.size())
+  {
+    size_t end = content.find('\n', start);
+    if (end == string::npos)
+      end = content.size();
+    string line(content, start, end - start);
+    start = end + 1;
+
+    char keyword[32];
+    char value[128];
+    if (sscanf(line.c_str(), "%31s %127s", keyword, value) != 2)
+      continue;
+    if (strcmp(keyword, "nameserver") == 0)
+    {
+      char* percent = strchr(value, '%');  // fe80::1%eth0
+      if (percent)
+        *percent = '\0';
+      InetAddress addr;
+      if (parseIp(value, &addr))
+      {
+        nameservers->push_back(InetAddress(addr.toIp(), 53, addr.family() == AF_INET6));
+      }
+    }
+    else if (strcmp(keyword, "options") == 0)
+    {
+      const char* timeout = strstr(line.c_str(), "timeout:");
+      if (timeout)
+        timeoutMs_ = std::max(1, atoi(timeout + 8)) * 1000;
+      const char* attempts = strstr(line.c_str(), "attempts:");
+      if (attempts)
+        attempts_ = std::max(1, atoi(attempts + 9));
+    }
+  }
+}
+
+void Resolver::loadHosts(const string& path)
+{
+  string content;
+  int err = FileUtil::readFile(path, 1024*1024, &content);
+  if (err)
+  {
+    LOG_DEBUG << "Resolver can't read " << path << ": " << strerror_tl(err);
+    return;
+  }
+
+  size_t start = 0;
+  while (start < content.size())
+  {
+    size_t end = content.find('\n', start);
+    if (end == string::npos)
+      end = content.size();
+    string line(content, start, end - start);
+    start = end + 1;
+
+    size_t hash = line.find('#');
+    if (hash != string::npos)
+      line.resize(hash);
+    std::vector<string> fields;
+    size_t pos = 0;
+    while ((pos = line.find_first_not_of(" \t\r", pos)) != string::npos)
+    {
+      size_t stop = line.find_first_of(" \t\r", pos);
+      fields.push_back(line.substr(pos, stop == string::npos ? string::npos : stop - pos));
+      pos = stop;
+    }
+
+    InetAddress addr;
+    if (fields.size() < 2 || !parseIp(fields[0], &addr))
+      continue;
+    for (size_t i = 1; i < fields.size(); ++i)
+    {
+      hosts_[normalize(fields[i])].push_back(addr);
+    }
+  }
+}
+
+void Resolver::resolve(StringArg hostname, uint16_t port, const Callback& cb)
+{
+  loop_->runInLoop(
+      std::bind(&Resolver::resolveInLoop, this, string(hostname.c_str()), port, cb));
+}
+
+void Resolver::resolveInLoop(const string& hostname, uint16_t port, const Callback& cb)
+{
+  loop_->assertInLoopThread();
+  string name = normalize(hostname);
+
+  std::vector<InetAddress> addresses;
+  if (resolveLocally(name, &addresses))
+  {
+    loop_->queueInLoop(std::bind(&Resolver::deliver, addresses, port, cb));
+    return;
+  }
+
+  auto cached = cache_.find(name);
+  if (cached != cache_.end())
+  {
+    if (Timestamp::now() < cached->second.expiration)
+    {
+      loop_->queueInLoop(std::bind(&Resolver::deliver, cached->second.addresses, port, cb));
+      return;
+    }
+    cache_.erase(cached);
+  }
+
+  auto pending = lookups_.find(name);
+  if (pending != lookups_.end())
+  {
+    // somebody is already asking
+    pending->second->waiters.push_back(std::make_pair(port, cb));
+    return;
+  }
+
+  LookupPtr lookup(new Lookup);
+  lookup->name = name;
+  lookup->waiters.push_back(std::make_pair(port, cb));
+  lookup->numQueries = ipv6_ ? 2 : 1;
+  lookup->ttl = kMaxTtl;
+  lookup->failed = false;
+  lookup->attempt = 0;
+  const uint16_t types[Lookup::kMaxQueries] = { kTypeA, kTypeAAAA };
+  for (int i = 0; i < lookup->numQueries; ++i)
+  {
+    if (!encodeQuestion(name, types[i], &lookup->questions[i]))
+    {
+      LOG_ERROR << "Resolver::resolve - invalid name " << hostname;
+      loop_->queueInLoop(std::bind(&Resolver::deliver, std::vector<InetAddress>(), port, cb));
+      return;
+    }
+  }
+  for (int i = 0; i < lookup->numQueries; ++i)
+  {
+    lookup->answered[i] = false;
+    lookup->ids[i] = newQueryId();
+    queries_[lookup->ids[i]] = get_pointer(lookup);
+  }
+
+  Lookup* l = get_pointer(lookup);
+  lookups_[name] = std::move(lookup);
+  sendQueries(l);
+}
+
+bool Resolver::resolveLocally(const string& name, std::vector<InetAddress>* addresses) const
+{
+  InetAddress addr;
+  if (parseIp(name, &addr))
+  {
+    addresses->push_back(addr);
+    return true;
+  }
+  auto it = hosts_.find(name);
+  if (it != hosts_.end())
+  {
+    *addresses = it->second;
+    return true;
+  }
+  return false;
+}
+
+uint16_t Resolver::newQueryId()
+{
+  uint16_t id;
+  do
+  {
+    id = static_cast<uint16_t>(rand_r(&seed_));
+  } while (queries_.find(id) != queries_.end());
+  return id;
+}
+
+void Resolver::sendQueries(Lookup* lookup)
+{
+  size_t server = static_cast<size_t>(lookup->attempt) % nameservers_.size();
+  for (int i = 0; i < lookup->numQueries; ++i)
+  {
+    if (lookup->answered[i])
+      continue;
+    string message = encodeHeader(lookup->ids[i]) + lookup->questions[i];
+    ssize_t n = ::send(sockets_[server], message.data(), message.size(), 0);
+    if (n != static_cast<ssize_t>(message.size()))
+    {
+      LOG_SYSERR << "Resolver::sendQueries to " << nameservers_[server].toIpPort();
+    }
+  }
+  lookup->timer = loop_->runAfter(timeoutMs_ / 1000.0,
+                                  std::bind(&Resolver::handleTimeout, this, lookup));
+}
+
+void Resolver::handleRead(size_t server)
+{
+  loop_->assertInLoopThread();
+  unsigned char buf[kMaxMessageSize];
+  for (;;)
+  {
+    ssize_t n = ::recv(sockets_[server], buf, sizeof buf, 0);
+    if (n < 0)
+    {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+      {
+        // ECONNREFUSED from an ICMP error, the lookup will time out and move on
+        LOG_DEBUG << "Resolver::handleRead " << nameservers_[server].toIpPort()
+                  << " " << strerror_tl(errno);
+      }
+      break;
+    }
+    const size_t len = static_cast<size_t>(n);
+    if (len < kHeaderSize)
+      continue;
+
+    uint16_t id = read16(buf);
+    uint16_t flags = read16(buf + 2);
+    auto it = queries_.find(id);
+    if (it == queries_.end() || !(flags & 0x8000))
+      continue;  // stale, or not a response
+    Lookup* lookup = it->second;
+    int q = lookup->ids[0] == id ? 0 : 1;
+    const string& question = lookup->questions[q];
+    if (read16(buf + 4) != 1
+        || len < kHeaderSize + question.size()
+        || memcmp(buf + kHeaderSize, question.data(), question.size()) != 0)
+    {
+      LOG_WARN << "Resolver::handleRead - mismatched answer for " << lookup->name;
+      continue;
+    }
+
+    int rcode = flags & 0x0F;
+    uint16_t ancount = read16(buf + 6);
+    size_t off = kHeaderSize + question.size();
+    if (rcode == 0)
+    {
+      for (uint16_t i = 0; i < ancount; ++i)
+      {
+        if (!skipName(buf, len, &off) || off + 10 > len)
+          break;
+        uint16_t type = read16(buf + off);
+        uint16_t klass = read16(buf + off + 2);
+        uint32_t ttl = read32(buf + off + 4);
+        uint16_t rdlength = read16(buf + off + 8);
+        off += 10;
+        if (off + rdlength > len)
+          break;
+        // CNAMEs come along with the addresses they point to
+        if (klass == kClassIN && type == kTypeA && rdlength == 4)
+        {
+          struct sockaddr_in sa;
+          memZero(&sa, sizeof sa);
+          sa.sin_family = AF_INET;
+          memcpy(&sa.sin_addr, buf + off, 4);
+          lookup->addresses[q].push_back(InetAddress(sa));
+          lookup->ttl = std::min(lookup->ttl, ttl);
+        }
+        else if (klass == kClassIN && type == kTypeAAAA && rdlength == 16)
+        {
+          struct sockaddr_in6 sa;
+          memZero(&sa, sizeof sa);
+          sa.sin6_family = AF_INET6;
+          memcpy(&sa.sin6_addr, buf + off, 16);
+          lookup->addresses[q].push_back(InetAddress(sa));
+          lookup->ttl = std::min(lookup->ttl, ttl);
+        }
+        off += rdlength;
+      }
+    }
+    else if (rcode != kRcodeNxDomain)
+    {
+      LOG_WARN << "Resolver::handleRead - " << lookup->name << " rcode " << rcode
+               << " from " << nameservers_[server].toIpPort();
+      lookup->failed = true;
+    }
+
+    queries_.erase(it);
+    lookup->answered[q] = true;
+    bool done = true;
+    for (int i = 0; i < lookup->numQueries; ++i)
+      done = done && lookup->answered[i];
+    if (done)
+    {
+      finish(lookup, !lookup->failed);
+    }
+  }
+}
+
+void Resolver::handleTimeout(Lookup* lookup)
+{
+  ++lookup->attempt;
+  if (lookup->attempt < attempts_ * static_cast<int>(nameservers_.size()))
+  {
+    LOG_DEBUG << "Resolver::handleTimeout - retrying " << lookup->name;
+    sendQueries(lookup);
+  }
+  else
+  {
+    LOG_WARN << "Resolver::handleTimeout - giving up " << lookup->name;
+    finish(lookup, false);
+  }
+}
+
+void Resolver::finish(Lookup* lookup, bool cache)
+{
+  loop_->cancel(lookup->timer);
+  for (int i = 0; i < lookup->numQueries; ++i)
+  {
+    if (!lookup->answered[i])
+      queries_.erase(lookup->ids[i]);
+  }
+
+  std::vector<InetAddress> addresses(lookup->addresses[0]);
+  addresses.insert(addresses.end(), lookup->addresses[1].begin(), lookup->addresses[1].end());
+  if (cache)
+  {
+    if (cache_.size() >= kMaxCacheSize)
+    {
+      Timestamp now(Timestamp::now());
+      for (auto it = cache_.begin(); it != cache_.end(); )
+      {
+        if (it->second.expiration < now)
+          it = cache_.erase(it);
+        else
+          ++it;
+      }
+      if (cache_.size() >= kMaxCacheSize)
+        cache_.erase(cache_.begin());
+    }
+    uint32_t ttl = addresses.empty() ? kNegativeTtl : lookup->ttl;
+    CacheEntry& entry = cache_[lookup->name];
+    entry.addresses = addresses;
+    entry.expiration = addTime(Timestamp::now(), ttl);
+  }
+
+  std::vector<std::pair<uint16_t, Callback>> waiters;
+  waiters.swap(lookup->waiters);
+  string name(lookup->name);
+  lookups_.erase(name);  // deletes lookup
+  for (const auto& waiter : waiters)
+  {
+    deliver(addresses, waiter.first, waiter.second);
+  }
+}
+
+void Resolver::deliver(const std::vector<InetAddress>& addresses,
+                       uint16_t port, const Callback& cb)
+{
+  std::vector<InetAddress> result;
+  result.reserve(addresses.size());
+  for (const InetAddress& addr : addresses)
+  {
+    if (addr.family() == AF_INET)
+    {
+      struct sockaddr_in sa = *sockets::sockaddr_in_cast(addr.getSockAddr());
+      sa.sin_port = sockets::hostToNetwork16(port);
+      result.push_back(InetAddress(sa));
+    }
+    else
+    {
+      struct sockaddr_in6 sa = *sockets::sockaddr_in6_cast(addr.getSockAddr());
+      sa.sin6_port = sockets::hostToNetwork16(port);
+      result.push_back(InetAddress(sa));
+    }
+  }
+  cb(result);
+}
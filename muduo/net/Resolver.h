@@ -0,0 +1,109 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_RESOLVER_H
+#define MUDUO_NET_RESOLVER_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TimerId.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class Channel;
+class EventLoop;
+
+///
+/// Non-blocking DNS stub resolver, driven by an EventLoop.
+///
+/// Looks up /etc/hosts first, then sends A and AAAA queries over UDP
+/// to the nameservers of /etc/resolv.conf, one after another on timeout.
+/// Answers are cached for their TTL, concurrent lookups of the same name
+/// share one query. No search domains, no TCP fallback.
+class Resolver : noncopyable
+{
+ public:
+  /// All addresses of the name, with the requested port. Empty on failure.
+  typedef std::function<void(const std::vector<InetAddress>&)> Callback;
+
+  /// Reads /etc/resolv.conf and /etc/hosts.
+  explicit Resolver(EventLoop* loop);
+  /// Uses the given nameservers and hosts file, mostly for testing.
+  Resolver(EventLoop* loop,
+           const std::vector<InetAddress>& nameservers,
+           const string& hostsFile);
+  ~Resolver();
+
+  /// Per query, default from resolv.conf or 5 seconds.
+  void setTimeout(double seconds) { timeoutMs_ = static_cast<int>(seconds * 1000); }
+  /// Tries per lookup, default from resolv.conf or 2.
+  void setAttempts(int attempts) { attempts_ = attempts; }
+  /// Also asks for IPv6 addresses, default true.
+  void setIpv6(bool on) { ipv6_ = on; }
+
+  /// Calls cb in the loop thread, never before returning.
+  /// Thread safe.
+  void resolve(StringArg hostname, uint16_t port, const Callback& cb);
+
+  /// Number of cached names, including negative answers. Loop thread only.
+  size_t cacheSize() const { return cache_.size(); }
+  void clearCache() { cache_.clear(); }
+
+  const std::vector<InetAddress>& nameservers() const { return nameservers_; }
+
+ private:
+  struct CacheEntry
+  {
+    std::vector<InetAddress> addresses;   // port 0, empty for NXDOMAIN
+    Timestamp expiration;
+  };
+
+  struct Lookup;
+  typedef std::unique_ptr<Lookup> LookupPtr;
+
+  void init(const std::vector<InetAddress>& nameservers, const string& hostsFile);
+  void loadResolvConf(const string& path, std::vector<InetAddress>* nameservers);
+  void loadHosts(const string& path);
+  void resolveInLoop(const string& hostname, uint16_t port, const Callback& cb);
+  bool resolveLocally(const string& name, std::vector<InetAddress>* addresses) const;
+  void sendQueries(Lookup* lookup);
+  void handleRead(size_t server);
+  void handleTimeout(Lookup* lookup);
+  void finish(Lookup* lookup, bool cache);
+  uint16_t newQueryId();
+
+  static void deliver(const std::vector<InetAddress>& addresses,
+                      uint16_t port, const Callback& cb);
+
+  EventLoop* loop_;
+  int timeoutMs_;
+  int attempts_;
+  bool ipv6_;
+  unsigned int seed_;
+  std::vector<InetAddress> nameservers_;
+  std::vector<int> sockets_;   // one connected UDP socket per nameserver
+  std::vector<std::unique_ptr<Channel>> channels_;
+  std::map<string, std::vector<InetAddress>> hosts_;    // /etc/hosts
+  std::map<string, CacheEntry> cache_;                  // 以名字为键的缓存
+  std::map<string, LookupPtr> lookups_;                 // 正在进行的查询
+  std::unordered_map<uint16_t, Lookup*> queries_;       // query id -> lookup
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_RESOLVER_H
@@ -54,14 +54,22 @@ void removeConnector(const ConnectorPtr& connector)
 TcpClient::TcpClient(EventLoop* loop,
                      const InetAddress& serverAddr,
                      const string& nameArg)
+  : TcpClient(loop, std::vector<InetAddress>(1, serverAddr), nameArg)
+{
+}
+
+TcpClient::TcpClient(EventLoop* loop,
+                     const std::vector<InetAddress>& serverAddrs,
+                     const string& nameArg)
   : loop_(CHECK_NOTNULL(loop)),
-    connector_(new Connector(loop, serverAddr)),
+    connector_(new Connector(loop, serverAddrs)),
     name_(nameArg),
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
     retry_(false),
     connect_(true),
-    nextConnId_(1)
+    nextConnId_(1),
+    mutex_("TcpClient::connection_")
 {
   connector_->setNewConnectionCallback(
       std::bind(&TcpClient::newConnection, this, _1));
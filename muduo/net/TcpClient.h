@@ -30,6 +30,10 @@ class TcpClient : noncopyable
   TcpClient(EventLoop* loop,
             const InetAddress& serverAddr,
             const string& nameArg);
+  /// Connects to whichever address answers first, see Connector.
+  TcpClient(EventLoop* loop,
+            const std::vector<InetAddress>& serverAddrs,
+            const string& nameArg);
   ~TcpClient();  // force out-line dtor, for std::unique_ptr members.
 
   void connect();
@@ -0,0 +1,238 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/TcpClientPool.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/TcpClient.h"
+
+#include <stdio.h>  // snprintf
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+void ignoreConnection(const TcpConnectionPtr&)
+{
+}
+
+}  // namespace
+
+TcpClientPool::TcpClientPool(EventLoop* loop,
+                             const std::vector<InetAddress>& backends,
+                             const string& nameArg)
+  : loop_(CHECK_NOTNULL(loop)),
+    backends_(backends),
+    name_(nameArg),
+    threadPool_(new EventLoopThreadPool(loop, name_)),
+    connectionsPerBackend_(1),
+    maxInflight_(0),
+    healthCheckInterval_(0.0),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    started_(false),
+    mutex_("TcpClientPool::slots_"),
+    next_(0)
+{
+}
+
+TcpClientPool::~TcpClientPool()
+{
+  LOG_TRACE << "TcpClientPool::~TcpClientPool [" << name_ << "] destructing";
+  // timers and connection callbacks hold this and the slots, they are
+  // detached in the loops of the slots before the slots go away.
+  CountDownLatch latch(static_cast<int>(slots_.size()));
+  for (const auto& slot : slots_)
+  {
+    slot->client->getLoop()->runInLoop(
+        std::bind(&TcpClientPool::detachSlot, this, get_pointer(slot), &latch));
+  }
+  latch.wait();
+  for (const auto& slot : slots_)
+  {
+    // so that TcpClient sees it holds the last reference
+    MutexLockGuard lock(mutex_);
+    slot->connection.reset();
+  }
+  // TcpClient closes its connection in its own loop
+  slots_.clear();
+}
+
+void TcpClientPool::setThreadNum(int numThreads)
+{
+  assert(0 <= numThreads);
+  assert(!started_);
+  threadPool_->setThreadNum(numThreads);
+}
+
+void TcpClientPool::start()
+{
+  loop_->assertInLoopThread();
+  assert(!started_);
+  assert(!backends_.empty());
+  started_ = true;
+  threadPool_->start();
+
+  for (size_t i = 0; i < backends_.size(); ++i)
+  {
+    for (int j = 0; j < connectionsPerBackend_; ++j)
+    {
+      char buf[64];
+      snprintf(buf, sizeof buf, "-%s-%d", backends_[i].toIpPort().c_str(), j);
+      EventLoop* ioLoop = threadPool_->getNextLoop();
+
+      std::unique_ptr<Slot> slot(new Slot);
+      slot->client.reset(new TcpClient(ioLoop, backends_[i], name_ + buf));
+      slot->inflight = 0;
+      // reconnects with Connector's back-off, on refused connect and on close
+      slot->client->enableRetry();
+      slot->client->setConnectionCallback(
+          std::bind(&TcpClientPool::onConnection, this, get_pointer(slot), _1));
+      slot->client->setMessageCallback(messageCallback_);
+      slot->client->setWriteCompleteCallback(writeCompleteCallback_);
+      slots_.push_back(std::move(slot));
+    }
+  }
+
+  for (const auto& slot : slots_)
+  {
+    slot->client->connect();
+    if (healthCheckCallback_ && healthCheckInterval_ > 0)
+    {
+      Slot* s = get_pointer(slot);
+      s->healthCheckTimer = s->client->getLoop()->runEvery(
+          healthCheckInterval_, std::bind(&TcpClientPool::checkHealth, this, s));
+    }
+  }
+}
+
+void TcpClientPool::stop()
+{
+  for (const auto& slot : slots_)
+  {
+    slot->client->getLoop()->cancel(slot->healthCheckTimer);
+    slot->client->stop();
+    slot->client->disconnect();
+  }
+}
+
+TcpConnectionPtr TcpClientPool::acquire()
+{
+  MutexLockGuard lock(mutex_);
+  const size_t n = slots_.size();
+  Slot* best = NULL;
+  size_t bestIndex = 0;
+  for (size_t k = 0; k < n; ++k)
+  {
+    size_t i = (next_ + k) % n;
+    Slot* slot = get_pointer(slots_[i]);
+    if (!slot->connection
+        || (maxInflight_ > 0 && slot->inflight >= maxInflight_))
+    {
+      continue;
+    }
+    if (best == NULL || slot->inflight < best->inflight)
+    {
+      best = slot;
+      bestIndex = i;
+      if (best->inflight == 0)
+        break;
+    }
+  }
+
+  if (best == NULL)
+  {
+    return TcpConnectionPtr();
+  }
+  ++best->inflight;
+  // ties go round-robin
+  next_ = (bestIndex + 1) % n;
+  return best->connection;
+}
+
+void TcpClientPool::release(const TcpConnectionPtr& conn)
+{
+  MutexLockGuard lock(mutex_);
+  for (const auto& slot : slots_)
+  {
+    if (slot->connection == conn)
+    {
+      if (slot->inflight > 0)
+        --slot->inflight;
+      return;
+    }
+  }
+  // the connection has gone down since acquire(), its count was reset
+}
+
+int TcpClientPool::numConnected() const
+{
+  MutexLockGuard lock(mutex_);
+  int count = 0;
+  for (const auto& slot : slots_)
+  {
+    if (slot->connection)
+      ++count;
+  }
+  return count;
+}
+
+void TcpClientPool::onConnection(Slot* slot, const TcpConnectionPtr& conn)
+{
+  conn->getLoop()->assertInLoopThread();
+  LOG_INFO << "TcpClientPool [" << name_ << "] - " << conn->name()
+           << (conn->connected() ? " UP" : " DOWN");
+  {
+    MutexLockGuard lock(mutex_);
+    if (conn->connected())
+    {
+      slot->connection = conn;
+    }
+    else
+    {
+      slot->connection.reset();
+    }
+    // requests in flight on a dead connection are lost anyway
+    slot->inflight = 0;
+  }
+  connectionCallback_(conn);
+}
+
+void TcpClientPool::detachSlot(Slot* slot, CountDownLatch* latch)
+{
+  slot->client->getLoop()->assertInLoopThread();
+  slot->client->getLoop()->cancel(slot->healthCheckTimer);
+  // connections copy the callback of TcpClient when they are made
+  slot->client->setConnectionCallback(ignoreConnection);
+  TcpConnectionPtr conn = slot->client->connection();
+  if (conn)
+  {
+    conn->setConnectionCallback(ignoreConnection);
+  }
+  latch->countDown();
+}
+
+void TcpClientPool::checkHealth(Slot* slot)
+{
+  TcpConnectionPtr conn;
+  {
+    MutexLockGuard lock(mutex_);
+    if (slot->inflight == 0)
+    {
+      conn = slot->connection;
+    }
+  }
+  if (conn && !healthCheckCallback_(conn))
+  {
+    LOG_WARN << "TcpClientPool [" << name_ << "] - " << conn->name()
+             << " failed health check, reconnecting";
+    conn->forceClose();
+  }
+}
@@ -0,0 +1,118 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_TCPCLIENTPOOL_H
+#define MUDUO_NET_TCPCLIENTPOOL_H
+
+#include "muduo/base/Mutex.h"
+#include "muduo/net/TcpConnection.h"
+#include "muduo/net/TimerId.h"
+
+#include <vector>
+
+namespace muduo
+{
+class CountDownLatch;
+
+namespace net
+{
+
+class EventLoop;
+class EventLoopThreadPool;
+class TcpClient;
+
+///
+/// Keeps N warm connections to each backend of a cluster,
+/// spread over IO loops, and hands out the least busy one.
+///
+/// Connections reconnect with Connector's back-off when they go down.
+/// A connection may carry several requests at a time (pipelining),
+/// the user tells the pool when one completes with release().
+class TcpClientPool : noncopyable
+{
+ public:
+  /// Returns false if the connection looks unhealthy, it will be closed and reconnected.
+  typedef std::function<bool (const TcpConnectionPtr&)> HealthCheckCallback;
+
+  TcpClientPool(EventLoop* loop,
+                const std::vector<InetAddress>& backends,
+                const string& nameArg);
+  ~TcpClientPool();  // force out-line dtor, for std::unique_ptr members.
+
+  /// Must be called before @c start, see TcpServer::setThreadNum.
+  void setThreadNum(int numThreads);
+  /// Must be called before @c start, default 1.
+  void setConnectionsPerBackend(int n) { connectionsPerBackend_ = n; }
+  /// Max in-flight requests per connection, 0 (default) means unlimited.
+  void setMaxInflight(int n) { maxInflight_ = n; }
+  /// Calls cb on every idle connection in its loop, every interval seconds.
+  /// Must be called before @c start.
+  void setHealthCheck(double interval, const HealthCheckCallback& cb)
+  { healthCheckInterval_ = interval; healthCheckCallback_ = cb; }
+
+  /// Not thread safe, must be called before @c start.
+  void setConnectionCallback(const ConnectionCallback& cb)
+  { connectionCallback_ = cb; }
+  void setMessageCallback(const MessageCallback& cb)
+  { messageCallback_ = cb; }
+  void setWriteCompleteCallback(const WriteCompleteCallback& cb)
+  { writeCompleteCallback_ = cb; }
+
+  /// Connects everything, in loop thread.
+  void start();
+  /// Disconnects everything and stops reconnecting.
+  void stop();
+
+  /// Returns the connected connection with the fewest in-flight requests,
+  /// and counts one more request on it. Returns an empty pointer if
+  /// nothing is connected or every connection is at maxInflight.
+  /// Thread safe.
+  TcpConnectionPtr acquire();
+
+  /// A request on conn has completed. Thread safe.
+  void release(const TcpConnectionPtr& conn);
+
+  /// Number of connections that are up. Thread safe.
+  int numConnected() const;
+
+  EventLoop* getLoop() const { return loop_; }
+  const string& name() const { return name_; }
+
+ private:
+  struct Slot
+  {
+    std::unique_ptr<TcpClient> client;
+    TcpConnectionPtr connection;   // guarded by mutex_
+    int inflight;                  // guarded by mutex_
+    TimerId healthCheckTimer;
+  };
+
+  void onConnection(Slot* slot, const TcpConnectionPtr& conn);
+  void checkHealth(Slot* slot);
+  void detachSlot(Slot* slot, CountDownLatch* latch);
+
+  EventLoop* loop_;
+  const std::vector<InetAddress> backends_;
+  const string name_;
+  std::shared_ptr<EventLoopThreadPool> threadPool_;
+  int connectionsPerBackend_;
+  int maxInflight_;
+  double healthCheckInterval_;
+  HealthCheckCallback healthCheckCallback_;
+  ConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+  WriteCompleteCallback writeCompleteCallback_;
+  bool started_;
+  std::vector<std::unique_ptr<Slot>> slots_;   // fixed after start()
+  mutable MutexLock mutex_;
+  size_t next_ GUARDED_BY(mutex_);   // where the next scan starts, for fairness
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TCPCLIENTPOOL_H
@@ -11,11 +11,13 @@
 #include "muduo/base/Logging.h"
 #include "muduo/base/WeakCallback.h"
 #include "muduo/net/Channel.h"
+#include "muduo/net/ConnectionReaper.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/Socket.h"
 #include "muduo/net/SocketsOps.h"
 
 #include <errno.h>
+#include <stdio.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -35,43 +37,157 @@ void muduo::net::defaultMessageCallback(const TcpConnectionPtr&,
   buf->retrieveAll();
 }
 
+namespace
+{
+
+// until a connection gets its own or a shared one
+const TcpConnection::CallbackTablePtr& emptyCallbacks()
+{
+  static TcpConnection::CallbackTablePtr callbacks(new TcpConnection::CallbackTable);
+  return callbacks;
+}
+
+}  // namespace
+
+TcpConnection::TcpConnection(EventLoop* loop,
+                             const string& nameArg,
+                             int sockfd,
+                             const InetAddress& localAddr,
+                             const InetAddress& peerAddr)
+  : TcpConnection(loop, nameArg, std::shared_ptr<const string>(), 0,
+                  sockfd, localAddr, peerAddr)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop* loop,
+                             const std::shared_ptr<const string>& namePrefix,
+                             uint64_t id,
+                             int sockfd,
+                             const InetAddress& localAddr,
+                             const InetAddress& peerAddr)
+  : TcpConnection(loop, string(), namePrefix, id,
+                  sockfd, localAddr, peerAddr)
+{
+}
+
 TcpConnection::TcpConnection(EventLoop* loop,
                              const string& nameArg,
+                             const std::shared_ptr<const string>& namePrefix,
+                             uint64_t id,
                              int sockfd,
                              const InetAddress& localAddr,
                              const InetAddress& peerAddr)
   : loop_(CHECK_NOTNULL(loop)),
+    id_(id),
+    namePrefix_(namePrefix),
     name_(nameArg),
     state_(kConnecting),
     reading_(true),
-    socket_(new Socket(sockfd)),
-    channel_(new Channel(loop, sockfd)),
+    socket_(new (&socketStorage_) Socket(sockfd)),
+    channel_(new (&channelStorage_) Channel(loop, sockfd)),
     localAddr_(localAddr),
     peerAddr_(peerAddr),
-    highWaterMark_(64*1024*1024)
+    callbacks_(emptyCallbacks()),
+    highWaterMark_(64*1024*1024),
+    pendingReaper_(NULL),
+    reaper_(NULL)
 {
+  static_assert(sizeof(Socket) <= sizeof(SocketStorage), "SocketStorage too small");
+  static_assert(sizeof(Channel) <= sizeof(ChannelStorage), "kChannelStorage too small");
+  static_assert(alignof(Socket) <= alignof(SocketStorage), "SocketStorage misaligned");
+  static_assert(alignof(Channel) <= alignof(ChannelStorage), "ChannelStorage misaligned");
+  for (ReaperHook& hook : reaperHooks_)
+  {
+    hook.prev = NULL;
+    hook.next = NULL;
+    hook.linked = false;
+  }
+  // lambdas capturing only this are stored inside std::function,
+  // binds of member functions are allocated.
   //可读事件到来，回调 handleRead
   channel_->setReadCallback(
-      std::bind(&TcpConnection::handleRead, this, _1));
-  channel_->setWriteCallback(
-      std::bind(&TcpConnection::handleWrite, this));
+      [this](Timestamp receiveTime) { handleRead(receiveTime); });
+  channel_->setWriteCallback([this] { handleWrite(); });
   //连接关闭，回调 handleClose
-  channel_->setCloseCallback(
-      std::bind(&TcpConnection::handleClose, this));
+  channel_->setCloseCallback([this] { handleClose(); });
   //发生错误，回调 handleError
-  channel_->setErrorCallback(
-      std::bind(&TcpConnection::handleError, this));
-  LOG_DEBUG << "TcpConnection::ctor[" <<  name_ << "] at " << this
+  channel_->setErrorCallback([this] { handleError(); });
+  LOG_DEBUG << "TcpConnection::ctor[" <<  name() << "] at " << this
             << " fd=" << sockfd;
   socket_->setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection()
 {
-  LOG_DEBUG << "TcpConnection::dtor[" <<  name_ << "] at " << this
+  LOG_DEBUG << "TcpConnection::dtor[" <<  name() << "] at " << this
             << " fd=" << channel_->fd()
             << " state=" << stateToString();
   assert(state_ == kDisconnected);
+  assert(reaper_ == NULL);
+  channel_->~Channel();
+  socket_->~Socket();
+}
+
+TcpConnection::CallbackTable* TcpConnection::mutableCallbacks()
+{
+  if (callbacks_.use_count() > 1)
+  {
+    callbacks_.reset(new CallbackTable(*callbacks_));
+  }
+  return get_pointer(callbacks_);
+}
+
+void TcpConnection::count(ConnectionStats::Counter c, int64_t delta)
+{
+  stats_.add(c, delta);
+  if (statsAggregate_)
+  {
+    statsAggregate_->add(c, delta);
+  }
+}
+
+// after appending to outputBuffer_
+void TcpConnection::outputBufferGrown()
+{
+  int64_t backlog = static_cast<int64_t>(outputBuffer_.readableBytes());
+  stats_.raise(ConnectionStats::kMaxOutputBacklog, backlog);
+  if (statsAggregate_)
+  {
+    statsAggregate_->raise(ConnectionStats::kMaxOutputBacklog, backlog);
+  }
+  if (outputBuffer_.readableBytes() >= highWaterMark_
+      && !aboveHighWaterMarkSince_.valid())
+  {
+    aboveHighWaterMarkSince_ = Timestamp::now();
+    count(ConnectionStats::kAboveHighWaterMark, 1);
+  }
+}
+
+// after retrieving from outputBuffer_, or when closing
+void TcpConnection::outputBufferShrunk(bool closing)
+{
+  if (aboveHighWaterMarkSince_.valid()
+      && (closing || outputBuffer_.readableBytes() < highWaterMark_))
+  {
+    int64_t us = Timestamp::now().microSecondsSinceEpoch()
+                 - aboveHighWaterMarkSince_.microSecondsSinceEpoch();
+    count(ConnectionStats::kHighWaterMarkUs, us);
+    count(ConnectionStats::kAboveHighWaterMark, -1);
+    aboveHighWaterMarkSince_ = Timestamp::invalid();
+  }
+}
+
+const string& TcpConnection::name() const
+{
+  std::call_once(nameOnce_, [this] {
+    if (namePrefix_)
+    {
+      char buf[16];
+      snprintf(buf, sizeof buf, "%u", static_cast<uint32_t>(id_ >> 32));
+      name_ = *namePrefix_ + buf;
+    }
+  });
+  return name_;
 }
 
 bool TcpConnection::getTcpInfo(struct tcp_info* tcpi) const
@@ -163,13 +279,19 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
   {
     nwrote = sockets::write(channel_->fd(), data, len);
+    count(ConnectionStats::kWriteCalls, 1);
     if (nwrote >= 0)
     {
       remaining = len - nwrote;
-      //如果写完了，则回调 writeCompleteCallback_
-      if (remaining == 0 && writeCompleteCallback_)
+      count(ConnectionStats::kBytesSent, nwrote);
+      if (reaper_ && nwrote > 0)
+      {
+        reaper_->touchWrite(this, loop_->pollReturnTime(), false);
+      }
+      //如果写完了，则回调 writeCompleteCallback
+      if (remaining == 0 && callbacks_->writeCompleteCallback)
       {
-        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
       }
     }
     //小于 0 表示出错
@@ -194,18 +316,23 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   {
     LOG_TRACE << "I am going to write more data";
     size_t oldLen = outputBuffer_.readableBytes();
-    //如果超过高水位标，则回调 highWaterMarkCallback_
+    //如果超过高水位标，则回调 highWaterMarkCallback
     if (oldLen + remaining >= highWaterMark_
         && oldLen < highWaterMark_
-        && highWaterMarkCallback_)
+        && callbacks_->highWaterMarkCallback)
     {
-      loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+      loop_->queueInLoop(std::bind(callbacks_->highWaterMarkCallback, shared_from_this(), oldLen + remaining));
     }
     outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
+    outputBufferGrown();
     //缓冲区有数据了，所以我们要关注写事件
     if (!channel_->isWriting())
     {
       channel_->enableWriting();
+      if (reaper_)
+      {
+        reaper_->writePending(this, loop_->pollReturnTime());
+      }
     }
   }
 }
@@ -363,10 +490,16 @@ void TcpConnection::connectEstablished()
   channel_->tie(shared_from_this());
   //关注 TcpConnect 的可读事件
   channel_->enableReading();
+  count(ConnectionStats::kConnections, 1);
+  if (pendingReaper_)
+  {
+    pendingReaper_->add(this, Timestamp::now());
+    pendingReaper_ = NULL;
+  }
 
   //连接建立后，客户端调用它的连接回调函数
   // 一开时又变为 3，调用完后变为 2
-  connectionCallback_(shared_from_this());
+  callbacks_->connectionCallback(shared_from_this());
 
   //这里引用计数是 2
   LOG_TRACE  << "[3] usercount = " << conn.use_count();
@@ -375,14 +508,20 @@ void TcpConnection::connectEstablished()
 void TcpConnection::connectDestroyed()
 {
   loop_->assertInLoopThread();
+  if (reaper_)
+  {
+    reaper_->remove(this);
+  }
   //这里不会调用，因为 handleClose() 已经处理过了
   if (state_ == kConnected)
   {
     setState(kDisconnected);
     channel_->disableAll();
 
-    connectionCallback_(shared_from_this());
+    callbacks_->connectionCallback(shared_from_this());
   }
+  outputBufferShrunk(true);
+  count(ConnectionStats::kConnections, -1);
   //将channel 从 poll 中移除
   channel_->remove();
   //这个函数默认传递 this 指针，但我们这里传递的是一个 share_ptr 对象
@@ -396,9 +535,16 @@ void TcpConnection::handleRead(Timestamp receiveTime)
   loop_->assertInLoopThread();
   int savedErrno = 0;
   ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  count(ConnectionStats::kReadCalls, 1);
   if (n > 0)
   {
-    messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    count(ConnectionStats::kBytesReceived, n);
+    count(ConnectionStats::kMessages, 1);
+    if (reaper_)
+    {
+      reaper_->touchRead(this, receiveTime);
+    }
+    callbacks_->messageCallback(shared_from_this(), &inputBuffer_, receiveTime);
   }
   else if (n == 0)
   {
@@ -444,18 +590,25 @@ void TcpConnection::handleWrite()
     ssize_t n = sockets::write(channel_->fd(),
                                outputBuffer_.peek(),
                                outputBuffer_.readableBytes());
+    count(ConnectionStats::kWriteCalls, 1);
     if (n > 0)
     {
       outputBuffer_.retrieve(n);
+      count(ConnectionStats::kBytesSent, n);
+      outputBufferShrunk(false);
+      if (reaper_)
+      {
+        reaper_->touchWrite(this, loop_->pollReturnTime(), outputBuffer_.readableBytes() > 0);
+      }
       //应用缓冲区清空
       if (outputBuffer_.readableBytes() == 0)
       {
         //不关注 pollout 事件避免 busyLoop
         channel_->disableWriting();
-        //调用 writeCompleteCallback_
-        if (writeCompleteCallback_)
+        //调用 writeCompleteCallback
+        if (callbacks_->writeCompleteCallback)
         {
-          loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+          loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
         }
         //发送缓冲区已清空并且连接状态是 KDisconning，要关闭连接
         if (state_ == kDisconnecting)
@@ -488,18 +641,23 @@ void TcpConnection::handleClose()
   assert(state_ == kConnected || state_ == kDisconnecting);
   // we don't close fd, leave it to dtor, so we can find leaks easily.
   setState(kDisconnected);
+  if (reaper_)
+  {
+    reaper_->remove(this);
+  }
+  outputBufferShrunk(true);
 
   //这里并没有调用 channel_ 的 remove()，因为当前还处于 channel_ 的 handleEvent() 函数中
   channel_->disableAll();
  
   TcpConnectionPtr guardThis(shared_from_this());
-  connectionCallback_(guardThis);
+  callbacks_->connectionCallback(guardThis);
   
   //这里引用计数仍然为 3
   LOG_TRACE  << "[6] usercount = " << guardThis.use_count();
   // must be the last line
   //这里调用的 TcpServer::removeConnection 函数
-  closeCallback_(guardThis);
+  callbacks_->closeCallback(guardThis);
   //引用计数还是 3
   LOG_TRACE  << "[11] usercount = " << guardThis.use_count();
   //退出后 guardThis 临时对象被释放，引用计数减一，引用计数为 2
@@ -508,7 +666,7 @@ void TcpConnection::handleClose()
 void TcpConnection::handleError()
 {
   int err = sockets::getSocketError(channel_->fd());
-  LOG_ERROR << "TcpConnection::handleError [" << name_
+  LOG_ERROR << "TcpConnection::handleError [" << name()
             << "] - SO_ERROR = " << err << " " << strerror_tl(err);
 }
 
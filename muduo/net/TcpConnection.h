@@ -16,9 +16,12 @@
 #include "muduo/base/Types.h"
 #include "muduo/net/Callbacks.h"
 #include "muduo/net/Buffer.h"
+#include "muduo/net/ConnectionStats.h"
 #include "muduo/net/InetAddress.h"
 
 #include <memory>
+#include <mutex>
+#include <type_traits>
 
 #include <boost/any.hpp>
 
@@ -31,6 +34,7 @@ namespace net
 {
 
 class Channel;
+class ConnectionReaper;
 class EventLoop;
 class Socket;
 
@@ -42,6 +46,20 @@ class TcpConnection : noncopyable,
                       public std::enable_shared_from_this<TcpConnection>
 {
  public:
+  /// Callbacks that can be shared by many connections, eg. all those of
+  /// a TcpServer, instead of being copied into each one.
+  /// Don't modify a table once it's handed to a connection.
+  struct CallbackTable
+  {
+    ConnectionCallback connectionCallback;        //连接回调函数，即包含连接建立和连接断开
+    MessageCallback messageCallback;              //信息到来回调函数
+    //注意只有对大流量的应用程序序才需要关注 writeCompleteCallback
+    WriteCompleteCallback writeCompleteCallback;  //数据发送完毕回调函数，outputBuffer 被清空时回调
+    HighWaterMarkCallback highWaterMarkCallback;  //高水位标回调函数
+    CloseCallback closeCallback;                  //连接断开回调函数
+  };
+  typedef std::shared_ptr<CallbackTable> CallbackTablePtr;
+
   /// Constructs a TcpConnection with a connected sockfd
   ///
   /// User should not create this object.
@@ -50,10 +68,20 @@ class TcpConnection : noncopyable,
                 int sockfd,
                 const InetAddress& localAddr,
                 const InetAddress& peerAddr);
+  /// Named lazily, name() is *namePrefix followed by the upper 32 bits
+  /// of id in decimal.
+  TcpConnection(EventLoop* loop,
+                const std::shared_ptr<const string>& namePrefix,
+                uint64_t id,
+                int sockfd,
+                const InetAddress& localAddr,
+                const InetAddress& peerAddr);
   ~TcpConnection();
 
   EventLoop* getLoop() const { return loop_; }
-  const string& name() const { return name_; }
+  const string& name() const;
+  /// Unique among the connections of a TcpServer, 0 for TcpClient.
+  uint64_t id() const { return id_; }
   const InetAddress& localAddress() const { return localAddr_; }
   const InetAddress& peerAddress() const { return peerAddr_; }
   bool connected() const { return state_ == kConnected; }
@@ -61,6 +89,8 @@ class TcpConnection : noncopyable,
   // return true if success.
   bool getTcpInfo(struct tcp_info*) const;
   string getTcpInfoString() const;
+  /// Counters of this connection, readable from any thread.
+  const ConnectionStats& stats() const { return stats_; }
 
   // void send(string&& message); // C++11
   void send(const void* message, int len);
@@ -89,17 +119,22 @@ class TcpConnection : noncopyable,
   boost::any* getMutableContext()
   { return &context_; }
 
+  // The setters below copy a shared table before changing it.
   void setConnectionCallback(const ConnectionCallback& cb)
-  { connectionCallback_ = cb; }
+  { mutableCallbacks()->connectionCallback = cb; }
 
   void setMessageCallback(const MessageCallback& cb)
-  { messageCallback_ = cb; }
+  { mutableCallbacks()->messageCallback = cb; }
 
   void setWriteCompleteCallback(const WriteCompleteCallback& cb)
-  { writeCompleteCallback_ = cb; }
+  { mutableCallbacks()->writeCompleteCallback = cb; }
 
   void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
-  { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }
+  { mutableCallbacks()->highWaterMarkCallback = cb; highWaterMark_ = highWaterMark; }
+
+  /// Replaces all the callbacks, sharing the table.
+  void setCallbackTable(const CallbackTablePtr& callbacks)
+  { callbacks_ = callbacks; }
 
   /// Advanced interface
   Buffer* inputBuffer()
@@ -110,7 +145,17 @@ class TcpConnection : noncopyable,
 
   /// Internal use only.
   void setCloseCallback(const CloseCallback& cb)
-  { closeCallback_ = cb; }
+  { mutableCallbacks()->closeCallback = cb; }
+
+  /// Internal use only, before connectEstablished().
+  void setReaper(ConnectionReaper* reaper)
+  { pendingReaper_ = reaper; }
+
+  /// Internal use only, before connectEstablished().
+  /// Counters are added to aggregate too, which must be written
+  /// by the loop of this connection only.
+  void setStatsAggregate(const std::shared_ptr<ConnectionStats>& aggregate)
+  { statsAggregate_ = aggregate; }
 
   // called when TcpServer accepts a new connection
   void connectEstablished();   // should be called only once
@@ -118,6 +163,25 @@ class TcpConnection : noncopyable,
   void connectDestroyed();  // should be called only once
 
  private:
+  TcpConnection(EventLoop* loop,
+                const string& nameArg,
+                const std::shared_ptr<const string>& namePrefix,
+                uint64_t id,
+                int sockfd,
+                const InetAddress& localAddr,
+                const InetAddress& peerAddr);
+
+  friend class ConnectionReaper;
+  static const int kNumReaperLists = 3;
+  // links of ConnectionReaper's intrusive lists
+  struct ReaperHook
+  {
+    TcpConnection* prev;
+    TcpConnection* next;
+    Timestamp touched;
+    bool linked;
+  };
+
   enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
   void handleRead(Timestamp receiveTime);
   void handleWrite();
@@ -133,31 +197,45 @@ class TcpConnection : noncopyable,
   const char* stateToString() const;
   void startReadInLoop();
   void stopReadInLoop();
+  CallbackTable* mutableCallbacks();
+  void count(ConnectionStats::Counter c, int64_t delta);
+  void outputBufferGrown();
+  void outputBufferShrunk(bool closing);
+
+  // Socket and Channel are constructed in place, so they come with the
+  // allocation of the connection without revealing their headers.
+  static const size_t kChannelStorage = 192;
+  typedef std::aligned_storage<sizeof(int), alignof(int)>::type SocketStorage;
+  typedef std::aligned_storage<kChannelStorage, alignof(void*)>::type ChannelStorage;
 
   EventLoop* loop_;         //所属的 EvenLoop
-  const string name_;       //客户端名称
+  const uint64_t id_;
+  const std::shared_ptr<const string> namePrefix_;
+  mutable std::once_flag nameOnce_;
+  mutable string name_;     //客户端名称，第一次用到时才生成
   StateE state_;  // FIXME: use atomic variable   连接的状态
   bool reading_;
   // we don't expose those classes to client.
-  std::unique_ptr<Socket> socket_;            //客户端套接字
-  std::unique_ptr<Channel> channel_;          //监听通道
+  SocketStorage socketStorage_;
+  ChannelStorage channelStorage_;
+  Socket* const socket_;                      //客户端套接字，在 socketStorage_ 中
+  Channel* const channel_;                    //监听通道，在 channelStorage_ 中
   const InetAddress localAddr_;               //本地地址
   const InetAddress peerAddr_;                //对等方地址
-  ConnectionCallback connectionCallback_;       //连接回调函数，即包含连接建立和连接断开
-  MessageCallback messageCallback_;             //信息到来回调函数
-  //注意只有对大流量的应用程序序才需要关注 writeCompleteCallback_
-  WriteCompleteCallback writeCompleteCallback_;   //数据发送完毕回调函数，即所有的用户数据都已拷贝到内核缓冲区时回调的函数
-                                                  //outputBuffer 被清空也会回调该函数，可以理解为低水位标回调函数
-  HighWaterMarkCallback highWaterMarkCallback_;   //高水位标回调函数
-  CloseCallback closeCallback_;               //连接断开回调函数
+  CallbackTablePtr callbacks_;                //回调函数表，可能与其他连接共享
   size_t highWaterMark_;                      //高水位标
   //应用层的接收缓冲区
   Buffer inputBuffer_;
   //应用层的发送缓冲区
   Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
   boost::any context_;        //绑定一个未知类型的上下文对象
+  ConnectionReaper* pendingReaper_;           //connectEstablished 时加入
+  ConnectionReaper* reaper_;                  //超时检测，NULL 表示不检测
+  ReaperHook reaperHooks_[kNumReaperLists];
+  ConnectionStats stats_;
+  std::shared_ptr<ConnectionStats> statsAggregate_;  //所属 TcpServer 的 loop 统计
+  Timestamp aboveHighWaterMarkSince_;         //超过高水位标的时刻，无效表示未超过
   // FIXME: creationTime_, lastReceiveTime_
-  //        bytesReceived_, bytesSent_
 };
 
 //连接对象指针
@@ -10,11 +10,13 @@
 
 #include "muduo/base/Logging.h"
 #include "muduo/net/Acceptor.h"
+#include "muduo/net/AdmissionControl.h"
+#include "muduo/net/ConnectionPool.h"
+#include "muduo/net/ConnectionReaper.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThreadPool.h"
 #include "muduo/net/SocketsOps.h"
 
-#include <stdio.h>  // snprintf
 
 using namespace muduo;
 using namespace muduo::net;
@@ -26,30 +28,46 @@ TcpServer::TcpServer(EventLoop* loop,
   : loop_(CHECK_NOTNULL(loop)),   //检查 loop 指针是否为 NULL
     ipPort_(listenAddr.toIpPort()),
     name_(nameArg),
+    connNamePrefix_(std::make_shared<const string>(name_ + "-" + ipPort_ + "#")),
     acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+    admission_(new AdmissionControl(loop)),
     threadPool_(new EventLoopThreadPool(loop, name_)),
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
-    nextConnId_(1)
+    idleTimeout_(0.0),
+    readTimeout_(0.0),
+    writeTimeout_(0.0),
+    nextConnId_(1),
+    numConnections_(0)
 {
   //设置 newConnection 的回调函数，因为有两个参数，所以有两个占位符
   //第一个参数是客户端套接字，第二个参数是客户端地址
   acceptor_->setNewConnectionCallback(
       std::bind(&TcpServer::newConnection, this, _1, _2));
+  acceptor_->setHoldOffCallback(
+      std::bind(&AdmissionControl::holdOff, get_pointer(admission_)));
 }
 
 TcpServer::~TcpServer()
 {
   loop_->assertInLoopThread();
   LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] destructing";
+  admission_->stop();
 
-  for (auto& item : connections_)
+  for (TcpConnectionPtr& slot : connections_)
   {
-    TcpConnectionPtr conn(item.second);
-    item.second.reset();
+    if (!slot)
+      continue;
+    TcpConnectionPtr conn(slot);
+    slot.reset();
     conn->getLoop()->runInLoop(
       std::bind(&TcpConnection::connectDestroyed, conn));
   }
+  // after the connections have left them
+  for (auto& item : reapers_)
+  {
+    item.first->runInLoop(std::bind(&ConnectionReaper::stop, item.second));
+  }
 }
 
 void TcpServer::setThreadNum(int numThreads)
@@ -58,6 +76,47 @@ void TcpServer::setThreadNum(int numThreads)
   threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setMaxConnections(int maxConnections)
+{
+  admission_->setMaxConnections(maxConnections);
+}
+
+void TcpServer::setAcceptRate(double perSecond, int burst)
+{
+  admission_->setAcceptRate(perSecond, burst);
+}
+
+void TcpServer::setOverloadThreshold(size_t queueDepth, double lagSeconds)
+{
+  admission_->setOverloadThreshold(queueDepth, lagSeconds);
+}
+
+int64_t TcpServer::numRejected() const
+{
+  return admission_->rejected();
+}
+
+int64_t TcpServer::numDeferred() const
+{
+  return admission_->deferred();
+}
+
+ConnectionStats::Snapshot TcpServer::stats() const
+{
+  ConnectionStats::Snapshot result = {};
+  for (const auto& item : loopStats_)
+  {
+    ConnectionStats::merge(&result, item.second->snapshot());
+  }
+  return result;
+}
+
+const ConnectionStats* TcpServer::loopStats(EventLoop* ioLoop) const
+{
+  auto it = loopStats_.find(ioLoop);
+  return it != loopStats_.end() ? get_pointer(it->second) : NULL;
+}
+
 
 //该函数多次调用是无害的，第一次调用 started_ 就不为 0 了，就不会调用监听函数了
 //该函数可以跨线程调用
@@ -70,6 +129,23 @@ void TcpServer::start()
     //启动线程池
     threadPool_->start(threadInitCallback_);
 
+    for (EventLoop* ioLoop : threadPool_->getAllLoops())
+    {
+      pools_[ioLoop] = std::make_shared<ConnectionPool>();
+      loopStats_[ioLoop] = std::make_shared<ConnectionStats>();
+    }
+    if (idleTimeout_ > 0 || readTimeout_ > 0 || writeTimeout_ > 0)
+    {
+      for (EventLoop* ioLoop : threadPool_->getAllLoops())
+      {
+        std::shared_ptr<ConnectionReaper> reaper(
+            new ConnectionReaper(ioLoop, idleTimeout_, readTimeout_, writeTimeout_));
+        reaper->start();
+        reapers_[ioLoop] = reaper;
+      }
+    }
+    admission_->start(threadPool_->getAllLoops());
+
     assert(!acceptor_->listening());
     //使用了 runInLoop 函数，跨线程
     //执行 acceptor_ 指针对应的 listen 对象
@@ -84,39 +160,62 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
 {
   //断言在 IO 线程中
   loop_->assertInLoopThread();
+  //连接数达到上限，直接关闭
+  if (!admission_->admit(numConnections_))
+  {
+    sockets::close(sockfd);
+    return;
+  }
   //按照轮叫的方式选择一个 EvenLoop
   EventLoop* ioLoop = threadPool_->getNextLoop();
-  char buf[64];
-  snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
+  uint32_t slot;
+  if (freeSlots_.empty())
+  {
+    slot = static_cast<uint32_t>(connections_.size());
+    connections_.push_back(TcpConnectionPtr());
+  }
+  else
+  {
+    slot = freeSlots_.back();
+    freeSlots_.pop_back();
+  }
+  //连接的名称是 服务器名称 + 服务器端口号 + 连接 ID，用到时才生成
+  uint64_t connId = static_cast<uint64_t>(nextConnId_) << 32 | slot;
   ++nextConnId_;
-  //连接的名称是 服务器名称 + 服务器端口号 + 连接 ID
-  string connName = name_ + buf;
 
-  LOG_INFO << "TcpServer::newConnection [" << name_
-           << "] - new connection [" << connName
+  LOG_DEBUG << "TcpServer::newConnection [" << name_
+           << "] - new connection [" << *connNamePrefix_ << (connId >> 32)
            << "] from " << peerAddr.toIpPort();
 
   InetAddress localAddr(sockets::getLocalAddr(sockfd));
   // FIXME poll with zero timeout to double confirm the new connection
-  // FIXME use make_shared if necessary
-  // 创建一个 shared_ptr 对象
-  TcpConnectionPtr conn(new TcpConnection(ioLoop,
-                                          connName,
-                                          sockfd,
-                                          localAddr,
-                                          peerAddr));
+  // 创建一个 shared_ptr 对象，连接和引用计数在同一块内存中，来自 ioLoop 的内存池
+  TcpConnectionPtr conn(std::allocate_shared<TcpConnection>(
+      ConnectionAllocator<TcpConnection>(pools_[ioLoop]),
+      ioLoop, connNamePrefix_, connId, sockfd, localAddr, peerAddr));
   //此时引用计数应该是 1
   LOG_TRACE  << "[1] usercount = " << conn.use_count();
   //加入到 connection_ 中，引用计数加 1
-  connections_[connName] = conn;
+  connections_[slot] = conn;
+  ++numConnections_;
   //引用计数是 2
   LOG_TRACE  << "[2] usercount = " << conn.use_count();
-  //将 TcpServer 中的回调函数设置到 TcpConnection 中
-  conn->setConnectionCallback(connectionCallback_);
-  conn->setMessageCallback(messageCallback_);
-  conn->setWriteCompleteCallback(writeCompleteCallback_);
-  conn->setCloseCallback(
-      std::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe
+  //将 TcpServer 中的回调函数设置到 TcpConnection 中，所有连接共享一份
+  if (!callbacks_)
+  {
+    callbacks_.reset(new TcpConnection::CallbackTable);
+    callbacks_->connectionCallback = connectionCallback_;
+    callbacks_->messageCallback = messageCallback_;
+    callbacks_->writeCompleteCallback = writeCompleteCallback_;
+    callbacks_->closeCallback =
+        std::bind(&TcpServer::removeConnection, this, _1); // FIXME: unsafe
+  }
+  conn->setCallbackTable(callbacks_);
+  conn->setStatsAggregate(loopStats_[ioLoop]);
+  if (!reapers_.empty())
+  {
+    conn->setReaper(get_pointer(reapers_[ioLoop]));
+  }
   
   //让事件所连接的 IO 线程调用 connectEstablished 函数
   ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
@@ -137,19 +236,21 @@ void TcpServer::removeConnection(const TcpConnectionPtr& conn)
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
 {
   loop_->assertInLoopThread();
-  LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
-           << "] - connection " << conn->name();
+  LOG_DEBUG << "TcpServer::removeConnectionInLoop [" << name_
+           << "] - connection " << *connNamePrefix_ << (conn->id() >> 32);
   
   
   //这里还是 3
   LOG_TRACE  << "[8] usercount = " << conn.use_count();
   
   //将对象从列表中移除
-  size_t n = connections_.erase(conn->name());
+  uint32_t slot = static_cast<uint32_t>(conn->id());
+  assert(slot < connections_.size() && connections_[slot] == conn);
+  connections_[slot].reset();
+  freeSlots_.push_back(slot);
+  --numConnections_;
   //释放了一个对象，引用计数变为 2
   LOG_TRACE  << "[9] usercount = " << conn.use_count();
-  (void)n;
-  assert(n == 1);
   EventLoop* ioLoop = conn->getLoop();
 
   //此时还处于 handleEvent() 中，而 connectDestroyed 是在 loop() 最后处理的
@@ -16,6 +16,7 @@
 #include "muduo/net/TcpConnection.h"
 
 #include <map>
+#include <vector>
 
 namespace muduo
 {
@@ -23,6 +24,9 @@ namespace net
 {
 
 class Acceptor;
+class AdmissionControl;
+class ConnectionPool;
+class ConnectionReaper;
 class EventLoop;
 class EventLoopThreadPool;
 
@@ -69,6 +73,44 @@ class TcpServer : noncopyable
   std::shared_ptr<EventLoopThreadPool> threadPool()
   { return threadPool_; }
 
+  /// Closes connections without any traffic for this long.
+  /// Must be called before @c start, 0 (default) means never.
+  void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+  /// Closes connections that send nothing for this long.
+  /// Must be called before @c start, 0 (default) means never.
+  void setReadTimeout(double seconds) { readTimeout_ = seconds; }
+  /// Closes connections whose pending output makes no progress for this long,
+  /// ie. the peer stopped reading. Must be called before @c start,
+  /// 0 (default) means never.
+  void setWriteTimeout(double seconds) { writeTimeout_ = seconds; }
+
+  /// Connections beyond this many are closed right after accepting.
+  /// Must be called before @c start, 0 (default) means no limit.
+  void setMaxConnections(int maxConnections);
+  /// Accepts perSecond connections on average and up to burst at once,
+  /// others wait in the listen backlog.
+  /// Must be called before @c start, 0 (default) means no limit.
+  void setAcceptRate(double perSecond, int burst);
+  /// Stops accepting while any IO loop has queueDepth pending functors, or
+  /// runs lagSeconds late. Must be called before @c start, 0 (default)
+  /// disables either check.
+  void setOverloadThreshold(size_t queueDepth, double lagSeconds);
+
+  /// Connections closed because of the limit. Thread safe.
+  int64_t numRejected() const;
+  /// Times accepting was held off by the rate limit or overload,
+  /// while connections were waiting. Thread safe.
+  int64_t numDeferred() const;
+  /// Not thread safe, but in loop
+  size_t numConnections() const { return numConnections_; }
+
+  /// Counters of all connections, alive or gone, summed over the IO loops.
+  /// Thread safe, lock free, after calling start().
+  ConnectionStats::Snapshot stats() const;
+  /// Counters of the connections of one IO loop, NULL if it isn't one.
+  /// Thread safe, lock free, after calling start().
+  const ConnectionStats* loopStats(EventLoop* ioLoop) const;
+
   /// Starts the server if it's not listening.
   ///
   /// It's harmless to call it multiple times.
@@ -79,18 +121,18 @@ class TcpServer : noncopyable
   /// Not thread safe.
   /// 设置连接到来或者连接关闭的回调函数
   void setConnectionCallback(const ConnectionCallback& cb)
-  { connectionCallback_ = cb; }
+  { connectionCallback_ = cb; callbacks_.reset(); }
 
   /// Set message callback.
   /// Not thread safe.
   /// 设置消息到来的回调函数
   void setMessageCallback(const MessageCallback& cb)
-  { messageCallback_ = cb; }
+  { messageCallback_ = cb; callbacks_.reset(); }
 
   /// Set write complete callback.
   /// Not thread safe.
   void setWriteCompleteCallback(const WriteCompleteCallback& cb)
-  { writeCompleteCallback_ = cb; }
+  { writeCompleteCallback_ = cb; callbacks_.reset(); }
 
  private:
   /// Not thread safe, but in loop
@@ -101,22 +143,36 @@ class TcpServer : noncopyable
   /// Not thread safe, but in loop
   void removeConnectionInLoop(const TcpConnectionPtr& conn);
 
-  //连接列表，key 是连接名称，value 是连接对象指针
-  typedef std::map<string, TcpConnectionPtr> ConnectionMap;
-
   EventLoop* loop_;  // the acceptor loop   所属的 EvenLoop
   const string ipPort_;       //服务端口
   const string name_;         //服务名称
+  // name_-ipPort_#, connection names are this plus the connection number
+  const std::shared_ptr<const string> connNamePrefix_;
   std::unique_ptr<Acceptor> acceptor_; // avoid revealing Acceptor    acceptor_ 的声明周期由 TcpServer 决定
+  std::unique_ptr<AdmissionControl> admission_;
   std::shared_ptr<EventLoopThreadPool> threadPool_;
   ConnectionCallback connectionCallback_;       //连接到来的回调函数
   MessageCallback messageCallback_;             //消息到来的回调函数
   WriteCompleteCallback writeCompleteCallback_;
   ThreadInitCallback threadInitCallback_;
   AtomicInt32 started_;
+  double idleTimeout_;
+  double readTimeout_;
+  double writeTimeout_;
+  // one per IO loop, set up in start()
+  std::map<EventLoop*, std::shared_ptr<ConnectionReaper>> reapers_;
+  std::map<EventLoop*, std::shared_ptr<ConnectionPool>> pools_;
+  std::map<EventLoop*, std::shared_ptr<ConnectionStats>> loopStats_;
+  // shared by all connections, rebuilt after the callbacks change
+  TcpConnection::CallbackTablePtr callbacks_;
   // always in loop thread
-  int nextConnId_;                  //下一个连接 ID
-  ConnectionMap connections_;       //连接列表
+  uint32_t nextConnId_;             //下一个连接 ID
+  // Slab of connections. A connection's id is its number in the upper
+  // 32 bits and its slot in the lower 32 bits, so finding it takes no
+  // string building or comparison.
+  std::vector<TcpConnectionPtr> connections_;
+  size_t numConnections_;
+  std::vector<uint32_t> freeSlots_;  //空闲的 slot，后进先出
 };
 
 }  // namespace net
@@ -0,0 +1,95 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/inspect/LoopInspector.h"
+#include "muduo/net/EventLoop.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void LoopInspector::registerCommands(Inspector* ins)
+{
+  ins->add("loop", "stats", std::bind(&LoopInspector::stats, this, _1, _2),
+           "print event loop histograms, /loop/stats[/name]");
+  ins->add("loop", "reset", std::bind(&LoopInspector::reset, this, _1, _2),
+           "reset event loop histograms, /loop/reset[/name]");
+  ins->add("loop", "slow", std::bind(&LoopInspector::slow, this, _1, _2),
+           "log callbacks slower than, /loop/slow/milliseconds[/name], 0 for off");
+}
+
+void LoopInspector::add(const string& name, EventLoop* loop)
+{
+  MutexLockGuard lock(mutex_);
+  loops_[name] = loop;
+}
+
+void LoopInspector::remove(const string& name)
+{
+  MutexLockGuard lock(mutex_);
+  loops_.erase(name);
+}
+
+LoopInspector::LoopList LoopInspector::select(const string& name)
+{
+  MutexLockGuard lock(mutex_);
+  if (name.empty())
+  {
+    return loops_;
+  }
+  LoopList result;
+  LoopList::const_iterator it = loops_.find(name);
+  if (it != loops_.end())
+  {
+    result.insert(*it);
+  }
+  return result;
+}
+
+string LoopInspector::stats(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  string result;
+  for (const auto& item : select(args.empty() ? string() : args[0]))
+  {
+    char buf[256];
+    snprintf(buf, sizeof buf, "%s iterations %lld queue %zd\n",
+             item.first.c_str(),
+             static_cast<long long>(item.second->iteration()),
+             item.second->queueSize());
+    result += buf;
+    result += item.second->stats().toString();
+    result += "\n";
+  }
+  return result;
+}
+
+string LoopInspector::reset(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  string result;
+  for (const auto& item : select(args.empty() ? string() : args[0]))
+  {
+    item.second->resetStats();
+    result += item.first + " reset\n";
+  }
+  return result;
+}
+
+string LoopInspector::slow(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  if (args.empty())
+  {
+    return "usage: /loop/slow/milliseconds[/name]\n";
+  }
+  double ms = atof(args[0].c_str());
+  string result;
+  for (const auto& item : select(args.size() > 1 ? args[1] : string()))
+  {
+    item.second->setSlowCallbackThreshold(ms / 1000);
+    result += item.first + " slow callback threshold " + args[0] + " ms\n";
+  }
+  return result;
+}
@@ -0,0 +1,44 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_INSPECT_LOOPINSPECTOR_H
+#define MUDUO_NET_INSPECT_LOOPINSPECTOR_H
+
+#include "muduo/net/inspect/Inspector.h"
+
+namespace muduo
+{
+namespace net
+{
+
+// Shows EventLoopStats of the loops added to it.
+class LoopInspector : noncopyable
+{
+ public:
+  void registerCommands(Inspector* ins);
+
+  void add(const string& name, EventLoop* loop);
+  void remove(const string& name);
+
+  string stats(HttpRequest::Method, const Inspector::ArgList&);
+  string reset(HttpRequest::Method, const Inspector::ArgList&);
+  string slow(HttpRequest::Method, const Inspector::ArgList&);
+
+ private:
+  typedef std::map<string, EventLoop*> LoopList;
+
+  // the named one, or all if name is empty
+  LoopList select(const string& name);
+
+  MutexLock mutex_;
+  LoopList loops_ GUARDED_BY(mutex_);
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_INSPECT_LOOPINSPECTOR_H
@@ -9,6 +9,8 @@
 
 #include "muduo/net/inspect/ProcessInspector.h"
 #include "muduo/base/FileUtil.h"
+#include "muduo/base/LockProfiler.h"
+#include "muduo/base/Logging.h"
 #include "muduo/base/ProcessInfo.h"
 #include <limits.h>
 #include <stdio.h>
@@ -128,6 +130,9 @@ void ProcessInspector::registerCommands(Inspector* ins)
   ins->add("proc", "status", ProcessInspector::procStatus, "print /proc/self/status");
   // ins->add("proc", "opened_files", ProcessInspector::openedFiles, "count /proc/self/fd");
   ins->add("proc", "threads", ProcessInspector::threads, "list /proc/self/task");
+  ins->add("proc", "locks", ProcessInspector::locks, "print lock contention profile");
+  ins->add("proc", "loglevels", ProcessInspector::logLevels,
+           "print log levels, /proc/loglevels[/INFO,EPollPoller=TRACE,TcpConnection=] to set");
 }
 
 string ProcessInspector::overview(HttpRequest::Method, const Inspector::ArgList&)
@@ -237,3 +242,22 @@ string ProcessInspector::threads(HttpRequest::Method, const Inspector::ArgList&)
   return result;
 }
 
+string ProcessInspector::locks(HttpRequest::Method, const Inspector::ArgList&)
+{
+  if (!LockProfiler::enabled())
+  {
+    return "lock profiling is off, set MUDUO_LOCK_PROFILE=1\n";
+  }
+  return LockProfiler::report();
+}
+
+string ProcessInspector::logLevels(HttpRequest::Method, const Inspector::ArgList& args)
+{
+  string result;
+  if (!args.empty() && !Logger::setLevels(args[0]))
+  {
+    result += "bad levels " + args[0] + "\n";
+  }
+  result += Logger::levels();
+  return result;
+}
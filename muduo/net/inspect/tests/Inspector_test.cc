@@ -10,6 +10,7 @@ int main()
   EventLoop loop;
   EventLoopThread t;
   Inspector ins(t.startLoop(), InetAddress(12345), "test");
+  ins.addLoop("main", &loop);
   loop.loop();
 }
 
@@ -18,6 +18,7 @@ using namespace muduo::net;
 
 RpcChannel::RpcChannel()
   : codec_(std::bind(&RpcChannel::onRpcMessage, this, _1, _2, _3)),
+    mutex_("RpcChannel::outstandings_"),
     services_(NULL)
 {
   LOG_INFO << "RpcChannel::ctor - " << this;
@@ -26,6 +27,7 @@ RpcChannel::RpcChannel()
 RpcChannel::RpcChannel(const TcpConnectionPtr& conn)
   : codec_(std::bind(&RpcChannel::onRpcMessage, this, _1, _2, _3)),
     conn_(conn),
+    mutex_("RpcChannel::outstandings_"),
     services_(NULL)
 {
   LOG_INFO << "RpcChannel::ctor - " << this;
@@ -0,0 +1,206 @@
+// Connector connect timeout, happy eyeballs and reconnect budget.
+
+#include "muduo/net/Connector.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int g_connected = 0;
+int g_timedOut = 0;
+
+void countTimeouts(const char* msg, int len)
+{
+  if (memmem(msg, len, "timed out", 9) != NULL)
+    ++g_timedOut;
+  fwrite(msg, 1, len, stdout);
+}
+
+void onConnection(int sockfd)
+{
+  ++g_connected;
+  sockets::close(sockfd);
+}
+
+// A listener with a full accept queue silently drops further SYNs,
+// so connects to it stay in progress.
+int blackhole(InetAddress* addr)
+{
+  InetAddress any(0, true);
+  int listenfd = sockets::createNonblockingOrDie(any.family());
+  sockets::bindOrDie(listenfd, any.getSockAddr());
+  ::listen(listenfd, 0);
+  *addr = InetAddress(sockets::getLocalAddr(listenfd));
+  return listenfd;
+}
+
+void testConnectTimeout()
+{
+  EventLoop loop;
+  InetAddress serverAddr;
+  int listenfd = blackhole(&serverAddr);
+  // fill the accept queue
+  std::vector<int> fillers;
+  for (int i = 0; i < 4; ++i)
+  {
+    int fd = sockets::createNonblockingOrDie(serverAddr.family());
+    sockets::connect(fd, serverAddr.getSockAddr());
+    fillers.push_back(fd);
+  }
+
+  std::shared_ptr<Connector> connector(new Connector(&loop, serverAddr));
+  connector->setConnectTimeout(0.2);
+  connector->setNewConnectionCallback(onConnection);
+  connector->start();
+  loop.runAfter(1.0, [&] { connector->stop(); });
+  loop.runAfter(1.1, [&] { loop.quit(); });
+  loop.loop();
+  printf("connected %d times, timed out %d times\n", g_connected, g_timedOut);
+  assert(g_connected == 0);
+  assert(g_timedOut > 0);
+
+  for (int fd : fillers)
+    sockets::close(fd);
+  sockets::close(listenfd);
+}
+
+// The first address is blackholed, the second one listens.
+void testHappyEyeballs(const InetAddress& first, double expected)
+{
+  EventLoop loop;
+  InetAddress goodAddr(0, true);
+  int goodfd = sockets::createNonblockingOrDie(goodAddr.family());
+  sockets::bindOrDie(goodfd, goodAddr.getSockAddr());
+  sockets::listenOrDie(goodfd);
+  goodAddr = InetAddress(sockets::getLocalAddr(goodfd));
+
+  std::vector<InetAddress> addrs;
+  addrs.push_back(first);
+  addrs.push_back(goodAddr);
+  std::shared_ptr<Connector> connector(new Connector(&loop, addrs));
+  connector->setConnectionAttemptDelay(0.1);
+  Timestamp start(Timestamp::now());
+  double elapsed = -1;
+  connector->setNewConnectionCallback([&](int sockfd) {
+    elapsed = timeDifference(Timestamp::now(), start);
+    InetAddress peer(sockets::getPeerAddr(sockfd));
+    assert(peer.toIpPort() == goodAddr.toIpPort());
+    sockets::close(sockfd);
+    loop.quit();
+  });
+  connector->start();
+  loop.runAfter(2.0, [&] { loop.quit(); });
+  loop.loop();
+  connector->stop();
+  loop.runAfter(0.1, [&] { loop.quit(); });
+  loop.loop();
+
+  printf("connected to %s in %.3f seconds\n", goodAddr.toIpPort().c_str(), elapsed);
+  assert(elapsed >= 0 && elapsed < expected);
+  sockets::close(goodfd);
+}
+
+void testHappyEyeballs()
+{
+  InetAddress blackholeAddr;
+  int listenfd = blackhole(&blackholeAddr);
+  std::vector<int> fillers;
+  for (int i = 0; i < 4; ++i)
+  {
+    int fd = sockets::createNonblockingOrDie(blackholeAddr.family());
+    sockets::connect(fd, blackholeAddr.getSockAddr());
+    fillers.push_back(fd);
+  }
+  // races after the attempt delay
+  testHappyEyeballs(blackholeAddr, 0.5);
+  // refused, moves on at once
+  testHappyEyeballs(InetAddress("127.0.0.1", 2), 0.05);
+
+  for (int fd : fillers)
+    sockets::close(fd);
+  sockets::close(listenfd);
+}
+
+// The refused attempt reports its error and writability in one event,
+// the blackholed attempt started by the error gets the same fd number.
+// Nothing can connect here.
+void testRefusedThenBlackholed()
+{
+  EventLoop loop;
+  InetAddress blackholeAddr;
+  int listenfd = blackhole(&blackholeAddr);
+  std::vector<int> fillers;
+  for (int i = 0; i < 4; ++i)
+  {
+    int fd = sockets::createNonblockingOrDie(blackholeAddr.family());
+    sockets::connect(fd, blackholeAddr.getSockAddr());
+    fillers.push_back(fd);
+  }
+
+  std::vector<InetAddress> addrs;
+  addrs.push_back(InetAddress("127.0.0.1", 2));
+  addrs.push_back(blackholeAddr);
+  std::shared_ptr<Connector> connector(new Connector(&loop, addrs));
+  connector->setConnectionAttemptDelay(0.1);
+  connector->setConnectTimeout(0.2);
+  int connected = 0;
+  connector->setNewConnectionCallback([&](int sockfd) {
+    ++connected;
+    LOG_ERROR << "connected fd " << sockfd;
+    sockets::close(sockfd);
+  });
+  connector->start();
+  loop.runAfter(1.0, [&] { connector->stop(); });
+  loop.runAfter(1.1, [&] { loop.quit(); });
+  loop.loop();
+
+  printf("refused then blackholed, connected %d times\n", connected);
+  assert(connected == 0);
+  for (int fd : fillers)
+    sockets::close(fd);
+  sockets::close(listenfd);
+}
+
+void testReconnectBudget()
+{
+  EventLoop loop;
+  InetAddress serverAddr("127.0.0.1", 2);  // no such server
+  Connector::setReconnectBudget(5, 1);
+
+  std::vector<std::shared_ptr<Connector>> connectors;
+  for (int i = 0; i < 20; ++i)
+  {
+    connectors.emplace_back(new Connector(&loop, serverAddr));
+    connectors.back()->start();
+  }
+  loop.runAfter(2.0, [&] {
+    for (auto& c : connectors)
+      c->stop();
+  });
+  loop.runAfter(2.1, [&] { loop.quit(); });
+  loop.loop();
+
+  printf("reconnects deferred %lld\n", static_cast<long long>(Connector::reconnectsDeferred()));
+  assert(Connector::reconnectsDeferred() > 0);
+  Connector::setReconnectBudget(0, 0);
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  Logger::setOutput(countTimeouts);
+  testConnectTimeout();
+  testHappyEyeballs();
+  testRefusedThenBlackholed();
+  testReconnectBudget();
+}
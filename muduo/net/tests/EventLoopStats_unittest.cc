@@ -0,0 +1,87 @@
+// EventLoop histograms and slow callback detection.
+
+#include "muduo/net/EventLoop.h"
+
+#include "muduo/base/Logging.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+string g_logs;
+
+void captureOutput(const char* msg, int len)
+{
+  g_logs.append(msg, len);
+}
+
+void testHistogram()
+{
+  LoopHistogram h;
+  assert(h.count() == 0 && h.quantile(0.5) == 0);
+  assert(LoopHistogram::bucket(0) == 0);
+  assert(LoopHistogram::bucket(1) == 1);
+  assert(LoopHistogram::bucket(2) == 2);
+  assert(LoopHistogram::bucket(3) == 2);
+  assert(LoopHistogram::bucket(4) == 3);
+  assert(LoopHistogram::bucket(int64_t(1) << 40) == LoopHistogram::kBuckets - 1);
+
+  for (int i = 0; i < 98; ++i)
+    h.add(3);
+  h.add(100);
+  h.add(1000);
+  assert(h.count() == 100);
+  assert(h.sum() == 98 * 3 + 1100);
+  assert(h.quantile(0.5) == 3);
+  assert(h.quantile(0.99) == 127);
+  assert(h.quantile(1.0) == 1023);
+  printf("%s\n", h.toString().c_str());
+  h.reset();
+  assert(h.count() == 0 && h.bucketCount(2) == 0);
+}
+
+void testLoop()
+{
+  EventLoop loop;
+  loop.setSlowCallbackThreshold(0.02);
+
+  loop.runAfter(0.05, [] { ::usleep(50 * 1000); });
+  loop.runAfter(0.1, [] { ::usleep(1000); });   // fast enough
+  // queued in the loop thread, so one iteration drains them all
+  loop.runAfter(0.15, [&loop] {
+    for (int i = 0; i < 10; ++i)
+      loop.queueInLoop([] { });
+    loop.queueInLoop([] { ::usleep(30 * 1000); });
+  });
+  loop.runAfter(0.3, [&loop] { loop.quit(); });
+  loop.loop();
+
+  const EventLoopStats& stats = loop.stats();
+  printf("%s", stats.toString().c_str());
+  // at least, a loaded machine may slow down the fast one too
+  assert(stats.slowCallbacks.load() >= 2);
+  assert(stats.pollUs.count() == loop.iteration());
+  assert(stats.activeChannels.count() == loop.iteration());
+  assert(stats.handlingUs.quantile(1.0) >= 50 * 1000);
+  assert(stats.functorsUs.quantile(1.0) >= 30 * 1000);
+  assert(stats.queueDepth.quantile(1.0) >= 11);
+  // the timerfd
+  assert(strstr(g_logs.c_str(), "slow callback of channel {") != NULL);
+  assert(strstr(g_logs.c_str(), "slow functor") != NULL);
+
+  loop.resetStats();
+  assert(loop.stats().pollUs.count() == 0);
+  assert(loop.stats().slowCallbacks.load() == 0);
+}
+
+int main()
+{
+  Logger::setOutput(captureOutput);
+  testHistogram();
+  testLoop();
+  printf("OK\n");
+}
@@ -68,3 +68,14 @@ BOOST_AUTO_TEST_CASE(testInetAddressResolve)
     LOG_ERROR << "Unable to resolve google.com";
   }
 }
+
+BOOST_AUTO_TEST_CASE(testInetAddressResolveAll)
+{
+  std::vector<InetAddress> addrs = InetAddress::resolveAll("localhost", 8080);
+  BOOST_CHECK(!addrs.empty());
+  for (const InetAddress& addr : addrs)
+  {
+    BOOST_CHECK_EQUAL(addr.port(), 8080);
+    LOG_INFO << "localhost resolved to " << addr.toIpPort();
+  }
+}
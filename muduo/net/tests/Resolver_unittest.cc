@@ -0,0 +1,189 @@
+// Resolver against a stub DNS server running in the same loop.
+
+#include "muduo/net/Resolver.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <map>
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Answers A and AAAA queries:
+//   example.test  10.0.0.1, 10.0.0.2, 2001:db8::1, TTL 1
+//   nx.test       NXDOMAIN
+//   slow.test     never answers
+class StubDnsServer : noncopyable
+{
+ public:
+  explicit StubDnsServer(EventLoop* loop)
+    : sockfd_(::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)),
+      channel_(loop, sockfd_)
+  {
+    InetAddress addr(0, true);
+    sockets::bindOrDie(sockfd_, addr.getSockAddr());
+    address_ = InetAddress(sockets::getLocalAddr(sockfd_));
+    channel_.setReadCallback(std::bind(&StubDnsServer::onRead, this));
+    channel_.enableReading();
+  }
+
+  ~StubDnsServer()
+  {
+    channel_.disableAll();
+    channel_.remove();
+    sockets::close(sockfd_);
+  }
+
+  const InetAddress& address() const { return address_; }
+  int queries(const string& name) { return queries_[name]; }
+
+ private:
+  void onRead()
+  {
+    unsigned char buf[512];
+    struct sockaddr_in6 peer;
+    socklen_t peerLen = sizeof peer;
+    ssize_t n = ::recvfrom(sockfd_, buf, sizeof buf, 0,
+                           sockets::sockaddr_cast(&peer), &peerLen);
+    if (n < 12)
+      return;
+
+    string name;
+    size_t off = 12;
+    while (off < static_cast<size_t>(n) && buf[off] != 0)
+    {
+      if (!name.empty())
+        name += '.';
+      name.append(reinterpret_cast<char*>(buf + off + 1), buf[off]);
+      off += 1 + buf[off];
+    }
+    off += 1;
+    uint16_t qtype = static_cast<uint16_t>(buf[off] << 8 | buf[off + 1]);
+    size_t questionEnd = off + 4;
+    ++queries_[name];
+
+    if (name == "slow.test")
+      return;
+
+    string reply(reinterpret_cast<char*>(buf), questionEnd);
+    reply[2] = static_cast<char>(0x81);  // QR, RD
+    reply[3] = static_cast<char>(name == "nx.test" ? 0x83 : 0x80);  // RA, rcode
+    int ancount = 0;
+    if (name == "example.test")
+    {
+      if (qtype == 1)
+      {
+        addAnswer(&reply, 1, "\x0a\x00\x00\x01", 4);
+        addAnswer(&reply, 1, "\x0a\x00\x00\x02", 4);
+        ancount = 2;
+      }
+      else if (qtype == 28)
+      {
+        struct in6_addr addr6;
+        ::inet_pton(AF_INET6, "2001:db8::1", &addr6);
+        addAnswer(&reply, 28, reinterpret_cast<const char*>(&addr6), 16);
+        ancount = 1;
+      }
+    }
+    reply[7] = static_cast<char>(ancount);
+    ::sendto(sockfd_, reply.data(), reply.size(), 0,
+             sockets::sockaddr_cast(&peer), peerLen);
+  }
+
+  static void addAnswer(string* reply, uint16_t type, const char* rdata, int len)
+  {
+    const char rr[] = {
+      '\xc0', '\x0c',                 // name: pointer to the question
+      0, static_cast<char>(type),
+      0, 1,                           // class IN
+      0, 0, 0, 1,                     // TTL 1 second
+      0, static_cast<char>(len),
+    };
+    reply->append(rr, sizeof rr);
+    reply->append(rdata, len);
+  }
+
+  int sockfd_;
+  Channel channel_;
+  InetAddress address_;
+  std::map<string, int> queries_;
+};
+
+std::map<string, std::vector<string>> g_results;
+
+Resolver::Callback record(const string& key)
+{
+  return [key](const std::vector<InetAddress>& addresses) {
+    std::vector<string>& result = g_results[key];
+    for (const InetAddress& addr : addresses)
+      result.push_back(addr.toIpPort());
+    printf("%s:", key.c_str());
+    for (const string& s : result)
+      printf(" %s", s.c_str());
+    printf("\n");
+  };
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  char hostsFile[64];
+  snprintf(hostsFile, sizeof hostsFile, "/tmp/resolver_unittest_hosts.%d", getpid());
+  FILE* fp = fopen(hostsFile, "w");
+  fputs("# comment\n10.1.2.3  myhost myhost.example  # alias\n::1 ip6-localhost\n", fp);
+  fclose(fp);
+
+  EventLoop loop;
+  StubDnsServer server(&loop);
+  Resolver resolver(&loop, std::vector<InetAddress>(1, server.address()), hostsFile);
+  resolver.setTimeout(0.2);
+  resolver.setAttempts(2);
+
+  // concurrent lookups of one name share the queries
+  resolver.resolve("example.test", 80, record("first"));
+  resolver.resolve("EXAMPLE.test.", 81, record("second"));
+  resolver.resolve("myhost.example", 80, record("hosts"));
+  resolver.resolve("1.2.3.4", 80, record("numeric"));
+  resolver.resolve("nx.test", 80, record("nx"));
+  resolver.resolve("slow.test", 80, record("slow"));
+  loop.runAfter(0.1, [&] {
+    resolver.resolve("example.test", 82, record("cached"));
+    resolver.resolve("nx.test", 80, record("nx cached"));
+  });
+  // after the TTL of 1 second
+  loop.runAfter(1.2, [&] { resolver.resolve("example.test", 83, record("expired")); });
+  loop.runAfter(1.5, [&] { loop.quit(); });
+  loop.loop();
+  ::unlink(hostsFile);
+
+  assert(g_results["first"].size() == 3);
+  assert(g_results["first"][0] == "10.0.0.1:80");
+  assert(g_results["first"][2] == "[2001:db8::1]:80");
+  assert(g_results["second"].size() == 3);
+  assert(g_results["second"][1] == "10.0.0.2:81");
+  assert(g_results["hosts"].size() == 1 && g_results["hosts"][0] == "10.1.2.3:80");
+  assert(g_results["numeric"].size() == 1 && g_results["numeric"][0] == "1.2.3.4:80");
+  // failures call back with no address, count() as operator[] would add the key
+  assert(g_results.count("nx") == 1 && g_results.at("nx").empty());
+  assert(g_results.count("nx cached") == 1 && g_results.at("nx cached").empty());
+  assert(g_results.count("slow") == 1 && g_results.at("slow").empty());
+  assert(g_results["cached"].size() == 3 && g_results["cached"][0] == "10.0.0.1:82");
+  assert(g_results["expired"].size() == 3 && g_results["expired"][0] == "10.0.0.1:83");
+
+  // A and AAAA, twice for example.test because the TTL expired
+  assert(server.queries("example.test") == 4);
+  assert(server.queries("nx.test") == 2);
+  // tried twice
+  assert(server.queries("slow.test") == 4);
+  assert(server.queries("myhost.example") == 0);
+  printf("OK\n");
+}
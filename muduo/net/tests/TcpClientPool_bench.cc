@@ -0,0 +1,165 @@
+// Pipelined request/response through TcpClientPool against a local echo server.
+//
+// Usage: tcpclientpool_bench [connections [threads [depth [requests]]]]
+
+#include "muduo/net/TcpClientPool.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpServer.h"
+
+#include <atomic>
+#include <memory>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kMessageSize = 16;
+
+class Bench : noncopyable
+{
+ public:
+  Bench(EventLoop* loop, const InetAddress& serverAddr,
+        int connections, int threads, int depth, int requests)
+    : loop_(loop),
+      pool_(loop, std::vector<InetAddress>(1, serverAddr), "PoolBench"),
+      connections_(connections),
+      depth_(depth),
+      requests_(requests),
+      sent_(0),
+      received_(0),
+      message_(kMessageSize, 'x')
+  {
+    pool_.setConnectionsPerBackend(connections);
+    pool_.setThreadNum(threads);
+    pool_.setConnectionCallback(
+        std::bind(&Bench::onConnection, this, _1));
+    pool_.setMessageCallback(
+        std::bind(&Bench::onMessage, this, _1, _2, _3));
+  }
+
+  void start()
+  {
+    pool_.start();
+  }
+
+  void report()
+  {
+    double seconds = timeDifference(finish_, start_);
+    printf("%4d connections %4d in flight %8d requests %8.3f seconds %10.0f req/s\n",
+           connections_, depth_, requests_, seconds, requests_ / seconds);
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected() && pool_.numConnected() == connections_)
+    {
+      loop_->runInLoop(std::bind(&Bench::kickOff, this));
+    }
+    else if (!conn->connected() && pool_.numConnected() == 0)
+    {
+      loop_->quit();
+    }
+  }
+
+  void kickOff()
+  {
+    start_ = Timestamp::now();
+    for (int i = 0; i < depth_; ++i)
+    {
+      sendOne();
+    }
+  }
+
+  void sendOne()
+  {
+    if (sent_.fetch_add(1) >= requests_)
+      return;
+    TcpConnectionPtr conn = pool_.acquire();
+    if (conn)
+    {
+      conn->send(message_);
+    }
+    else
+    {
+      LOG_ERROR << "no connection available";
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    while (buf->readableBytes() >= kMessageSize)
+    {
+      buf->retrieve(kMessageSize);
+      pool_.release(conn);
+      if (received_.fetch_add(1) + 1 == requests_)
+      {
+        finish_ = Timestamp::now();
+        // quits when all connections are down
+        pool_.stop();
+      }
+      else
+      {
+        sendOne();
+      }
+    }
+  }
+
+  EventLoop* loop_;
+  TcpClientPool pool_;
+  const int connections_;
+  const int depth_;
+  const int requests_;
+  std::atomic<int> sent_;
+  std::atomic<int> received_;
+  const string message_;
+  Timestamp start_;
+  Timestamp finish_;
+};
+
+void onEcho(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  conn->send(buf);
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  int connections = argc > 1 ? atoi(argv[1]) : 4;
+  int threads = argc > 2 ? atoi(argv[2]) : 0;
+  int depth = argc > 3 ? atoi(argv[3]) : 64;
+  int requests = argc > 4 ? atoi(argv[4]) : 200000;
+
+  // the echo backend runs in its own loop, TcpServer lives and dies there
+  EventLoopThread serverThread;
+  EventLoop* serverLoop = serverThread.startLoop();
+  InetAddress listenAddr(2019, true);
+  std::unique_ptr<TcpServer> server;
+  CountDownLatch started(1);
+  serverLoop->runInLoop([&] {
+    server.reset(new TcpServer(serverLoop, listenAddr, "EchoBackend"));
+    server->setMessageCallback(onEcho);
+    server->setThreadNum(threads);
+    server->start();
+    started.countDown();
+  });
+  started.wait();
+
+  {
+    EventLoop loop;
+    Bench bench(&loop, listenAddr, connections, threads, depth, requests);
+    bench.start();
+    loop.loop();
+    bench.report();
+  }
+  CountDownLatch stopped(1);
+  serverLoop->runInLoop([&] { server.reset(); stopped.countDown(); });
+  stopped.wait();
+}
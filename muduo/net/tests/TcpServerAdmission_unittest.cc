@@ -0,0 +1,137 @@
+// TcpServer connection limit, accept rate and overload mode.
+
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+std::vector<int> g_clients;
+
+void connectClients(const InetAddress& addr, int n)
+{
+  for (int i = 0; i < n; ++i)
+  {
+    int sockfd = sockets::createNonblockingOrDie(addr.family());
+    sockets::connect(sockfd, addr.getSockAddr());
+    g_clients.push_back(sockfd);
+  }
+}
+
+void closeClients()
+{
+  for (int sockfd : g_clients)
+  {
+    sockets::close(sockfd);
+  }
+  g_clients.clear();
+}
+
+// true if the server closed it, false if it's still open
+bool closedByServer(int sockfd)
+{
+  char c;
+  return ::read(sockfd, &c, 1) == 0;
+}
+
+void testMaxConnections()
+{
+  EventLoop loop;
+  InetAddress listenAddr(31010, true);
+  TcpServer server(&loop, listenAddr, "LimitServer");
+  server.setMaxConnections(3);
+  server.start();
+
+  connectClients(listenAddr, 5);
+  loop.runAfter(0.2, [&] { loop.quit(); });
+  loop.loop();
+
+  printf("limit: %zd connections, %lld rejected\n",
+         server.numConnections(), static_cast<long long>(server.numRejected()));
+  assert(server.numConnections() == 3);
+  assert(server.numRejected() == 2);
+  int closed = 0;
+  for (int sockfd : g_clients)
+  {
+    closed += closedByServer(sockfd);
+  }
+  assert(closed == 2);
+  closeClients();
+  loop.runAfter(0.1, [&] { loop.quit(); });
+  loop.loop();
+  assert(server.numConnections() == 0);
+}
+
+void testAcceptRate()
+{
+  EventLoop loop;
+  InetAddress listenAddr(31011, true);
+  TcpServer server(&loop, listenAddr, "RateServer");
+  // one every 0.1s, two at once
+  server.setAcceptRate(10, 2);
+  server.start();
+
+  connectClients(listenAddr, 6);
+  size_t early = 0;
+  loop.runAfter(0.05, [&] { early = server.numConnections(); });
+  loop.runAfter(0.6, [&] { loop.quit(); });
+  loop.loop();
+
+  printf("rate: %zd after 0.05s, %zd after 0.6s, %lld deferred\n",
+         early, server.numConnections(), static_cast<long long>(server.numDeferred()));
+  assert(early == 2);
+  assert(server.numConnections() == 6);
+  assert(server.numDeferred() >= 4);
+  assert(server.numRejected() == 0);
+  closeClients();
+  loop.runAfter(0.1, [&] { loop.quit(); });
+  loop.loop();
+}
+
+void testOverload()
+{
+  EventLoop loop;
+  InetAddress listenAddr(31012, true);
+  TcpServer server(&loop, listenAddr, "OverloadServer");
+  server.setThreadNum(1);
+  server.setOverloadThreshold(0, 0.05);
+  server.start();
+
+  // the IO loop is stuck for 0.4s
+  EventLoop* ioLoop = server.threadPool()->getAllLoops()[0];
+  ioLoop->runInLoop([] { ::usleep(400 * 1000); });
+  size_t stuck = 0;
+  loop.runAfter(0.1, [&] { connectClients(listenAddr, 1); });
+  loop.runAfter(0.3, [&] { stuck = server.numConnections(); });
+  loop.runAfter(0.7, [&] { loop.quit(); });
+  loop.loop();
+
+  printf("overload: %zd while stuck, %zd after, %lld deferred\n",
+         stuck, server.numConnections(), static_cast<long long>(server.numDeferred()));
+  assert(stuck == 0);
+  assert(server.numConnections() == 1);
+  assert(server.numDeferred() > 0);
+  closeClients();
+  loop.runAfter(0.1, [&] { loop.quit(); });
+  loop.loop();
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  testMaxConnections();
+  testAcceptRate();
+  testOverload();
+  printf("OK\n");
+}
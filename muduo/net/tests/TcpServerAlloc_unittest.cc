@@ -0,0 +1,115 @@
+// Heap allocations made for each connection a TcpServer accepts.
+//
+// Usage: tcpserveralloc_unittest [connections]
+
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+
+#include <atomic>
+#include <memory>
+#include <new>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+std::atomic<int64_t> g_allocations(0);
+
+void* operator new(size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = ::malloc(size ? size : 1);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  ::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  ::free(p);
+}
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->send("x", 1);
+  }
+}
+
+void onMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  buf->retrieveAll();
+}
+
+// no allocation on the client side, plain blocking sockets
+void churn(const InetAddress& addr, int n)
+{
+  for (int i = 0; i < n; ++i)
+  {
+    int sockfd = ::socket(addr.family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (::connect(sockfd, addr.getSockAddr(), sizeof(struct sockaddr_in6)) < 0)
+    {
+      LOG_SYSFATAL << "connect";
+    }
+    char c;
+    if (::read(sockfd, &c, 1) != 1)
+    {
+      LOG_SYSFATAL << "read";
+    }
+    ::close(sockfd);
+    // the server sees EOF and tears down
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  int connections = argc > 1 ? atoi(argv[1]) : 2000;
+
+  EventLoopThread serverThread;
+  EventLoop* serverLoop = serverThread.startLoop();
+  InetAddress listenAddr(2021, true);
+  std::unique_ptr<TcpServer> server;
+  CountDownLatch started(1);
+  serverLoop->runInLoop([&] {
+    server.reset(new TcpServer(serverLoop, listenAddr, "AllocServer"));
+    server->setConnectionCallback(onConnection);
+    server->setMessageCallback(onMessage);
+    server->start();
+    started.countDown();
+  });
+  started.wait();
+
+  // warms up pools and containers
+  churn(listenAddr, 100);
+  usleep(100 * 1000);
+
+  int64_t before = g_allocations.load();
+  churn(listenAddr, connections);
+  // lets the last ones be torn down
+  usleep(100 * 1000);
+  int64_t allocations = g_allocations.load() - before;
+  double perConnection = static_cast<double>(allocations) / connections;
+  printf("%lld allocations for %d connections, %.2f per connection\n",
+         static_cast<long long>(allocations), connections, perConnection);
+
+  CountDownLatch stopped(1);
+  serverLoop->runInLoop([&] { server.reset(); stopped.countDown(); });
+  stopped.wait();
+  assert(perConnection < 8);
+}
@@ -0,0 +1,114 @@
+// Connections accepted and torn down per second by a TcpServer,
+// with some long-lived connections kept open meanwhile.
+//
+// Usage: tcpserverchurn_bench [seconds [resident [threads]]]
+
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    conn->send("x", 1);
+  }
+}
+
+// blocks until the server has set up the connection
+int connectAndWait(const InetAddress& addr)
+{
+  int sockfd = ::socket(addr.family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (::connect(sockfd, addr.getSockAddr(), sizeof(struct sockaddr_in6)) < 0)
+  {
+    LOG_SYSFATAL << "connect";
+  }
+  char c;
+  if (::read(sockfd, &c, 1) != 1)
+  {
+    LOG_SYSFATAL << "read";
+  }
+  return sockfd;
+}
+
+// resets rather than lingering in TIME_WAIT
+void abortiveClose(int sockfd)
+{
+  struct linger lg = { 1, 0 };
+  ::setsockopt(sockfd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+  ::close(sockfd);
+}
+
+// the server logs every reset as an error
+void discardOutput(const char*, int)
+{
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  Logger::setOutput(discardOutput);
+  double seconds = argc > 1 ? atof(argv[1]) : 3.0;
+  int resident = argc > 2 ? atoi(argv[2]) : 500;
+  int threads = argc > 3 ? atoi(argv[3]) : 0;
+
+  EventLoopThread serverThread;
+  EventLoop* serverLoop = serverThread.startLoop();
+  InetAddress listenAddr(2020, true);
+  std::unique_ptr<TcpServer> server;
+  CountDownLatch started(1);
+  serverLoop->runInLoop([&] {
+    server.reset(new TcpServer(serverLoop, listenAddr, "ChurnServer"));
+    server->setConnectionCallback(onConnection);
+    server->setThreadNum(threads);
+    server->start();
+    started.countDown();
+  });
+  started.wait();
+
+  std::vector<int> residents;
+  for (int i = 0; i < resident; ++i)
+  {
+    residents.push_back(connectAndWait(listenAddr));
+  }
+
+  int64_t churned = 0;
+  Timestamp start(Timestamp::now());
+  Timestamp now(start);
+  while (timeDifference(now, start) < seconds)
+  {
+    for (int i = 0; i < 100; ++i)
+    {
+      abortiveClose(connectAndWait(listenAddr));
+    }
+    churned += 100;
+    now = Timestamp::now();
+  }
+  double elapsed = timeDifference(now, start);
+  printf("%d resident, %d threads: %lld connections in %.3f seconds, %.0f per second\n",
+         resident, threads, static_cast<long long>(churned), elapsed,
+         static_cast<double>(churned) / elapsed);
+
+  for (int sockfd : residents)
+  {
+    ::close(sockfd);
+  }
+  CountDownLatch stopped(1);
+  serverLoop->runInLoop([&] { server.reset(); stopped.countDown(); });
+  stopped.wait();
+}
@@ -0,0 +1,177 @@
+// Per connection counters and their sums per IO loop.
+
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/Thread.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <assert.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int connectTo(uint16_t port, int rcvbuf)
+{
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (rcvbuf > 0)
+  {
+    ::setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+  }
+  InetAddress addr(port, true);
+  int ret = ::connect(sockfd, addr.getSockAddr(), sizeof(struct sockaddr_in));
+  assert(ret == 0); (void) ret;
+  return sockfd;
+}
+
+void readFully(int sockfd, size_t len)
+{
+  char buf[65536];
+  while (len > 0)
+  {
+    ssize_t n = ::read(sockfd, buf, std::min(len, sizeof buf));
+    assert(n > 0);
+    len -= n;
+  }
+}
+
+// Checks done() in the loop every 10ms, quits when it holds.
+// Under load a fixed delay can be too short.
+void quitWhen(EventLoop* loop, const std::function<bool()>& done)
+{
+  loop->runEvery(0.01, [=] {
+    if (done())
+      loop->quit();
+  });
+}
+
+void print(const char* what, const ConnectionStats::Snapshot& stats)
+{
+  printf("%s: %s\n", what, ConnectionStats::toString(stats).c_str());
+}
+
+void testEcho()
+{
+  const int kMessages = 10;
+  const int kLen = 1000;
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(31020, true), "EchoStats");
+  server.setThreadNum(1);
+  ConnectionStats::Snapshot connStats = {};
+  std::atomic<bool> closed(false);
+  server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->disconnected())
+    {
+      connStats = conn->stats().snapshot();
+      closed = true;
+    }
+  });
+  server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    conn->send(buf);
+  });
+  server.start();
+
+  Thread client([] {
+    int sockfd = connectTo(31020, 0);
+    char message[kLen] = { 0 };
+    for (int i = 0; i < kMessages; ++i)
+    {
+      ssize_t n = ::write(sockfd, message, sizeof message);
+      assert(n == kLen); (void) n;
+      readFully(sockfd, kLen);
+    }
+    ::close(sockfd);
+  });
+  client.start();
+  // the connection is destroyed after the callback
+  quitWhen(&loop, [&] {
+    return closed && server.stats()[ConnectionStats::kConnections] == 0;
+  });
+  loop.loop();
+  client.join();
+
+  EventLoop* ioLoop = server.threadPool()->getAllLoops()[0];
+  ConnectionStats::Snapshot stats = server.stats();
+  print("echo connection", connStats);
+  print("echo server", stats);
+  assert(stats == server.loopStats(ioLoop)->snapshot());
+  assert(server.loopStats(&loop) == NULL);
+  assert(stats[ConnectionStats::kBytesReceived] == kMessages * kLen);
+  assert(stats[ConnectionStats::kBytesSent] == kMessages * kLen);
+  assert(stats[ConnectionStats::kMessages] >= kMessages);
+  // and the one reading 0 byte
+  assert(stats[ConnectionStats::kReadCalls] == stats[ConnectionStats::kMessages] + 1);
+  assert(stats[ConnectionStats::kWriteCalls] >= kMessages);
+  assert(stats[ConnectionStats::kMaxOutputBacklog] == 0);
+  assert(stats[ConnectionStats::kConnections] == 0);
+  assert(connStats[ConnectionStats::kBytesReceived] == kMessages * kLen);
+  assert(connStats[ConnectionStats::kConnections] == 1);
+}
+
+void testSlowConsumer()
+{
+  const size_t kHighWaterMark = 64 * 1024;
+  const size_t kLen = 16 * 1024 * 1024;
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(31021, true), "SlowStats");
+  server.setThreadNum(1);
+  // taken in the IO loop right after send(), before any of it drains
+  ConnectionStats::Snapshot stuck = {};
+  CountDownLatch stuckTaken(1);
+  server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->connected())
+    {
+      conn->setHighWaterMarkCallback([&](const TcpConnectionPtr&, size_t) {
+        stuck = server.stats();
+        stuckTaken.countDown();
+      }, kHighWaterMark);
+      conn->send(string(kLen, 'x'));
+    }
+  });
+  server.start();
+
+  std::atomic<bool> finished(false);
+  Thread client([&] {
+    int sockfd = connectTo(31021, 4096);
+    stuckTaken.wait();
+    ::usleep(200 * 1000);
+    readFully(sockfd, kLen);
+    ::close(sockfd);
+    finished = true;
+  });
+  client.start();
+
+  quitWhen(&loop, [&] {
+    return finished && server.stats()[ConnectionStats::kConnections] == 0;
+  });
+  loop.loop();
+  client.join();
+
+  ConnectionStats::Snapshot stats = server.stats();
+  print("slow consumer stuck", stuck);
+  print("slow consumer", stats);
+  assert(stuck[ConnectionStats::kConnections] == 1);
+  assert(stuck[ConnectionStats::kAboveHighWaterMark] == 1);
+  assert(stuck[ConnectionStats::kMaxOutputBacklog] > static_cast<int64_t>(kHighWaterMark));
+  assert(stats[ConnectionStats::kAboveHighWaterMark] == 0);
+  assert(stats[ConnectionStats::kHighWaterMarkUs] >= 200 * 1000);
+  assert(stats[ConnectionStats::kBytesSent] == static_cast<int64_t>(kLen));
+  assert(stats[ConnectionStats::kWriteCalls] > 1);
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  testEcho();
+  testSlowConsumer();
+  printf("OK\n");
+}
@@ -0,0 +1,108 @@
+// TcpServer idle and write timeouts.
+
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <map>
+
+#include <assert.h>
+#include <stdio.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// seconds each connection lived, by peer port
+std::map<uint16_t, double> g_lifetime;
+std::map<string, Timestamp> g_established;
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_established[conn->name()] = Timestamp::now();
+  }
+  else
+  {
+    double lived = timeDifference(Timestamp::now(), g_established[conn->name()]);
+    g_lifetime[conn->peerAddress().port()] = lived;
+    printf("%s lived %.3f seconds\n", conn->name().c_str(), lived);
+  }
+}
+
+int connectTo(const InetAddress& addr, uint16_t* port)
+{
+  int sockfd = sockets::createNonblockingOrDie(addr.family());
+  sockets::connect(sockfd, addr.getSockAddr());
+  *port = InetAddress(sockets::getLocalAddr(sockfd)).port();
+  return sockfd;
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  InetAddress listenAddr(31001, true);
+  EventLoop loop;
+
+  // idle: quiet ones go, chatty ones stay
+  {
+    TcpServer server(&loop, listenAddr, "IdleServer");
+    server.setConnectionCallback(onConnection);
+    server.setIdleTimeout(0.3);
+    server.start();
+
+    uint16_t quietPort, chattyPort;
+    int quiet = connectTo(listenAddr, &quietPort);
+    int chatty = connectTo(listenAddr, &chattyPort);
+    TimerId chat = loop.runEvery(0.1, [chatty] { ::write(chatty, "x", 1); });
+    loop.runAfter(1.0, [&] { loop.cancel(chat); });
+    loop.runAfter(1.6, [&] { loop.quit(); });
+    loop.loop();
+
+    assert(g_lifetime.count(quietPort) == 1);
+    assert(g_lifetime[quietPort] >= 0.3 && g_lifetime[quietPort] < 0.5);
+    // closed once it stopped talking
+    assert(g_lifetime.count(chattyPort) == 1);
+    assert(g_lifetime[chattyPort] > 1.0);
+    sockets::close(quiet);
+    sockets::close(chatty);
+  }
+
+  // write: a peer that doesn't read is dropped once its window is full,
+  // while an idle peer with nothing to receive is left alone
+  {
+    InetAddress listenAddr2(31002, true);
+    TcpServer server(&loop, listenAddr2, "WriteServer");
+    int accepted = 0;
+    server.setConnectionCallback([&accepted](const TcpConnectionPtr& conn) {
+      onConnection(conn);
+      // floods the first one only
+      if (conn->connected() && ++accepted == 1)
+      {
+        conn->send(string(16 * 1024 * 1024, 'x'));
+      }
+    });
+    server.setWriteTimeout(0.3);
+    server.start();
+
+    uint16_t stuckPort, idlePort;
+    int stuck = connectTo(listenAddr2, &stuckPort);
+    loop.runAfter(0.05, [&] { loop.quit(); });
+    loop.loop();
+    int idle = connectTo(listenAddr2, &idlePort);
+    loop.runAfter(1.0, [&] { loop.quit(); });
+    loop.loop();
+
+    assert(g_lifetime.count(stuckPort) == 1);
+    assert(g_lifetime[stuckPort] >= 0.3 && g_lifetime[stuckPort] < 0.6);
+    assert(g_lifetime.count(idlePort) == 0);
+    sockets::close(stuck);
+    sockets::close(idle);
+    loop.runAfter(0.1, [&] { loop.quit(); });
+    loop.loop();
+  }
+  printf("OK\n");
+}